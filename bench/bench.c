@@ -0,0 +1,570 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Micro-benchmarks of the kernels of reader-el. The reader is compiled in
+ * with its entry point renamed, so the heap, the table width and the other
+ * compile-time choices of a build are those of the matching reader binary.
+ *
+ * Suites:
+ *   heap     : operation traces of the compiled heap, n items inserted,
+ *              then delete-min with d decrease-keys after each, keys are
+ *              unique and monotone so every heap replays the same trace
+ *   merge    : the subset merge kernel over a full table, n x 2^k
+ *   dijkstra : Dijkstra from fixed sources on 'regular' and 'powlaw'
+ *              graphs of graph-gen/gen-unique
+ *
+ * Each case runs its warm-up rounds, then its timed rounds, and reports the
+ * median, 10th and 90th percentile and the minimum. With -baseline the
+ * medians are compared to a stored run, a case slower by more than the
+ * tolerance is a regression and the exit status is 1. -save stores the
+ * medians of this run.
+ *
+ */
+
+#define main reader_main
+#include"../reader/reader-el.c"
+#undef main
+
+#include"../graph-gen/ffprng.h"
+
+#if defined(FIB_HEAP)
+#define HEAP_NAME "fib"
+#elif defined(RADIX_HEAP)
+#define HEAP_NAME "radix"
+#else
+#define HEAP_NAME "bin"
+#endif
+
+#define BENCH_MAX_CASES 256
+#define BENCH_MAX_NAME  128
+
+/************************************************************ Bench options. */
+
+typedef struct bench
+{
+    index_t repeat;
+    index_t warmup;
+    index_t quick;
+    double tolerance;           // percent
+    const char *gen;            // gen-unique binary
+    index_t num_base;           // stored medians
+    char base_name[BENCH_MAX_CASES][BENCH_MAX_NAME];
+    double base_median[BENCH_MAX_CASES];
+    index_t num_cases;          // medians of this run
+    char name[BENCH_MAX_CASES][BENCH_MAX_NAME];
+    double median[BENCH_MAX_CASES];
+    index_t regressions;
+} bench_t;
+
+static void bench_load(bench_t *b, const char *file)
+{
+    b->num_base = 0;
+    FILE *in = fopen(file, "r");
+    if(in == NULL)
+    {
+        fprintf(stdout, "bench: no baseline in '%s', nothing to compare\n",
+                        file);
+        return;
+    }
+    char name[BENCH_MAX_NAME];
+    double median;
+    while(b->num_base < BENCH_MAX_CASES &&
+          fscanf(in, "%127s %lf", name, &median) == 2)
+    {
+        strcpy(b->base_name[b->num_base], name);
+        b->base_median[b->num_base++] = median;
+    }
+    fclose(in);
+}
+
+static void bench_save(bench_t *b, const char *file)
+{
+    FILE *out = fopen(file, "w");
+    if(out == NULL)
+        ERROR("unable to open baseline file '%s'", file);
+    for(index_t i = 0; i < b->num_cases; i++)
+        fprintf(out, "%s %.6lf\n", b->name[i], b->median[i]);
+    fclose(out);
+}
+
+static int bench_cmp_time(const void *a, const void *b)
+{
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// nearest rank percentile of the sorted times t[0..r-1]
+static double bench_pct(double *t, index_t r, double p)
+{
+    index_t i = (index_t) ceil(p*r) - 1;
+    return t[MAX(0, MIN(i, r-1))];
+}
+
+/*
+ * Times run(arg) in b->repeat rounds after b->warmup untimed ones. The
+ * setup(arg), if any, restores the input before every round, untimed.
+ */
+static void bench_case(bench_t *b, const char *name,
+                       void (*setup)(void *), void (*run)(void *), void *arg)
+{
+    double *t = (double *) MALLOC(b->repeat*sizeof(double));
+    for(index_t i = 0; i < b->warmup + b->repeat; i++)
+    {
+        if(setup != NULL)
+            setup(arg);
+        double start = omp_get_wtime();
+        run(arg);
+        double time = 1000.0*(omp_get_wtime() - start);
+        if(i >= b->warmup)
+            t[i - b->warmup] = time;
+    }
+    qsort(t, b->repeat, sizeof(double), bench_cmp_time);
+    double median = bench_pct(t, b->repeat, 0.5);
+    fprintf(stdout, "bench: [case: %s] [runs: %ld] [median: %.3lf ms] "
+                    "[p10: %.3lf ms] [p90: %.3lf ms] [min: %.3lf ms]",
+                    name, b->repeat, median, bench_pct(t, b->repeat, 0.1),
+                    bench_pct(t, b->repeat, 0.9), t[0]);
+    FREE(t);
+
+    for(index_t i = 0; i < b->num_base; i++)
+    {
+        if(strcmp(b->base_name[i], name))
+            continue;
+        double change = 100.0*(median - b->base_median[i])/b->base_median[i];
+        fprintf(stdout, " [baseline: %.3lf ms] [change: %+.1lf%%]",
+                        b->base_median[i], change);
+        if(change > b->tolerance)
+        {
+            fprintf(stdout, " REGRESSION");
+            b->regressions++;
+        }
+        break;
+    }
+    fprintf(stdout, "\n");
+    fflush(stdout);
+
+    assert(strlen(name) < BENCH_MAX_NAME);
+    if(b->num_cases < BENCH_MAX_CASES)
+    {
+        strcpy(b->name[b->num_cases], name);
+        b->median[b->num_cases++] = median;
+    }
+}
+
+/************************************************************** Heap traces. */
+
+#define TRACE_DELETE_MIN -1
+
+typedef struct trace
+{
+    index_t n;
+    index_t len;
+    index_t *item;              // TRACE_DELETE_MIN or the item of a key
+    index_t *key;
+    heap_t *h;
+    index_t check;              // sum of the deleted items by position
+    index_t sum;
+} trace_t;
+
+/*
+ * Inserts n items with unique keys base*n + item, then deletes the minimum
+ * until empty, decreasing d random keys after each. A new key lies between
+ * the last minimum and the old key, which keeps the radix heap valid. The
+ * trace is recorded with the compiled heap, unique keys fix its order.
+ */
+trace_t *trace_alloc(index_t n, index_t d, index_t seed)
+{
+    trace_t *tr = (trace_t *) MALLOC(sizeof(trace_t));
+    index_t cap = n + n + n*d;
+    tr->n    = n;
+    tr->len  = 0;
+    tr->item = (index_t *) MALLOC(cap*sizeof(index_t));
+    tr->key  = (index_t *) MALLOC(cap*sizeof(index_t));
+    tr->h    = heap_alloc(n);
+
+    index_t *base = (index_t *) MALLOC(n*sizeof(index_t));
+    char *done    = (char *) MALLOC(n*sizeof(char));
+    ffprng_t gen;
+    FFPRNG_INIT(gen, seed);
+    heap_t *h = tr->h;
+    heap_reset(h);
+    for(index_t v = 0; v < n; v++)
+    {
+        ffprng_scalar_t rnd;
+        FFPRNG_RAND(rnd, gen);
+        base[v] = (index_t) (rnd % (1 << 20)) + 1;
+        done[v] = 0;
+        tr->item[tr->len] = v;
+        tr->key[tr->len++] = base[v]*n + v;
+        heap_insert(h, v, base[v]*n + v);
+    }
+    tr->check = 0;
+    for(index_t i = 0; i < n; i++)
+    {
+        index_t u = heap_delete_min(h);
+        tr->check += i*u;
+        done[u] = 1;
+        tr->item[tr->len] = TRACE_DELETE_MIN;
+        tr->key[tr->len++] = 0;
+        for(index_t j = 0; j < d; j++)
+        {
+            ffprng_scalar_t rnd;
+            FFPRNG_RAND(rnd, gen);
+            index_t v = (index_t) (rnd % n);
+            if(done[v] || base[v] - base[u] <= 1)
+                continue;
+            FFPRNG_RAND(rnd, gen);
+            base[v] = base[u] + 1 + (index_t) (rnd % (base[v] - base[u] - 1));
+            tr->item[tr->len] = v;
+            tr->key[tr->len++] = base[v]*n + v;
+            heap_decrease_key(h, v, base[v]*n + v);
+        }
+    }
+    FREE(base);
+    FREE(done);
+    return tr;
+}
+
+void trace_free(trace_t *tr)
+{
+    heap_free(tr->h);
+    FREE(tr->item);
+    FREE(tr->key);
+    FREE(tr);
+}
+
+static void trace_run(void *arg)
+{
+    trace_t *tr = (trace_t *) arg;
+    heap_t *h = tr->h;
+    index_t n = tr->n;
+    index_t i = 0;
+    heap_reset(h);
+    for(index_t j = 0; j < n; j++, i++)
+        heap_insert(h, tr->item[i], tr->key[i]);
+    index_t deleted = 0;
+    tr->sum = 0;
+    for(; i < tr->len; i++)
+    {
+        if(tr->item[i] == TRACE_DELETE_MIN)
+        {
+            index_t u = heap_delete_min(h);
+            tr->sum += (deleted++)*u;
+        }
+        else
+        {
+            heap_decrease_key(h, tr->item[i], tr->key[i]);
+        }
+    }
+}
+
+static void bench_heap(bench_t *b)
+{
+    index_t quick_n[] = { 1 << 12, 1 << 16 };
+    index_t full_n[]  = { 1 << 12, 1 << 16, 1 << 20 };
+    index_t *ns = b->quick ? quick_n : full_n;
+    index_t nn  = b->quick ? 2 : 3;
+    index_t ds[] = { 1, 4 };
+    for(index_t i = 0; i < nn; i++)
+    {
+        for(index_t j = 0; j < 2; j++)
+        {
+            trace_t *tr = trace_alloc(ns[i], ds[j], 1234567);
+            char name[BENCH_MAX_NAME];
+            sprintf(name, "heap/%s/n=%ld/d=%ld", HEAP_NAME, ns[i], ds[j]);
+            bench_case(b, name, NULL, trace_run, tr);
+            if(tr->sum != tr->check)
+                ERROR("heap trace '%s' replayed out of order", name);
+            trace_free(tr);
+        }
+    }
+}
+
+/************************************************************* Merge kernel. */
+
+typedef struct merge_case
+{
+    index_t n;
+    index_t k;
+    dist_t *f_v;
+    dist_t *f_in;               // the table before the merges
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_v;
+#endif
+} merge_case_t;
+
+static void merge_setup(void *arg)
+{
+    merge_case_t *mc = (merge_case_t *) arg;
+    memcpy(mc->f_v, mc->f_in, mc->n*(1<<mc->k)*sizeof(dist_t));
+}
+
+// the merges of emv_subset for every subset, without the shortest paths
+static void merge_run(void *arg)
+{
+    merge_case_t *mc = (merge_case_t *) arg;
+    index_t n = mc->n;
+    index_t k = mc->k;
+    dist_t *f_v = mc->f_v;
+    for(index_t X = 1; X < (1<<k); X++)
+    {
+        if(__builtin_popcountl(X) < 2)
+            continue;
+        dist_t *f_X = f_v + FV_INDEX(0, n, k, X);
+#ifdef TRACK_OPTIMAL
+        bptr_t *b_X = mc->b_v + BV_INDEX(0, n, k, X);
+#endif
+        index_t lo = X & (-X);
+        index_t R  = X & ~lo;
+        for(index_t v0 = 0; v0 < n; v0 += MERGE_TILE)
+        {
+            index_t v1 = MIN(v0 + MERGE_TILE, n);
+            for(index_t Y = 0; Y != R; Y = (Y - R) & R)
+            {
+                index_t Xd = lo | Y;
+                merge_rows(v0, v1, f_X, f_v + FV_INDEX(0, n, k, Xd),
+                           f_v + FV_INDEX(0, n, k, R & ~Y)
+#ifdef TRACK_OPTIMAL
+                           ,b_X, Xd
+#endif
+                           );
+            }
+        }
+    }
+}
+
+static void bench_merge(bench_t *b)
+{
+    index_t quick_n[] = { 1 << 10, 1 << 12 };
+    index_t full_n[]  = { 1 << 10, 1 << 14, 1 << 18 };
+    index_t quick_k[] = { 6, 8 };
+    index_t full_k[]  = { 6, 8, 10, 12 };
+    index_t *ns = b->quick ? quick_n : full_n;
+    index_t *ks = b->quick ? quick_k : full_k;
+    index_t nn  = b->quick ? 2 : 3;
+    index_t nk  = b->quick ? 2 : 4;
+    for(index_t i = 0; i < nn; i++)
+    {
+        for(index_t j = 0; j < nk; j++)
+        {
+            merge_case_t mc;
+            mc.n = ns[i];
+            mc.k = ks[j];
+            size_t entries = mc.n*(1<<mc.k);
+            if(entries*sizeof(dist_t) > (1UL << 30))
+                continue; // keep the table under 1 GiB
+            mc.f_v  = (dist_t *) MALLOC(entries*sizeof(dist_t));
+            mc.f_in = (dist_t *) MALLOC(entries*sizeof(dist_t));
+#ifdef TRACK_OPTIMAL
+            mc.b_v  = (bptr_t *) MALLOC(entries*sizeof(bptr_t));
+            for(size_t e = 0; e < entries; e++)
+                BV_SET(mc.b_v[e], UNDEFINED, 0);
+#endif
+            // random labels, some unreachable
+            ffprng_t gen;
+            FFPRNG_INIT(gen, 7654321);
+            for(size_t e = 0; e < entries; e++)
+            {
+                ffprng_scalar_t rnd;
+                FFPRNG_RAND(rnd, gen);
+                mc.f_in[e] = (rnd % 16 == 0) ? DIST_INF :
+                                               (dist_t) ((rnd >> 8) % 100000);
+            }
+            char name[BENCH_MAX_NAME];
+            sprintf(name, "merge/%s/n=%ld/k=%ld",
+                          (sizeof(dist_t) == 4) ? "narrow" : "wide",
+                          mc.n, mc.k);
+            bench_case(b, name, merge_setup, merge_run, &mc);
+            FREE(mc.f_v);
+            FREE(mc.f_in);
+#ifdef TRACK_OPTIMAL
+            FREE(mc.b_v);
+#endif
+        }
+    }
+}
+
+/***************************************************************** Dijkstra. */
+
+#define DIJKSTRA_SOURCES 8
+
+typedef struct dijkstra_case
+{
+    steinerq_t *root;
+    dist_t *d;
+    dijkstra_ws_t *ws;
+    index_t s[DIJKSTRA_SOURCES];
+} dijkstra_case_t;
+
+static void dijkstra_run(void *arg)
+{
+    dijkstra_case_t *dc = (dijkstra_case_t *) arg;
+    steinerq_t *root = dc->root;
+    for(index_t i = 0; i < DIJKSTRA_SOURCES; i++)
+    {
+#ifdef TRACK_BANDWIDTH
+        index_t heap_ops = 0;
+#endif
+        dijkstra(root->n, root->m, root->pos, root->adj, dc->s[i], dc->d,
+                 dc->ws
+#ifdef TRACK_BANDWIDTH
+                 ,&heap_ops
+#endif
+                 );
+    }
+}
+
+static void bench_dijkstra(bench_t *b)
+{
+    index_t n = b->quick ? (1 << 14) : (1 << 20);
+    char *types[] = { "regular", "powlaw" };
+    for(index_t i = 0; i < 2; i++)
+    {
+        char cmd[1024];
+        if(i == 0)
+            sprintf(cmd, "%s regular %ld 4 16 1000 1 2>/dev/null", b->gen, n);
+        else
+            sprintf(cmd, "%s powlaw %ld 4 -0.5 %ld 16 1000 1 2>/dev/null",
+                         b->gen, n, n/16);
+        FILE *in = popen(cmd, "r");
+        if(in == NULL)
+            ERROR("unable to run '%s'", cmd);
+        graph_t *g = graph_load(in);
+        if(pclose(in) != 0 || g->n == 0)
+            ERROR("'%s' failed, build graph-gen first", cmd);
+
+        dijkstra_case_t dc;
+        dc.root = root_build(g);
+        graph_free(g);
+        dc.d  = (dist_t *) MALLOC(dc.root->n*sizeof(dist_t));
+        dc.ws = dijkstra_ws_alloc(dc.root->n);
+        ffprng_t gen;
+        FFPRNG_INIT(gen, 24681357);
+        for(index_t j = 0; j < DIJKSTRA_SOURCES; j++)
+        {
+            ffprng_scalar_t rnd;
+            FFPRNG_RAND(rnd, gen);
+            dc.s[j] = (index_t) (rnd % dc.root->n);
+        }
+        char name[BENCH_MAX_NAME];
+        sprintf(name, "dijkstra/%s/%s/n=%ld/m=%ld", HEAP_NAME, types[i],
+                      dc.root->n, dc.root->m);
+        bench_case(b, name, NULL, dijkstra_run, &dc);
+        FREE(dc.d);
+        dijkstra_ws_free(dc.ws);
+        steinerq_free(dc.root);
+    }
+}
+
+/******************************************************* Program entry point. */
+
+int main(int argc, char **argv)
+{
+    bench_t *b = (bench_t *) malloc(sizeof(bench_t));
+    b->repeat    = 10;
+    b->warmup    = 2;
+    b->quick     = 0;
+    b->tolerance = 5.0;
+    b->gen       = "../graph-gen/gen-unique";
+    b->num_base  = 0;
+    b->num_cases = 0;
+    b->regressions = 0;
+    const char *suites = "heap,merge,dijkstra";
+    const char *save = NULL;
+
+    for(index_t f = 1; f < argc; f++)
+    {
+        if(!strcmp(argv[f], "-suite") && f < argc - 1)
+            suites = argv[++f];
+        else if(!strcmp(argv[f], "-repeat") && f < argc - 1)
+            b->repeat = atol(argv[++f]);
+        else if(!strcmp(argv[f], "-warmup") && f < argc - 1)
+            b->warmup = atol(argv[++f]);
+        else if(!strcmp(argv[f], "-quick"))
+            b->quick = 1;
+        else if(!strcmp(argv[f], "-tolerance") && f < argc - 1)
+            b->tolerance = atof(argv[++f]);
+        else if(!strcmp(argv[f], "-gen") && f < argc - 1)
+            b->gen = argv[++f];
+        else if(!strcmp(argv[f], "-baseline") && f < argc - 1)
+            bench_load(b, argv[++f]);
+        else if(!strcmp(argv[f], "-save") && f < argc - 1)
+            save = argv[++f];
+        else
+        {
+            fprintf(stdout, "usage: %s <arguments>\n"
+                    "\n"
+                    "arguments :\n"
+                    "\t-suite <list> : Comma separated suites out of heap, merge, dijkstra\n"
+                    "\t-repeat <r> : Timed rounds per case (default 10)\n"
+                    "\t-warmup <w> : Untimed rounds before them (default 2)\n"
+                    "\t-quick : Small sizes only\n"
+                    "\t-gen <file> : The gen-unique binary (default ../graph-gen/gen-unique)\n"
+                    "\t-baseline <file> : Compare the medians to a stored run\n"
+                    "\t-tolerance <pct> : Slowdown counted as a regression (default 5)\n"
+                    "\t-save <file> : Store the medians of this run\n"
+                    "\n",
+                    argv[0]);
+            free(b);
+            return !strcmp(argv[f], "-h") ? 0 : 1;
+        }
+    }
+
+    b->repeat = MAX(1, b->repeat);
+    b->warmup = MAX(0, b->warmup);
+    fprintf(stdout, "bench: [heap: %s] [table: %ld-bit] [tile: %d] "
+                    "[repeat: %ld] [warmup: %ld]\n",
+                    HEAP_NAME, 8*(index_t) sizeof(dist_t), MERGE_TILE,
+                    b->repeat, b->warmup);
+    if(strstr(suites, "heap") != NULL)
+        bench_heap(b);
+    if(strstr(suites, "merge") != NULL)
+        bench_merge(b);
+    if(strstr(suites, "dijkstra") != NULL)
+        bench_dijkstra(b);
+
+    if(save != NULL)
+        bench_save(b, save);
+    index_t regressions = b->regressions;
+    fprintf(stdout, "bench: [cases: %ld] [regressions: %ld]\n",
+                    b->num_cases, regressions);
+    free(b);
+    return regressions > 0;
+}
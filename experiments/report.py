@@ -152,7 +152,7 @@ def parse_file(input_, output, mode, mtype, deg, argcmd, listsolution, log):
                 n, m, k, inCost, inTime, inPeak, inCurr = _input(line)
             elif line.startswith('root build'):
                 rZero, rPos, rAdj, rTerm, rTotaltime, rPeak, rCurr = _root_build(line)
-            elif line.startswith('erickson'):
+            elif line.startswith('erickson:'):
                 if listsolution:
                     eZero, eKernel, eKernelBw, etraceback, eTotal, eCost, ePeak, eCurr = _erickson_traceback(line)
                 else:
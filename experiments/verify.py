@@ -90,6 +90,7 @@ def cmd_parser():
                    'erickson'])
     g.add_argument('--print', action='store_true')
     g.add_argument('--list', action='store_true')
+    g.add_argument('--batch', action='store_true')
     return parser
 ## end cmd_parser()
 
@@ -146,6 +147,41 @@ def _erickson_listsolution(line):
     return map(lambda string: string.strip(), map(tokens.group, range(1, 9)))
 #end _erickson_listsolution()
 
+def _result(line):
+    regex = re.compile(r'result: \[file: (.*)\] \[n: (.*)\] \[m: (.*)\] \[k: (.*)\] \[threads: (.*)\] \[cost: (.*)\] \[expected: (.*)\] \[status: (.*)\] \[time: (.*) ms\](?: \[log: (.*)\])?', re.M)
+    tokens = regex.search(line)
+    return tokens.group(1), tokens.group(8), tokens.group(10)
+
+def verify_batch(exe, argcmd, list_, batchDir, log):
+    # one run over the current directory, one log per instance
+    outfile = "%s/batch.out"% (batchDir)
+    cmd = "%s -batch . -%s %s -batchlog %s 1>%s 2>&1"% \
+          (exe, argcmd, '-list' if list_ else '', batchDir, outfile)
+    _call(cmd, log)
+    failed = False
+    for line in open(outfile):
+        if not line.startswith('result'):
+            continue
+        testfile, status, logfile = _result(line)
+        _logmsg(log, "STP instance: %s "% (testfile))
+        if status != 'ok':
+            _logerr(log, '\n\n****** %s: testing failed ****\n\n'% (status))
+            failed = True
+        elif list_:
+            inCost, eCost, terminals, edgelist = parse_file(logfile, list_)
+            ret = verify_graph(edgelist, terminals)
+            if(ret == 0):
+                _logmsg(log, "pass\n")
+            else:
+                _logmsg(log, "fail, solution is not a Steiner tree\n")
+                failed = True
+            #end if
+        else:
+            _logmsg(log, "pass\n")
+        #end if
+    #end for
+    return failed
+
 def parse_file(input_, listsolution):
     edgelist = []
     with open(input_, 'r') as infile:
@@ -175,6 +211,7 @@ def main():
     argcmdList = opts['arg_cmd']
     list_  = opts['list']
     print_ = opts['print']
+    batch_ = opts['batch']
 
     globalfail = False
 
@@ -233,6 +270,16 @@ def main():
 
             os.chdir(testsetDir)
             testfileList = glob.glob(os.path.join('*', '*.stp'))
+            if batch_ and not print_:
+                # the whole testset in one batch run of the build
+                batchDir = "%s/batch_%s_%s_%s"% \
+                           (verifyDir, build, argcmd, datetime)
+                if verify_batch(exe, argcmd, list_, batchDir, log):
+                    failed = True
+                    globalfail = True
+                #end if
+                testfileList = []
+            #end if
 
             for testfile in testfileList:
                 if list_:
@@ -52,6 +52,7 @@
 #include<stdarg.h>
 #include<assert.h>
 #include<math.h>
+#include<stdint.h>
 
 #include<omp.h>
 
@@ -128,6 +129,12 @@ void free_wrapper(const char *id, void *p)
 #endif
 }
 
+index_t *alloc_idxtab(index_t n)
+{
+    index_t *t = (index_t *) MALLOC("t", sizeof(index_t)*n);
+    return t;
+}
+
 void shellsort(index_t n, index_t *a)
 {
     index_t h = 1;
@@ -241,7 +248,57 @@ void graph_set_target(graph_t *g, index_t k, index_t *kk)
         g->terminals[j] = kk[j];
 }
 
-void graph_out_dimacs(FILE *out, graph_t *g, index_t w, index_t seed)
+/*
+ * Edge i weighs 1 + (r_i mod w) for the i-th value r_i of one stream, so 
+ * a thread forwards the stream to the start of its block and all outputs
+ * get the same weights whatever the thread count.
+ */
+
+index_t *graph_weights(graph_t *g, index_t w, index_t seed)
+{
+    index_t m = g->num_edges;
+    index_t *wt = alloc_idxtab(m);
+#ifdef BUILD_PARALLEL
+    index_t nt = omp_get_max_threads();
+#else
+    index_t nt = 1;
+#endif
+    ffprng_t base;
+    FFPRNG_INIT(base, (seed^0x5A3C96E1F00FB4D2L));
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t t = 0; t < nt; t++) {
+        index_t start = (m*t)/nt;
+        index_t stop = (m*(t+1))/nt;
+        ffprng_t gen;
+        FFPRNG_FWD(gen, start, base);
+        for(index_t i = start; i < stop; i++) {
+            ffprng_scalar_t rnd;
+            FFPRNG_RAND(rnd, gen);
+            wt[i] = (index_t) (rnd%((ffprng_scalar_t) w))+1;
+        }
+    }
+    return wt;
+}
+
+#define OUT_CHUNK 16384 // edge lines formatted per thread and round
+#define OUT_LINE  72    // "e u v w\n" with 64-bit values
+
+static char *put_index(char *p, index_t x)
+{
+    char d[24];
+    index_t l = 0;
+    do {
+        d[l++] = '0' + (x % 10);
+        x /= 10;
+    } while(x > 0);
+    while(l > 0)
+        *p++ = d[--l];
+    return p;
+}
+
+void graph_out_dimacs(FILE *out, graph_t *g, index_t *wt)
 {
     index_t n = g->num_vertices;
     index_t m = g->num_edges;
@@ -250,14 +307,44 @@ void graph_out_dimacs(FILE *out, graph_t *g, index_t w, index_t seed)
     index_t *kk = g->terminals;
     fprintf(out, "section graph\n");
     fprintf(out, "nodes %ld\nedges %ld\n", (long) n, (long) m);
-    srand(seed);
-    for(index_t i = 0; i < m; i++)
-    {
-        fprintf(out, "e %ld %ld %ld\n", 
-                     (long) e[2*i+0]+1, 
-                     (long) e[2*i+1]+1, 
-                     ((long)rand()%w)+1);
+
+    // threads format consecutive chunks, the chunks go out in order
+#ifdef BUILD_PARALLEL
+    index_t nt = omp_get_max_threads();
+#else
+    index_t nt = 1;
+#endif
+    char *buf = (char *) MALLOC("buf", nt*OUT_CHUNK*OUT_LINE);
+    index_t len[nt];
+    for(index_t r = 0; r < m; r += nt*OUT_CHUNK) {
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+        for(index_t t = 0; t < nt; t++) {
+            index_t start = r + t*OUT_CHUNK;
+            index_t stop = start + OUT_CHUNK;
+            if(stop > m)
+                stop = m;
+            char *p = buf + t*OUT_CHUNK*OUT_LINE;
+            for(index_t i = start; i < stop; i++) {
+                *p++ = 'e';
+                *p++ = ' ';
+                p = put_index(p, e[2*i+0]+1);
+                *p++ = ' ';
+                p = put_index(p, e[2*i+1]+1);
+                *p++ = ' ';
+                p = put_index(p, wt[i]);
+                *p++ = '\n';
+            }
+            len[t] = p - (buf + t*OUT_CHUNK*OUT_LINE);
+        }
+        for(index_t t = 0; t < nt; t++)
+            if(len[t] > 0 && 
+               fwrite(buf + t*OUT_CHUNK*OUT_LINE, 1, len[t], out) != 
+               (size_t) len[t])
+                ERROR("write fails");
     }
+    FREE("buf", buf);
     fprintf(out, "end\n\n");
 
     //for(index_t i = 0; i < n; i++)
@@ -272,6 +359,182 @@ void graph_out_dimacs(FILE *out, graph_t *g, index_t w, index_t seed)
     fprintf(out, "eof\n");
 }
 
+/*
+ * The binary snapshot of 'reader-el -bin': a header, the terminals, then
+ * the adjacency arrays exactly as the root build of the reader lays them
+ * out, the arcs of a vertex in edge order. The default layout interleaves
+ * a degree header with (neighbour, weight) pairs, the compact layout of a
+ * COMPACT_GRAPH build has n+1 offsets and 32-bit neighbour and weight 
+ * arrays. Keep in sync with 'Binary snapshots' in reader-el.c.
+ */
+
+#define SNAPSHOT_MAGIC   0x31525343564d45L // "EMVCSR1"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_COMPACT 0x01
+
+typedef struct
+{
+    index_t magic;
+    index_t version;
+    index_t index_bytes;
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t cost;
+    index_t layout;
+} snapshot_header_t;
+
+void graph_out_snapshot(FILE *out, graph_t *g, index_t *wt, index_t compact)
+{
+    index_t n = g->num_vertices;
+    index_t m = g->num_edges;
+    index_t k = g->num_terminals;
+    index_t *e = g->edges;
+    if(n < 1 || m < 1 || k < 1)
+        ERROR("a snapshot needs vertices, edges and terminals");
+    if(compact) {
+        if(n > (index_t) UINT32_MAX)
+            ERROR("n = %ld does not fit the compact layout", n);
+        for(index_t i = 0; i < m; i++)
+            if(wt[i] > (index_t) UINT32_MAX)
+                ERROR("edge weight %ld does not fit the compact layout", 
+                      wt[i]);
+    }
+#ifdef BUILD_PARALLEL
+    index_t nt = omp_get_max_threads();
+#else
+    index_t nt = 1;
+#endif
+
+    /* 
+     * Bucket the 2m edge ends by the vertex block of their endpoint: 
+     * thread t counts the ends of its edge chunk per block, a prefix sum
+     * over (block, chunk) places them, and then thread b owns block b. The
+     * ends of a block stay in edge order. End 2*j is the u end and 2*j+1
+     * the v end of edge j.
+     */
+    index_t block_size = n/nt;
+    index_t *cnt = alloc_idxtab(nt*nt);
+    index_t *ends = alloc_idxtab(2*m);
+    index_t *deg = alloc_idxtab(n);
+#define VERTEX_BLOCK(u) ((block_size == 0) ? nt-1 : \
+                         ((u)/block_size < nt-1 ? (u)/block_size : nt-1))
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t t = 0; t < nt; t++) {
+        index_t *cnt_t = cnt + t*nt;
+        for(index_t b = 0; b < nt; b++)
+            cnt_t[b] = 0;
+        for(index_t j = (m*t)/nt; j < (m*(t+1))/nt; j++) {
+            cnt_t[VERTEX_BLOCK(e[2*j+1])]++;
+            cnt_t[VERTEX_BLOCK(e[2*j])]++;
+        }
+    }
+    index_t *bstart = alloc_idxtab(nt+1);
+    index_t run = 0;
+    for(index_t b = 0; b < nt; b++) {
+        bstart[b] = run;
+        for(index_t t = 0; t < nt; t++) {
+            index_t c = cnt[t*nt+b];
+            cnt[t*nt+b] = run;
+            run += c;
+        }
+    }
+    bstart[nt] = run;
+    assert(run == 2*m);
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t t = 0; t < nt; t++) {
+        index_t *cnt_t = cnt + t*nt;
+        for(index_t j = (m*t)/nt; j < (m*(t+1))/nt; j++) {
+            ends[cnt_t[VERTEX_BLOCK(e[2*j+1])]++] = 2*j+1;
+            ends[cnt_t[VERTEX_BLOCK(e[2*j])]++] = 2*j;
+        }
+    }
+#undef VERTEX_BLOCK
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t u = 0; u < n; u++)
+        deg[u] = 0;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t b = 0; b < nt; b++)
+        for(index_t i = bstart[b]; i < bstart[b+1]; i++)
+            deg[e[ends[i]]]++;
+
+    // offsets, the default layout has a degree slot ahead of the pairs
+    index_t len_pos = compact ? n+1 : n;
+    index_t len_adj = compact ? 4*m : n+4*m;
+    index_t *pos = alloc_idxtab(len_pos);
+    run = 0;
+    for(index_t u = 0; u < n; u++) {
+        pos[u] = run;
+        run += compact ? deg[u] : 1+2*deg[u];
+    }
+    if(compact)
+        pos[n] = run;
+    void *adj = MALLOC("adj", compact ? len_adj*sizeof(uint32_t) : 
+                                        len_adj*sizeof(index_t));
+
+    // the degree headers, then deg holds the next free slot of each vertex
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t u = 0; u < n; u++) {
+        if(!compact)
+            ((index_t *) adj)[pos[u]] = deg[u];
+        deg[u] = compact ? pos[u] : pos[u]+1;
+    }
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t b = 0; b < nt; b++) {
+        for(index_t i = bstart[b]; i < bstart[b+1]; i++) {
+            index_t j = ends[i] >> 1;
+            index_t u = e[ends[i]];
+            index_t v = e[ends[i]^1];
+            index_t p = deg[u];
+            if(compact) {
+                deg[u] += 1;
+                ((uint32_t *) adj)[p] = (uint32_t) v;
+                ((uint32_t *) adj)[p+2*m] = (uint32_t) wt[j];
+            } else {
+                deg[u] += 2;
+                ((index_t *) adj)[p] = v;
+                ((index_t *) adj)[p+1] = wt[j];
+            }
+        }
+    }
+    FREE("bstart", bstart);
+    FREE("ends", ends);
+    FREE("cnt", cnt);
+    FREE("deg", deg);
+
+    snapshot_header_t h;
+    memset(&h, 0, sizeof(h));
+    h.magic       = SNAPSHOT_MAGIC;
+    h.version     = SNAPSHOT_VERSION;
+    h.index_bytes = sizeof(index_t);
+    h.n           = n;
+    h.m           = m;
+    h.k           = k;
+    h.cost        = g->cost;
+    h.layout      = compact ? SNAPSHOT_COMPACT : 0;
+    size_t adj_bytes = compact ? len_adj*sizeof(uint32_t) : 
+                                 len_adj*sizeof(index_t);
+    if(fwrite(&h, sizeof(h), 1, out) != 1 ||
+       fwrite(g->terminals, sizeof(index_t), k, out) != (size_t) k ||
+       fwrite(pos, sizeof(index_t), len_pos, out) != (size_t) len_pos ||
+       fwrite(adj, 1, adj_bytes, out) != adj_bytes)
+        ERROR("write fails");
+    FREE("pos", pos);
+    FREE("adj", adj);
+}
+
 #define BIN_MAGIC 0x1234567890ABCDEFUL
 
 #define CMD_TEST_UNIQUE 1
@@ -319,38 +582,37 @@ void randperm(index_t n, index_t *p, index_t seed)
         }
     }    
 
+    // chunk t places its items of a bin after those of the chunks before
+    index_t b[129];
+    index_t run = 0;
     for(index_t bin = 0; bin < nt; bin++) {
-        for(index_t t = 1; t < nt; t++) {
-            f[0][bin] += f[t][bin];
+        b[bin] = run;
+        for(index_t t = 0; t < nt; t++) {
+            index_t fp = f[t][bin];
+            f[t][bin] = run;
+            run += fp;
         }
     }
-    index_t run = 0;
-    for(index_t j = 1; j <= nt; j++) {
-        index_t fp = f[0][j-1];
-        f[0][j-1] = run;
-        run += fp;
-    }
-    f[0][nt] = run;
+    b[nt] = run;
 
     FFPRNG_INIT(base, seed);    
 #ifdef BUILD_PARALLEL
 #pragma omp parallel for
 #endif
     for(index_t t = 0; t < nt; t++) {
+        index_t start = t*block_size;
+        index_t stop = (t == nt-1) ? n-1 : (start+block_size-1);
         ffprng_t gen;
-        index_t start = 0;
-        index_t stop = n-1;
-        index_t pos = f[0][t];
         FFPRNG_FWD(gen, start, base);
         for(index_t i = start; i <= stop; i++) {
             ffprng_scalar_t rnd;
             FFPRNG_RAND(rnd, gen);
             index_t bin = (index_t) ((unsigned long) rnd)%((unsigned long)nt);
-            if(bin == t)
-                p[pos++] = i;
+            p[f[t][bin]++] = i;
         }
-        assert(pos == f[0][t+1]);
     }
+    for(index_t t = 0; t <= nt; t++)
+        f[0][t] = b[t];
 
     FFPRNG_INIT(base, (seed^0x9078563412EFDCABL));    
 #ifdef BUILD_PARALLEL
@@ -368,12 +630,6 @@ void randperm(index_t n, index_t *p, index_t seed)
     }
 }
 
-index_t *alloc_idxtab(index_t n)
-{
-    index_t *t = (index_t *) MALLOC("t", sizeof(index_t)*n);
-    return t;
-}
-
 index_t *alloc_randperm(index_t n, index_t seed)
 {
     index_t *p = alloc_idxtab(n);
@@ -489,11 +745,15 @@ graph_t *graph_config_rand(index_t n, index_t ndd, index_t *degree, index_t *fre
     index_t pos = 0;
     index_t vno = 0;
     for(index_t j = 0; j < ndd; j++) {
-        for(index_t k = 0; k < freq[j]; k++) {
+        // the vertices of a degree class own consecutive incidences
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+        for(index_t k = 0; k < freq[j]; k++)
             for(index_t l = 0; l < degree[j]; l++)
-                vertex_id[pos++] = vno;
-            vno++;
-        }
+                vertex_id[pos+k*degree[j]+l] = vno+k;
+        pos += freq[j]*degree[j];
+        vno += freq[j];
     }
     index_t *vertex_shuffle = alloc_randperm(n, seed);
     index_t *incidence_shuffle = alloc_randperm(num_incidences, seed);
@@ -584,6 +844,12 @@ int main(int argc, char **argv)
                 "  powlaw  <n> <d> <al> <w> <k> <ew> <seed>  (with al < 0.0, 2 <= w <= n, 1 <= k <= n)\n"
                 "  clique  <n> <d> <k> <ew> <seed>           (with 1 <= k <= n)\n"
                 "\n"
+                "output formats (last argument, the default is -ascii):\n"
+                "\n"
+                "  -ascii     DIMACS STP text\n"
+                "  -bin       binary snapshot for 'reader-el -bin'\n"
+                "  -compact   binary snapshot for the COMPACT_GRAPH builds\n"
+                "\n"
                 ,
                 argv[0]);
         return 0;
@@ -598,6 +864,14 @@ int main(int argc, char **argv)
     index_t ew = 0;
     graph_t *g = (graph_t *) 0;
 
+    // the format flags follow the positional arguments
+    const char *format = "ascii";
+    for(index_t f = 2; f < argc; f++) {
+        if(!strcmp(argv[f], "-ascii") || !strcmp(argv[f], "-bin") ||
+           !strcmp(argv[f], "-compact"))
+            format = argv[f] + 1;
+    }
+
     char *type = argv[1];
     if(!strcmp("regular", type)) { 
         assert(argc-2 >= 5);
@@ -640,7 +914,16 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    graph_out_dimacs(stdout, g, ew, seed);
+    double start = omp_get_wtime();
+    index_t *wt = graph_weights(g, ew, seed);
+    if(!strcmp(format, "ascii"))
+        graph_out_dimacs(stdout, g, wt);
+    else
+        graph_out_snapshot(stdout, g, wt, !strcmp(format, "compact"));
+    fflush(stdout);
+    FREE("wt", wt);
+    fprintf(stderr, "output [%s]: %.2lf ms\n", format, 
+                    1000.0*(omp_get_wtime() - start));
 
     fprintf(stderr, "gen-unique [%s]: n = %ld, m = %ld, k = %ld, cost = %ld, seed = %ld\n", 
             type,
@@ -0,0 +1,47 @@
+#!/bin/bash
+##
+ # Regression checks of the reader builds, run by 'make check'. Each check
+ # prints one line, the script fails if any of them does.
+ ##
+
+READER=${READER:-./READER_BIN_OPT_PAR}
+DELTA=${DELTA:-./READER_BIN_OPT_PAR_DELTA}
+SERIAL=${SERIAL:-./READER_BIN}
+TESTSET=${TESTSET:-../testset}
+fail=0
+
+cost_of() { grep -o "\[cost: [0-9-]*\]" | tail -1 | grep -o "[0-9-]*"; }
+known_of() { grep -o "cost = [0-9-]*" | head -1 | grep -o "[0-9-]*"; }
+
+check() {
+    if [ "$2" == "$3" ]; then
+        echo "check: $1 ok"
+    else
+        echo "check: $1 FAILED [$2 vs $3]"
+        fail=1
+    fi
+}
+
+# CRLF line ends and upper case keywords, through both loaders
+for f in $TESTSET/crlf/*.stp; do
+    known=`$READER -el -in $f | known_of`
+    check "$f mmap" `$READER -el -in $f | cost_of` $known
+    check "$f stream" `$READER -el < $f | cost_of` $known
+done
+
+# delta-stepping on the levels with fewer subsets than threads, its 
+# queues grow while the threads run
+for f in $TESTSET/small-instances/E/e01.stp $TESTSET/small-instances/E/e07.stp; do
+    known=`$READER -el -in $f | known_of`
+    check "$f delta" `OMP_NUM_THREADS=4 $DELTA -el -in $f | cost_of` $known
+    check "$f delta list" `OMP_NUM_THREADS=4 $DELTA -el -list -in $f | \
+                           cost_of` $known
+done
+
+# the task scheduler of a serial build, its thread is thread 0
+for f in $TESTSET/small-instances/E/e01.stp; do
+    known=`$READER -el -in $f | known_of`
+    check "$f serial tasks" `$SERIAL -el -tasks -in $f | cost_of` $known
+done
+
+exit $fail
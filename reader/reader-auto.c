@@ -0,0 +1,571 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * One binary with the multi-threaded builds of reader-el. The Makefile
+ * compiles reader-el.c once per configuration with its entry point renamed
+ * to reader_main_<variant> and all other symbols made local, so that the
+ * builds link side by side. This front end picks a build at run time, by
+ * the -heap, -width, -graph and -traceback flags or, with -auto, by a
+ * calibration run of the candidate builds on the input graph, and passes
+ * the remaining arguments on to it.
+ *
+ * The choice with -auto:
+ *   - the traceback is stored with -list, none otherwise
+ *   - 32-bit tables when the total edge weight fits, the compact graph
+ *     layout when the snapshot input has it
+ *   - every candidate runs -calibrate in a child process, one thread, and
+ *     its estimate is 2^kt Dijkstra runs and (3^kt - 2^(kt+1) + 1)/2 row
+ *     merges on p threads, candidates whose table does not fit in memory
+ *     are passed over
+ *   - p is the number of processors, at most the widest level of the
+ *     table, and one for tables under AUTO_SMALL entries
+ *
+ */
+
+#define _GNU_SOURCE // mkstemp, fdopen
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdarg.h>
+#include<unistd.h>
+#include<sys/wait.h>
+
+#include<omp.h>
+
+typedef long int index_t;
+
+#define ERROR(...) error(__FILE__,__LINE__,__func__,__VA_ARGS__);
+
+static void error(const char *fn, int line, const char *func,
+                  const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr,
+            "ERROR [file = %s, line = %d] "
+            "%s: ",
+            fn,
+            line,
+            func);
+    vfprintf(stderr, format, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    abort();
+}
+
+#define MIN(x,y) ((x)<(y) ? (x) : (y))
+#define MAX(x,y) ((x)>(y) ? (x) : (y))
+
+/***************************************************************** Variants. */
+
+#define HEAP_BIN       0
+#define HEAP_FIB       1
+#define HEAP_RADIX     2
+
+#define TRACE_NONE      0
+#define TRACE_STORE     1 // TRACK_OPTIMAL, back-pointer table
+#define TRACE_RECOMPUTE 2 // RECOMPUTE_OPTIMAL
+
+/*
+ * name, heap, table width, compact graph, traceback. The objects of the
+ * builds are listed in AUTO_OBJ of the Makefile, keep the two in sync.
+ */
+#define VARIANTS(X) \
+    X(BIN_PAR,             HEAP_BIN,   64, 0, TRACE_NONE)      \
+    X(BIN_OPT_PAR,         HEAP_BIN,   64, 0, TRACE_STORE)     \
+    X(BIN_REC_PAR,         HEAP_BIN,   64, 0, TRACE_RECOMPUTE) \
+    X(FIB_PAR,             HEAP_FIB,   64, 0, TRACE_NONE)      \
+    X(FIB_OPT_PAR,         HEAP_FIB,   64, 0, TRACE_STORE)     \
+    X(RAD_PAR,             HEAP_RADIX, 64, 0, TRACE_NONE)      \
+    X(RAD_OPT_PAR,         HEAP_RADIX, 64, 0, TRACE_STORE)     \
+    X(BIN_NAR_PAR,         HEAP_BIN,   32, 0, TRACE_NONE)      \
+    X(BIN_NAR_OPT_PAR,     HEAP_BIN,   32, 0, TRACE_STORE)     \
+    X(BIN_NAR_REC_PAR,     HEAP_BIN,   32, 0, TRACE_RECOMPUTE) \
+    X(BIN_CMP_OPT_PAR,     HEAP_BIN,   64, 1, TRACE_STORE)     \
+    X(BIN_NAR_CMP_OPT_PAR, HEAP_BIN,   32, 1, TRACE_STORE)
+
+#define VARIANT_DECLARE(name, heap, width, compact, trace) \
+    int reader_main_##name(int argc, char **argv);
+VARIANTS(VARIANT_DECLARE)
+
+typedef struct variant
+{
+    const char *name;
+    int (*entry)(int, char **);
+    index_t heap;
+    index_t width;
+    index_t compact;
+    index_t trace;
+} variant_t;
+
+#define VARIANT_ENTRY(name, heap, width, compact, trace) \
+    { "READER_" #name, reader_main_##name, heap, width, compact, trace },
+static variant_t variants[] = { VARIANTS(VARIANT_ENTRY) };
+
+#define NUM_VARIANTS ((index_t) (sizeof(variants)/sizeof(variant_t)))
+
+static const char *heap_legend[]  = { "bin", "fib", "radix" };
+static const char *trace_legend[] = { "none", "store", "recompute" };
+
+static index_t parse_choice(const char *s, const char **legend, index_t len)
+{
+    for(index_t i = 0; i < len; i++)
+        if(!strcmp(s, legend[i]))
+            return i;
+    ERROR("unknown choice '%s'", s);
+    return -1;
+}
+
+/*
+ * The build agrees with the choices, -1 for any. Runs without -list take a
+ * build without traceback, or any build when there is none with the
+ * choices (any_trace).
+ */
+static index_t admissible(variant_t *u, index_t heap, index_t width,
+                          index_t compact, index_t trace, index_t list_soln,
+                          index_t any_trace)
+{
+    if((heap != -1 && u->heap != heap) ||
+       (width != -1 && u->width != width) ||
+       (compact != -1 && u->compact != compact))
+        return 0;
+    if(list_soln)
+        return u->trace != TRACE_NONE && (trace == -1 || u->trace == trace);
+    return any_trace ? (trace == -1 || u->trace == trace) :
+                       u->trace == TRACE_NONE;
+}
+
+static index_t admissible_any(index_t heap, index_t width, index_t compact,
+                              index_t trace, index_t list_soln,
+                              index_t any_trace)
+{
+    for(index_t i = 0; i < NUM_VARIANTS; i++)
+        if(admissible(variants + i, heap, width, compact, trace, list_soln,
+                      any_trace))
+            return 1;
+    return 0;
+}
+
+/************************************************************** Calibration. */
+
+#define AUTO_SMALL (1L << 16) // table entries below which one thread runs
+
+typedef struct calibration
+{
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t weight;
+    index_t w_max;
+    double dijkstra;   // ms per run
+    double merge;      // ms per merge of two rows
+} calibration_t;
+
+/*
+ * Runs 'variant -calibrate' in a child on one thread and parses its report,
+ * returns 0 if that fails. The child keeps a crash or an ERROR of the 
+ * build out of the dispatcher, which then goes on without the figures.
+ */
+static index_t calibrate_variant(variant_t *v, const char *file, 
+                                 index_t seed, calibration_t *c)
+{
+    int fd[2];
+    if(pipe(fd) != 0)
+    {
+        fprintf(stdout, "auto: %s [calibrate: pipe failed]\n", v->name);
+        return 0;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0)
+    {
+        close(fd[0]);
+        close(fd[1]);
+        fprintf(stdout, "auto: %s [calibrate: fork failed]\n", v->name);
+        return 0;
+    }
+    if(pid == 0)
+    {
+        close(fd[0]);
+        if(dup2(fd[1], STDOUT_FILENO) < 0)
+            _exit(1);
+        close(fd[1]);
+        char seed_arg[32];
+        sprintf(seed_arg, "%ld", seed);
+        char *args[] = { (char *) v->name, "-calibrate", "-seed", seed_arg,
+                         "-in", (char *) file, NULL };
+        omp_set_num_threads(1);
+        int status = v->entry(6, args);
+        fflush(stdout);
+        _exit(status);
+    }
+    close(fd[1]);
+    FILE *in = fdopen(fd[0], "r");
+    char line[1024];
+    index_t found = 0;
+    while(fgets(line, sizeof(line), in) != NULL)
+    {
+        if(sscanf(line, "calibrate: [n: %ld] [m: %ld] [k: %ld] [weight: %ld "
+                        "max %ld] [dijkstra: %lf ms] [merge: %lf ms]",
+                  &c->n, &c->m, &c->k, &c->weight, &c->w_max, &c->dijkstra,
+                  &c->merge) == 7)
+            found = 1;
+    }
+    fclose(in);
+    int status;
+    if(waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+       WEXITSTATUS(status) != 0 || !found)
+    {
+        fprintf(stdout, "auto: %s [calibrate: failed]\n", v->name);
+        return 0;
+    }
+    return 1;
+}
+
+static index_t choose(index_t n, index_t k)
+{
+    index_t r = 1;
+    for(index_t i = 1; i <= k; i++)
+        r = r*(n-k+i)/i;
+    return r;
+}
+
+// table bytes of a build, cost labels and the back-pointers if stored
+static double table_bytes(variant_t *v, index_t n, index_t kt)
+{
+    double entry = v->width/8 + ((v->trace == TRACE_STORE) ? v->width/4 : 0);
+    return entry*n*(double) (1L << kt);
+}
+
+// the input is a snapshot, layout is set to its adjacency layout
+static index_t probe_snapshot(const char *file, index_t *layout)
+{
+    // header of reader-el.c: magic, version, index bytes, n, m, k, cost,
+    // layout
+    index_t h[8];
+    FILE *in = fopen(file, "rb");
+    if(in == NULL)
+        ERROR("unable to open file '%s'", file);
+    index_t ok = fread(h, sizeof(h), 1, in) == 1 &&
+                 h[0] == 0x31525343564d45L;
+    fclose(in);
+    *layout = ok ? (h[7] & 0x01) : 0;
+    return ok;
+}
+
+/*
+ * stdin goes to a scratch file, the candidates read it one after another.
+ * NULL if there is no scratch file, stdin is then left unread. Once it is
+ * read there is no going back, so a failed write is an error.
+ */
+static char *spool_stdin(void)
+{
+    const char *dir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    char *path = (char *) malloc(strlen(dir) + 32);
+    sprintf(path, "%s/reader-auto.XXXXXX", dir);
+    int fd = mkstemp(path);
+    FILE *out = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if(out == NULL)
+    {
+        if(fd >= 0)
+        {
+            close(fd);
+            unlink(path);
+        }
+        fprintf(stdout, "auto: unable to create a scratch file in '%s'\n", 
+                        dir);
+        free(path);
+        return NULL;
+    }
+    char buf[1 << 16];
+    size_t len;
+    while((len = fread(buf, 1, sizeof(buf), stdin)) > 0)
+        if(fwrite(buf, 1, len, out) != len)
+            ERROR("unable to write '%s'", path);
+    fclose(out);
+    return path;
+}
+
+/****************************************************** Program entry point. */
+
+int main(int argc, char **argv)
+{
+    index_t heap = -1;
+    index_t width = -1;
+    index_t compact = -1;
+    index_t trace = -1;
+    index_t threads = 0;
+    index_t autotune = 0;
+    const char *name = NULL;
+    index_t list_soln = 0;
+    index_t nonroot = 0;
+    index_t many = 0;   // batch runs and query servers, no single instance
+    const char *file = NULL;
+    index_t seed = 123456789;
+
+    // own flags are taken out, the rest goes to the build
+    char **args = (char **) malloc((argc+3)*sizeof(char *));
+    int nargs = 0;
+    args[nargs++] = argv[0];
+    for(int f = 1; f < argc; f++)
+    {
+        const char *a = argv[f];
+        index_t has_val = f < argc-1;
+        if(!strcmp(a, "-auto"))
+            autotune = 1;
+        else if(!strcmp(a, "-variant") && has_val)
+            name = argv[++f];
+        else if(!strcmp(a, "-heap") && has_val)
+            heap = parse_choice(argv[++f], heap_legend, 3);
+        else if(!strcmp(a, "-width") && has_val)
+            width = atol(argv[++f]);
+        else if(!strcmp(a, "-graph") && has_val)
+            compact = !strcmp(argv[++f], "compact");
+        else if(!strcmp(a, "-traceback") && has_val)
+            trace = parse_choice(argv[++f], trace_legend, 3);
+        else if(!strcmp(a, "-threads") && has_val)
+            threads = atol(argv[++f]);
+        else if(!strcmp(a, "-variants"))
+        {
+            for(index_t i = 0; i < NUM_VARIANTS; i++)
+                fprintf(stdout, "%-28s heap: %-5s width: %ld graph: %-7s "
+                                "traceback: %s\n", variants[i].name,
+                                heap_legend[variants[i].heap],
+                                variants[i].width,
+                                variants[i].compact ? "compact" : "default",
+                                trace_legend[variants[i].trace]);
+            return 0;
+        }
+        else
+        {
+            if(!strcmp(a, "-list"))
+                list_soln = 1;
+            if(!strcmp(a, "-nonroot"))
+                nonroot = 1;
+            if(!strcmp(a, "-serve") || !strcmp(a, "-port") ||
+               !strcmp(a, "-batch"))
+                many = 1;
+            if(!strcmp(a, "-in") && has_val)
+                file = argv[f+1];
+            if(!strcmp(a, "-seed") && has_val)
+                seed = atol(argv[f+1]);
+            if(!strcmp(a, "-h") || !strcmp(a, "-help"))
+                fprintf(stdout,
+                        "usage: %s <arguments of reader-el> <choices>\n"
+                        "\n"
+                        "choices :\n"
+                        "\t-auto : Pick the build by a calibration run\n"
+                        "\t-variant <name> : Run the named build\n"
+                        "\t-variants : List the builds\n"
+                        "\t-heap <bin|fib|radix> : Priority queue of Dijkstra\n"
+                        "\t-width <32|64> : Bits of a table entry\n"
+                        "\t-graph <default|compact> : Adjacency layout\n"
+                        "\t-traceback <store|recompute> : Tree of -list\n"
+                        "\t-threads <n> : Number of threads\n"
+                        "\n",
+                        argv[0]);
+            args[nargs++] = argv[f];
+        }
+    }
+    args[nargs] = NULL;
+
+    double start = omp_get_wtime();
+    variant_t *v = NULL;
+    char *spool = NULL;
+    index_t layout = 0;
+    if(file != NULL)
+        probe_snapshot(file, &layout);
+    if(name != NULL)
+    {
+        for(index_t i = 0; i < NUM_VARIANTS; i++)
+            if(!strcmp(variants[i].name, name) ||
+               !strcmp(variants[i].name + strlen("READER_"), name))
+                v = variants + i;
+        if(v == NULL)
+            ERROR("no build '%s', see -variants", name);
+    }
+    else if(autotune && many && file == NULL)
+    {
+        fprintf(stdout, "auto: no input graph to calibrate on, the choices "
+                        "and defaults decide\n");
+        autotune = 0;
+    }
+    // without a scratch file or the figures of the graph, the choices and
+    // the defaults decide as they do without -auto
+    if(v == NULL && autotune && file == NULL)
+    {
+        spool = spool_stdin();
+        if(spool == NULL)
+        {
+            fprintf(stdout, "auto: no input graph to calibrate on, the "
+                            "choices and defaults decide\n");
+            autotune = 0;
+        }
+        else
+        {
+            file = spool;
+            probe_snapshot(file, &layout);
+            // the builds read the spooled input as a file
+            int j = 1;
+            for(int i = 1; i < nargs; i++)
+                if(strcmp(args[i], "-bin"))
+                    args[j++] = args[i];
+            nargs = j;
+            args[nargs++] = "-in";
+            args[nargs++] = spool;
+            args[nargs] = NULL;
+        }
+    }
+    calibration_t c[NUM_VARIANTS];
+    index_t first = -1;
+    if(v == NULL && autotune)
+    {
+        if(compact == -1)
+            compact = layout;
+
+        // figures of the graph from a build that reads any input
+        for(index_t i = 0; i < NUM_VARIANTS && first == -1; i++)
+            if(variants[i].compact == compact && variants[i].width == 64 &&
+               variants[i].heap == HEAP_BIN)
+                first = i;
+        if(!calibrate_variant(variants + first, file, seed, c + first))
+        {
+            fprintf(stdout, "auto: no figures of the graph, the choices "
+                            "and defaults decide\n");
+            autotune = 0;
+        }
+    }
+    if(v == NULL && autotune)
+    {
+        index_t n  = c[first].n;
+        index_t kt = nonroot ? c[first].k-1 : c[first].k;
+        index_t narrow = c[first].weight < 0x7FFFFFFFL && n < 0xFFFFFFFFL;
+
+        double mem = (double) sysconf(_SC_PHYS_PAGES)*sysconf(_SC_PAGESIZE);
+        index_t procs = omp_get_num_procs();
+        index_t p = (threads > 0) ? threads :
+                    (n*(1L << kt) < AUTO_SMALL) ? 1 :
+                    MIN(procs, MAX(1, choose(kt, kt/2)));
+        double merges = 1;
+        for(index_t i = 0; i < kt; i++)
+            merges *= 3;
+        merges = 0.5*(merges - 2*(double) (1L << kt) + 1);
+        index_t best = -1;
+        double best_est = 0;
+        index_t any_trace = !admissible_any(heap, width, compact, trace,
+                                            list_soln, 0);
+        for(index_t i = 0; i < NUM_VARIANTS; i++)
+        {
+            variant_t *u = variants + i;
+            if(!admissible(u, heap, width, compact, trace, list_soln,
+                           any_trace) ||
+               (width == -1 && u->width == 32 && !narrow))
+                continue;
+            if(i != first && !calibrate_variant(u, file, seed, c + i))
+                continue;
+            double bytes = table_bytes(u, n, kt);
+            double est = ((1L << kt)*c[i].dijkstra + merges*c[i].merge)/p;
+            index_t fits = bytes < 0.8*mem;
+            fprintf(stdout, "auto: %s [dijkstra: %.4lf ms] [merge: %.4lf ms] "
+                            "[table: %.2lfGiB%s] [estimate: %.2lf ms]\n",
+                            u->name, c[i].dijkstra, c[i].merge,
+                            bytes/(1 << 30), fits ? "" : " too large", est);
+            // prefer what fits, then the faster, then the smaller table
+            if(!fits)
+                est += 1e300*(bytes/mem);
+            if(best == -1 || est < best_est)
+            {
+                best = i;
+                best_est = est;
+            }
+        }
+        if(best == -1)
+        {
+            fprintf(stdout, "auto: no build calibrated, the choices and "
+                            "defaults decide\n");
+        }
+        else
+        {
+            v = variants + best;
+            threads = p;
+            fprintf(stdout, "auto: [n: %ld] [m: %ld] [k: %ld] [weight: %ld] "
+                            "[calibrate: %.2lf ms] [choice: %s] "
+                            "[threads: %ld]\n",
+                            n, c[first].m, c[first].k, c[first].weight,
+                            1000.0*(omp_get_wtime() - start), v->name, p);
+        }
+    }
+    if(v == NULL)
+    {
+        // the flags, bin heap, 64-bit table and default layout otherwise
+        if(heap == -1)
+            heap = HEAP_BIN;
+        if(width == -1)
+            width = 64;
+        if(compact == -1)
+            compact = layout;
+        if(trace == -1 && list_soln)
+            trace = TRACE_STORE;
+        index_t any_trace = !admissible_any(heap, width, compact, trace,
+                                            list_soln, 0);
+        for(index_t i = 0; i < NUM_VARIANTS && v == NULL; i++)
+            if(admissible(variants + i, heap, width, compact, trace,
+                          list_soln, any_trace))
+                v = variants + i;
+        if(v == NULL)
+            ERROR("no build with heap %s, %ld-bit table, %s graph and "
+                  "traceback %s, see -variants", heap_legend[heap], width,
+                  compact ? "compact" : "default", (trace == -1) ? "none" :
+                  trace_legend[trace]);
+        fprintf(stdout, "auto: [choice: %s]\n", v->name);
+    }
+    fflush(stdout);
+
+    if(threads > 0)
+        omp_set_num_threads(threads);
+    int status = v->entry(nargs, args);
+    if(spool != NULL)
+    {
+        unlink(spool);
+        free(spool);
+    }
+    free(args);
+    return status;
+}
@@ -0,0 +1,403 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work 
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE // fork, pipe, getline
+
+#include<math.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<dirent.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<sys/wait.h>
+
+#include"reader-el.h"
+
+/************************************************************** Batch runner. */
+/*
+ * Solves every instance of a directory tree (the .stp files and snapshots
+ * in it) or of a manifest (one path per line, '#' starts a comment), one 
+ * child process per instance. The child gets a thread count from the table
+ * work of its instance, n*3^k + m*2^k, at one thread per BATCH_GRAIN: 
+ * small instances run side by side on a thread each, the big ones get the
+ * whole machine. The instances start largest first whenever enough threads
+ * are free, and every instance reports one line
+ *    result: [file: f] [n: n] [m: m] [k: k] [threads: t] [cost: c] 
+ *            [expected: e] [status: s] [time: t ms]
+ * with status ok, mismatch (the cost differs from the cost in the file) or
+ * failed (the child died). The child logs go to /dev/null, or to one file
+ * per instance under 'logdir', named in the result line.
+ *
+ */
+
+#define BATCH_GRAIN (1L<<26) // table work per thread
+
+typedef struct batch_item
+{
+    char *file;
+    index_t n;
+    index_t m;
+    index_t k;
+    double work;
+    index_t threads;
+    index_t started;
+    pid_t pid;
+    int fd;                 // read end of the result pipe
+} batch_item_t;
+
+typedef struct batch_result
+{
+    index_t cost;
+    index_t expected;
+    double time;
+} batch_result_t;
+
+typedef struct batch
+{
+    index_t num;
+    index_t cap;
+    batch_item_t *items;
+} batch_t;
+
+static void batch_add(batch_t *b, const char *file)
+{
+    if(b->num == b->cap)
+    {
+        index_t cap = 2*b->cap + 16;
+        batch_item_t *a = (batch_item_t *) MALLOC(cap*sizeof(batch_item_t));
+        if(b->items != NULL)
+        {
+            memcpy(a, b->items, b->num*sizeof(batch_item_t));
+            FREE(b->items);
+        }
+        b->items = a;
+        b->cap   = cap;
+    }
+    batch_item_t *it = b->items + b->num++;
+    it->file = (char *) MALLOC(strlen(file)+1);
+    strcpy(it->file, file);
+    it->started = 0;
+    it->pid = -1;
+    it->fd  = -1;
+}
+
+static int batch_cmp_name(const void *a, const void *b)
+{
+    return strcmp(((const batch_item_t *) a)->file,
+                  ((const batch_item_t *) b)->file);
+}
+
+static int batch_cmp_work(const void *a, const void *b)
+{
+    double wa = ((const batch_item_t *) a)->work;
+    double wb = ((const batch_item_t *) b)->work;
+    return (wa < wb) - (wa > wb);
+}
+
+static void batch_scan(batch_t *b, const char *dir)
+{
+    DIR *d = opendir(dir);
+    if(d == NULL)
+        ERROR("unable to open directory '%s'", dir);
+    struct dirent *e;
+    while((e = readdir(d)) != NULL)
+    {
+        if(e->d_name[0] == '.')
+            continue;
+        char *path = (char *) MALLOC(strlen(dir) + strlen(e->d_name) + 2);
+        sprintf(path, "%s/%s", dir, e->d_name);
+        struct stat st;
+        size_t len = strlen(e->d_name);
+        if(stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+            batch_scan(b, path);
+        else if(len > 4 && (!strcmp(e->d_name + len-4, ".stp") || 
+                            !strcmp(e->d_name + len-4, ".bin")))
+            batch_add(b, path);
+        FREE(path);
+    }
+    closedir(d);
+}
+
+static void batch_manifest(batch_t *b, const char *file)
+{
+    FILE *in = fopen(file, "r");
+    if(in == NULL)
+        ERROR("unable to open manifest '%s'", file);
+    char line[MAX_LINE_SIZE];
+    while(fgets(line, MAX_LINE_SIZE, in) != NULL)
+    {
+        char *p = line;
+        while(isspace((unsigned char) *p))
+            p++;
+        char *q = p + strlen(p);
+        while(q > p && isspace((unsigned char) q[-1]))
+            *--q = '\0';
+        if(*p != '\0' && *p != '#')
+            batch_add(b, p);
+    }
+    fclose(in);
+}
+
+// n, m and k of an instance without loading it
+static void batch_probe(batch_item_t *it)
+{
+    it->n = it->m = it->k = -1;
+    if(access(it->file, R_OK) != 0)
+        return; // the child reports it
+    if(snapshot_probe(it->file))
+    {
+        snapshot_header_t h;
+        FILE *in = fopen(it->file, "rb");
+        if(in != NULL && fread(&h, sizeof(h), 1, in) == 1)
+        {
+            it->n = h.n;
+            it->m = h.m;
+            it->k = h.k;
+        }
+        if(in != NULL)
+            fclose(in);
+        return;
+    }
+
+    int fd = open(it->file, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        if(fd >= 0)
+            close(fd);
+        return;
+    }
+    size_t len = st.st_size;
+    const char *buf = (const char *) mmap(NULL, len, PROT_READ, MAP_PRIVATE,
+                                          fd, 0);
+    close(fd);
+    if(buf == MAP_FAILED)
+        return;
+    madvise((void *) buf, len, MADV_SEQUENTIAL);
+    const char *end = buf + len;
+    for(const char *p = buf; p < end && it->k == -1; )
+    {
+        const char *eol = stp_eol(p, end);
+        const char *c = stp_blank(p, eol);
+        if(stp_keyword(c, eol, "nodes"))
+            stp_int(c + 5, eol, &it->n);
+        else if(stp_keyword(c, eol, "edges"))
+            stp_int(c + 5, eol, &it->m);
+        else if(stp_keyword(c, eol, "terminals"))
+            stp_int(c + 9, eol, &it->k);
+        p = eol + 1;
+    }
+    munmap((void *) buf, len);
+}
+
+// solves one instance in a forked child, the result goes to fd
+static void batch_child(batch_item_t *it, index_t id, int fd, 
+                        const char *logdir, index_t ds, const emv_opts_t *opt,
+                        index_t reduce, index_t order)
+{
+#ifdef BUILD_PARALLEL
+    omp_set_num_threads(it->threads);
+#endif
+    if(logdir != NULL)
+    {
+        const char *base = strrchr(it->file, '/');
+        base = (base == NULL) ? it->file : base+1;
+        char *path = (char *) MALLOC(strlen(logdir) + strlen(base) + 32);
+        sprintf(path, "%s/%ld-%s.log", logdir, id, base);
+        if(freopen(path, "w", stdout) == NULL)
+            ERROR("unable to open log '%s'", path);
+        FREE(path);
+    }
+    else if(freopen("/dev/null", "w", stdout) == NULL)
+    {
+        ERROR("unable to open /dev/null");
+    }
+
+    push_time();
+    batch_result_t r;
+    r.expected = -1;
+    steinerq_t *root = root_load(it->file, 0, reduce, order, &r.expected);
+    fprintf(stdout, "command: %s\n", ds ? "Dijkstra-Steiner" : 
+                                          "Erickson-Monma-Veinott");
+    // the children would all write the same metrics file
+    emv_opts_t opts = *opt;
+    opts.metrics_path = NULL;
+    opts.counters     = 0;
+    r.cost = ds ? dijkstra_steiner(root, opt->list_soln) :
+                  erickson_monma_veinott(root, &opts, NULL, NULL);
+    r.time = pop_time();
+    fflush(stdout);
+    if(write(fd, &r, sizeof(r)) != sizeof(r))
+        ERROR("unable to report the result");
+    close(fd);
+    _exit(0);
+}
+
+void batch_run(const char *path, const char *logdir, index_t ds, 
+               const emv_opts_t *opt, index_t reduce, index_t order)
+{
+    push_time();
+    batch_t b;
+    b.num   = 0;
+    b.cap   = 0;
+    b.items = NULL;
+    struct stat st;
+    if(stat(path, &st) != 0)
+        ERROR("unable to open '%s'", path);
+    if(S_ISDIR(st.st_mode))
+    {
+        batch_scan(&b, path);
+        qsort(b.items, b.num, sizeof(batch_item_t), batch_cmp_name);
+    }
+    else
+    {
+        batch_manifest(&b, path);
+    }
+    if(logdir != NULL)
+        mkdir(logdir, 0755);
+
+    // thread counts from the table work, largest first
+    index_t nt = num_threads();
+    for(index_t i = 0; i < b.num; i++)
+    {
+        batch_item_t *it = b.items + i;
+        batch_probe(it);
+        index_t kt = (opt->nonroot || ds) ? it->k-1 : it->k;
+        it->work = (it->k < 0) ? 0 : 
+                   (double) it->n * pow(3, kt) + (double) it->m * pow(2, kt);
+        it->threads = MIN(nt, MAX(1, (index_t) ceil(it->work / BATCH_GRAIN)));
+    }
+    qsort(b.items, b.num, sizeof(batch_item_t), batch_cmp_work);
+    fprintf(stdout, "batch: [instances: %ld] [threads: %ld]\n", b.num, nt);
+    fflush(stdout);
+
+    index_t free_threads = nt;
+    index_t done = 0;
+    index_t next = 0;
+    index_t num_ok = 0;
+    index_t num_mismatch = 0;
+    index_t num_failed = 0;
+    while(done < b.num)
+    {
+        // start all that fit, in order of work
+        for(index_t i = next; i < b.num && free_threads > 0; i++)
+        {
+            batch_item_t *it = b.items + i;
+            if(it->started || it->threads > free_threads)
+                continue;
+            int fds[2];
+            if(pipe(fds) != 0)
+                ERROR("pipe fails");
+            fflush(stdout);
+            pid_t pid = fork();
+            if(pid < 0)
+                ERROR("fork fails");
+            if(pid == 0)
+            {
+                close(fds[0]);
+                batch_child(it, i, fds[1], logdir, ds, opt, reduce, order);
+            }
+            close(fds[1]);
+            it->started = 1;
+            it->pid = pid;
+            it->fd  = fds[0];
+            free_threads -= it->threads;
+        }
+        while(next < b.num && b.items[next].started)
+            next++;
+
+        // reap one child
+        int status;
+        pid_t pid = wait(&status);
+        if(pid < 0)
+            ERROR("wait fails");
+        index_t i = 0;
+        while(i < b.num && b.items[i].pid != pid)
+            i++;
+        if(i == b.num)
+            continue;
+        batch_item_t *it = b.items + i;
+        batch_result_t r;
+        const char *verdict;
+        if(!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+           read(it->fd, &r, sizeof(r)) != sizeof(r))
+        {
+            r.cost = r.expected = -1;
+            r.time = 0;
+            verdict = "failed";
+            num_failed++;
+        }
+        else if(r.expected != -1 && r.expected != r.cost)
+        {
+            verdict = "mismatch";
+            num_mismatch++;
+        }
+        else
+        {
+            verdict = "ok";
+            num_ok++;
+        }
+        close(it->fd);
+        it->pid = -1;
+        free_threads += it->threads;
+        done++;
+
+        fprintf(stdout, "result: [file: %s] [n: %ld] [m: %ld] [k: %ld] "
+                        "[threads: %ld] [cost: %ld] [expected: %ld] "
+                        "[status: %s] [time: %.2lf ms]",
+                        it->file, it->n, it->m, it->k, it->threads, r.cost,
+                        r.expected, verdict, r.time);
+        if(logdir != NULL)
+        {
+            const char *base = strrchr(it->file, '/');
+            fprintf(stdout, " [log: %s/%ld-%s.log]", logdir, i,
+                            (base == NULL) ? it->file : base+1);
+        }
+        fprintf(stdout, "\n");
+        fflush(stdout);
+    }
+
+    double time = pop_time();
+    fprintf(stdout, "batch: [ok: %ld] [mismatch: %ld] [failed: %ld] done. "
+                    "[%.2lf ms]\n", num_ok, num_mismatch, num_failed, time);
+    fflush(stdout);
+    for(index_t i = 0; i < b.num; i++)
+        FREE(b.items[i].file);
+    if(b.items != NULL)
+        FREE(b.items);
+}
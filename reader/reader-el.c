@@ -36,6 +36,8 @@
  *
  */
 
+#define _GNU_SOURCE // sched_setaffinity, MAP_ANONYMOUS
+
 #include<stdio.h>
 #include<stdlib.h>
 #include<string.h>
@@ -45,49 +47,26 @@
 #include<sys/utsname.h>
 #include<math.h>
 #include<ctype.h>
-
-/************************************************************* Configuration. */
-#ifdef DEFAULT
-#define BIN_HEAP
-#define TRACK_OPTIMAL
-#define BUILD_PARALLEL
-#endif
-
-#ifdef TRACK_RESOURCES
-#define TRACK_MEMORY
-#define TRACK_BANDWIDTH
-#endif
-
-#define MAX_K        32 
-#define MAX_THREADS 128
-
-typedef long int index_t; // default to 64-bit indexing
-
-/********************************************************** Global constants. */
-
-#define MAX_DISTANCE ((index_t)0x7FFFFFFFFFFFFFFF)
-#define MATH_INF ((index_t)0x7FFFFFFFFFFFFFFF)
-#define UNDEFINED -1
-
-/************************************************************* Common macros. */
-
-#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
-#define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
-
-// Linked list navigation macros. 
-
-#define pnlinknext(to,el) { (el)->next = (to)->next; (el)->prev = (to); (to)->next->prev = (el); (to)->next = (el); }
-#define pnlinkprev(to,el) { (el)->prev = (to)->prev; (el)->next = (to); (to)->prev->next = (el); (to)->prev = (el); }
-#define pnunlink(el) { (el)->next->prev = (el)->prev; (el)->prev->next = (el)->next; }
-#define pnrelink(el) { (el)->next->prev = (el); (el)->prev->next = (el); }
-
+#include<limits.h>
+#include<stdint.h>
+#include<unistd.h>
+#include<sched.h>
+#include<sys/mman.h>
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<pthread.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include<immintrin.h>
+#endif
+
+#include"reader-el.h"
 
 /*********************************************************** Error reporting. */
 
-#define ERROR(...) error(__FILE__,__LINE__,__func__,__VA_ARGS__);
-
-static void error(const char *fn, int line, const char *func, 
-                  const char *format, ...) 
+void error(const char *fn, int line, const char *func, 
+           const char *format, ...) 
 {
     va_list args;
     va_start(args, format);
@@ -133,10 +112,14 @@ index_t thread_id(void)
 #ifdef BUILD_PARALLEL
     return omp_get_thread_num();
 #else
-    return 1;
+    return 0;
 #endif
 }
 
+// processes of a distributed run, set up in main with BUILD_MPI
+index_t num_ranks = 1;
+index_t rank_id   = 0;
+
 /******************************************************* String manipulation. */
 
 char* strlower( char *s)
@@ -177,19 +160,6 @@ index_t choose(index_t n, index_t r)
  *
  */
 
-#ifdef TRACK_MEMORY
-#define MALLOC(x) malloc_wrapper(x)
-#define CALLOC(x, y) calloc_wrapper((x), (y))
-#define FREE(x) free_wrapper(x)
-
-#else
-
-#define MALLOC(x) malloc((x))
-#define CALLOC(x, y) calloc((x), (y))
-#define FREE(x) free((x))
-
-#endif
-
 #ifdef TRACK_MEMORY
 index_t malloc_balance = 0;
 
@@ -316,6 +286,9 @@ void print_pop_memtrack(void)
 void inc_malloc_total(size_t size)
 {
     malloc_total += size;
+    for(index_t i = 0; i <= memtrack_stack_top; i++)
+        if(memtrack_stack[i] < malloc_total)
+            memtrack_stack[i] = malloc_total;
 }
 
 void dec_malloc_total(size_t size)
@@ -324,6 +297,143 @@ void dec_malloc_total(size_t size)
 }
 #endif
 
+/************************************************************ NUMA placement. */
+
+index_t thread_node[MAX_THREADS]; // node of each pinned thread
+index_t num_nodes = 1;
+
+index_t cpu_node(index_t cpu)
+{
+    // sysfs lists a cpu under the node it belongs to
+    char path[64];
+    for(index_t node = 0; node < MAX_NODES; node++)
+    {
+        sprintf(path, "/sys/devices/system/node/node%ld/cpu%ld", node, cpu);
+        if(access(path, F_OK) == 0)
+            return node;
+    }
+    return 0;
+}
+
+void pin_threads(index_t nt)
+{
+    // thread th runs on the th-th cpu of the affinity mask, for a stable
+    // thread to node mapping between first touch and the kernel
+    cpu_set_t mask;
+    index_t cpus[CPU_SETSIZE];
+    index_t ncpu = 0;
+    if(sched_getaffinity(0, sizeof(mask), &mask) != 0)
+        ERROR("sched_getaffinity failed");
+    for(index_t c = 0; c < CPU_SETSIZE; c++)
+        if(CPU_ISSET(c, &mask))
+            cpus[ncpu++] = c;
+
+    num_nodes = 1;
+    // each thread pins itself, so thread_node[th] is the node of the
+    // OpenMP thread th and not of whichever thread ran iteration th, a
+    // team smaller than nt steps over the rest
+#ifdef BUILD_PARALLEL
+#pragma omp parallel num_threads(nt)
+#endif
+    for(index_t th = thread_id(); th < nt; th += omp_get_num_threads())
+    {
+        cpu_set_t set;
+        index_t cpu = cpus[th % ncpu];
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        if(sched_setaffinity(0, sizeof(set), &set) != 0)
+            ERROR("sched_setaffinity failed for cpu %ld", cpu);
+        thread_node[th] = cpu_node(cpu);
+    }
+    for(index_t th = 0; th < nt; th++)
+        if(thread_node[th] + 1 > num_nodes)
+            num_nodes = thread_node[th] + 1;
+}
+
+#define HUGE_PAGE_SIZE (1L << 21)
+
+void *table_alloc(size_t size, const char **page_legend)
+{
+    // explicit huge pages when reserved, otherwise ask for transparent ones;
+    // pages stay untouched until the first touch places them
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    *page_legend = "hugetlb";
+    if(p == MAP_FAILED)
+    {
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(p == MAP_FAILED)
+            ERROR("mmap failed for %ld bytes", (index_t) size);
+        *page_legend = "transparent";
+        if(madvise(p, size, MADV_HUGEPAGE) != 0)
+            *page_legend = "none";
+    }
+#ifdef TRACK_MEMORY
+    inc_malloc_total(size);
+#endif
+    return p;
+}
+
+void table_free(void *p, size_t size)
+{
+    size = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    munmap(p, size);
+#ifdef TRACK_MEMORY
+    dec_malloc_total(size);
+#endif
+}
+
+/********************************************************* Out-of-core table. */
+/*
+ * With an out-of-core directory the table lives in a scratch file mapped
+ * shared, the kernel pages rows in and writes finished rows back instead
+ * of the allocation failing when the table exceeds memory. The file is
+ * unlinked right away, its descriptor stays open for the writeback and is
+ * closed with the mapping.
+ */
+
+void *table_map(const char *dir, size_t size, int *fd_out)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/emv-table-XXXXXX", dir);
+    int fd = mkstemp(path);
+    if(fd < 0)
+        ERROR("unable to create table file in '%s'", dir);
+    unlink(path);
+    if(ftruncate(fd, size) != 0)
+        ERROR("unable to size table file to %ld bytes", (index_t) size);
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(p == MAP_FAILED)
+        ERROR("mmap failed for table file of %ld bytes", (index_t) size);
+    *fd_out = fd;
+    return p;
+}
+
+void table_unmap(void *p, size_t size, int fd)
+{
+    munmap(p, size);
+    close(fd);
+}
+
+void table_advise(int fd, void *base, size_t offset, size_t bytes, 
+                  index_t writeback)
+{
+    if(writeback)
+    {
+        // starts the writeout of the dirty pages of the range and returns,
+        // msync(MS_ASYNC) would not, the table is at offset 0 of its file
+        sync_file_range(fd, offset, bytes, SYNC_FILE_RANGE_WRITE);
+        return;
+    }
+    // madvise takes page aligned ranges
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    uintptr_t lo = ((uintptr_t) base + offset) & ~(page - 1);
+    uintptr_t hi = (uintptr_t) base + offset + bytes;
+    madvise((void *) lo, hi - lo, MADV_WILLNEED);
+}
+
 /******************************************************** Timing subroutines. */
 
 #define TIME_STACK_CAPACITY 256
@@ -346,32 +456,6 @@ double pop_time(void)
 
 /*************************************************** Graph build subroutines. */
 
-#define GRAPH_SEC_COMMENT         0x01
-#define GRAPH_SEC_GRAPH           0x02
-#define GRAPH_SEC_TERMINALS       0x04
-#define GRAPH_SEC_COORDINATES     0x08
-#define GRAPH_EDGES_ALLOC         0x10
-#define GRAPH_TERMINALS_ALLOC     0x20
-#define GRAPH_COORDINATES_ALLOC   0x40
-#define GRAPH_STEINER_COST        0x80
-
-typedef struct graph
-{
-    index_t root;
-    index_t n;
-    index_t m;
-    index_t k;
-    index_t num_edges;
-    index_t num_terminals;
-    index_t num_coordinates;
-    index_t *edges;
-    index_t *terminals;
-    index_t *coordinates;
-    index_t flags;
-    index_t cost;
-    index_t edge_capacity;
-} graph_t;
-
 static index_t *enlarge(index_t m, index_t m_was, index_t *was)
 {
     assert(m >= 0 && m_was >= 0);
@@ -403,6 +487,10 @@ graph_t *graph_alloc()
     g->edges            = enlarge(3*g->edge_capacity, 0, (void *) 0);
     g->terminals        = NULL;
     g->coordinates      = NULL;
+    g->num_members      = 0;
+    g->member_capacity  = 0;
+    g->group_pos        = NULL;
+    g->group_members    = NULL;
     
     return g;
 }
@@ -415,6 +503,10 @@ void graph_free(graph_t *g)
         FREE(g->terminals);
     if(g->coordinates != NULL)
         FREE(g->coordinates);
+    if(g->group_pos != NULL)
+        FREE(g->group_pos);
+    if(g->group_members != NULL)
+        FREE(g->group_members);
     FREE(g);
 }
 
@@ -450,6 +542,43 @@ void graph_add_terminal(graph_t *g, index_t u)
     t[0] = u;
 }
 
+/*
+ * A group instance lists vertex sets in place of terminals, a tree has to
+ * reach one vertex of every group. graph_add_group opens the next group
+ * and its members follow with graph_add_member. Group t counts as terminal
+ * t, the first member stands for it in terminals[t].
+ */
+
+void graph_add_group(graph_t *g)
+{
+    if(g->group_pos == NULL)
+        ERROR("section groups not initialised");
+
+    g->num_terminals++;
+    assert(g->num_terminals <= g->k);
+    g->group_pos[g->num_terminals] = g->num_members;
+}
+
+void graph_add_member(graph_t *g, index_t u)
+{
+    if(g->num_terminals == 0)
+        ERROR("group member outside a group");
+    assert(u >= 0 && u < g->n);
+
+    if(g->num_members == g->member_capacity)
+    {
+        index_t capacity = MAX(2*g->member_capacity, 100);
+        g->group_members = enlarge(capacity, g->num_members, 
+                                   g->group_members);
+        g->member_capacity = capacity;
+    }
+    index_t t = g->num_terminals-1;
+    if(g->group_pos[t] == g->num_members)
+        g->terminals[t] = u;
+    g->group_members[g->num_members++] = u;
+    g->group_pos[t+1] = g->num_members;
+}
+
 void graph_add_coordinate(graph_t *g, index_t u, index_t x, index_t y)
 {
     if(g->coordinates == NULL)
@@ -467,7 +596,79 @@ void graph_add_coordinate(graph_t *g, index_t u, index_t x, index_t y)
     coord[2] = y;
 }
 
-#define MAX_LINE_SIZE 1024
+void graph_relabel(graph_t *g, index_t *perm)
+{
+    // renames the endpoints of all edges, u becomes perm[u]
+    for(index_t i = 0; i < g->num_edges; i++)
+    {
+        index_t *e = g->edges + 3*i;
+        e[0] = perm[e[0]];
+        e[1] = perm[e[1]];
+    }
+}
+
+static graph_t *graph_loaded(graph_t *g)
+{
+    // common checks and report of both loaders, closes their timer
+    assert(g->n != 0);
+    assert(g->m == g->num_edges && g->m != 0);
+    assert(g->k == g->num_terminals && g->k != 0);
+    assert((g->flags & GRAPH_SEC_GRAPH) && 
+           (g->flags & (GRAPH_SEC_TERMINALS | GRAPH_SEC_GROUPS)));
+    if((g->flags & GRAPH_TERMINALS_ALLOC) && (g->flags & GRAPH_GROUPS_ALLOC))
+        ERROR("both terminals and groups given");
+    for(index_t t = 0; g->group_pos != NULL && t < g->k; t++)
+        if(g->group_pos[t] == g->group_pos[t+1])
+            ERROR("group %ld has no members", t+1);
+
+#ifdef NARROW_TABLE
+    // any label is at most the total edge weight and a merge adds two labels
+    index_t total_weight = 0;
+    for(index_t i = 0; i < g->num_edges; i++)
+        total_weight += g->edges[3*i+2];
+    if(total_weight >= (index_t) (DIST_INF/2))
+        ERROR("total edge weight %ld overflows the 32-bit table", 
+              total_weight);
+    if(g->n >= (index_t) UINT32_MAX)
+        ERROR("%ld vertices overflow the 32-bit table", g->n);
+#endif
+#ifdef COMPACT_GRAPH
+    for(index_t i = 0; i < g->num_edges; i++)
+        if(g->edges[3*i+2] > (index_t) UINT32_MAX)
+            ERROR("edge weight %ld overflows the 32-bit adjacency", 
+                  g->edges[3*i+2]);
+    if(g->n > (index_t) UINT32_MAX)
+        ERROR("%ld vertices overflow the 32-bit adjacency", g->n);
+#endif
+
+    double time = pop_time();
+    fprintf(stdout, "input: n = %ld, m = %ld, k = %ld, cost = %ld [%.2lf ms] ",
+                    g->n, g->m, g->k, g->cost, time);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    if(g->group_pos != NULL)
+    {
+        fprintf(stdout, "groups: [members: %ld] [sizes:", g->num_members);
+        for(index_t t = 0; t < g->k; t++) 
+            fprintf(stdout, " %ld", g->group_pos[t+1] - g->group_pos[t]);
+        fprintf(stdout, "]\n");
+    }
+    else
+    {
+        fprintf(stdout, "terminals:");
+        for(index_t i=0; i<g->k; i++) 
+            fprintf(stdout, " %ld", g->terminals[i]+1);
+        fprintf(stdout, "\n");
+    }
+    fflush(stdout);
+
+    return g;
+}
+
 #define MAX_SECTION_SIZE 256
 
 graph_t * graph_load(FILE *in)
@@ -477,8 +678,11 @@ graph_t * graph_load(FILE *in)
     push_memtrack();
 #endif
 
-    char buf[MAX_LINE_SIZE];
-    char line[MAX_LINE_SIZE];
+    // group lines can run long, lines come in whole from getline
+    char *buf = NULL;
+    char *line = NULL;
+    size_t size = 0;
+    size_t buf_size = 0;
     index_t n = 0;
     index_t m = 0;
     index_t k = 0;
@@ -490,11 +694,26 @@ graph_t * graph_load(FILE *in)
 
     graph_t *g = graph_alloc();
 
-    while(fgets(line, MAX_LINE_SIZE, in) != NULL)
+    while(getline(&line, &size, in) != -1)
     {
+        // keywords are case-insensitive, line ends of either kind and
+        // trailing blanks go as in the mmap loader
+        for(char *l = line; *l != '\0'; l++)
+            *l = tolower((unsigned char) *l);
+        size_t len = strlen(line);
+        while(len > 0 && isspace((unsigned char) line[len-1]))
+            line[--len] = '\0';
+        if(buf_size < size)
+        {
+            buf_size = size;
+            buf = (char *) realloc(buf, buf_size);
+            if(buf == NULL)
+                ERROR("out of memory for line of %ld bytes", (index_t) size);
+        }
         strcpy(buf, line);
-        char *c = strtok(buf, " ");
-        
+        char *c = strtok(buf, " \t");
+        if(c == NULL)
+            continue; // blank line
         if(!strcmp(c, "section"))
         {
             if(in_section == 1) { ERROR("nested sections");}
@@ -509,6 +728,8 @@ graph_t * graph_load(FILE *in)
                 g->flags |= GRAPH_SEC_GRAPH;
             else if(!strcmp(section, "terminals"))
                 g->flags |= GRAPH_SEC_TERMINALS;
+            else if(!strcmp(section, "groups"))
+                g->flags |= GRAPH_SEC_GROUPS;
             else if (!strcmp(section, "coordinates"))
             {
                 continue; //ignore
@@ -518,7 +739,7 @@ graph_t * graph_load(FILE *in)
             else
                 ERROR("invalid section");
         }
-        else if(!strcmp(c, "end\n"))
+        else if(!strcmp(c, "end"))
         {
             if(in_section == 0) { ERROR("no section to end");}
             in_section = 0;
@@ -545,6 +766,16 @@ graph_t * graph_load(FILE *in)
             g->terminals = (index_t *) MALLOC(k*sizeof(index_t));
             g->flags |= GRAPH_TERMINALS_ALLOC;
         }
+        else if(!strcmp(c, "groups"))
+        {
+            if(sscanf(line, "groups %ld", &k) != 1 || k < 1)
+                ERROR("invalid groups line");
+            g->k = k;
+            g->terminals = (index_t *) MALLOC(k*sizeof(index_t));
+            g->group_pos = (index_t *) MALLOC((k+1)*sizeof(index_t));
+            g->group_pos[0] = 0;
+            g->flags |= GRAPH_GROUPS_ALLOC;
+        }
         else if(!strcmp(c, "coordinates"))
         {
             if(g->coordinates != NULL)
@@ -567,6 +798,21 @@ graph_t * graph_load(FILE *in)
                 ERROR("invalid terminal line %s", line);
             graph_add_terminal(g, u-1);
         }
+        else if(!strcmp(c, "g"))
+        {
+            // one group per line, its members after the keyword
+            graph_add_group(g);
+            char *end;
+            for(char *x = line + 1; ; x = end)
+            {
+                u = strtol(x, &end, 10);
+                if(end == x)
+                    break;
+                if(u < 1 || u > g->n)
+                    ERROR("group member out of range in line %s", line);
+                graph_add_member(g, u-1);
+            }
+        }
         else if(!strcmp(c, "dd"))
         {
             continue; // ignore coordinates
@@ -593,28 +839,234 @@ graph_t * graph_load(FILE *in)
         }
 
     }
+    free(line); // allocated by getline
+    free(buf);
 
-    assert(g->n != 0);
-    assert(g->m == g->num_edges && g->m != 0);
-    assert(g->k == g->num_terminals && g->k != 0);
-    assert((g->flags & GRAPH_SEC_GRAPH) && (g->flags & GRAPH_SEC_TERMINALS));
+    return graph_loaded(g);
+}
 
-    double time = pop_time();
-    fprintf(stdout, "input: n = %ld, m = %ld, k = %ld, cost = %ld [%.2lf ms] ",
-                    g->n, g->m, g->k, g->cost, time);
+
+/* 
+ * Memory-mapped loader: keywords are matched case-insensitively and
+ * integers are parsed in place. A serial pass reads the headers,
+ * terminals, groups and cost and presizes 'edges' from the 'edges' line. The 'e'
+ * lines are then parsed in parallel chunks split at line boundaries. The
+ * first pass counts each chunk's edges, which fixes its offset into
+ * 'edges', and the second pass parses them.
+ */
+
+static inline index_t stp_edge_line(const char *p, const char *end)
+{
+    p = stp_blank(p, end);
+    return stp_keyword(p, end, "e");
+}
+
+static void stp_parse_edge(graph_t *g, const char *p, const char *eol, 
+                           index_t *e)
+{
+    index_t u, v, w;
+    const char *q = stp_blank(p, eol) + 1;
+    if((q = stp_int(q, eol, &u)) == NULL ||
+       (q = stp_int(q, eol, &v)) == NULL ||
+       (q = stp_int(q, eol, &w)) == NULL)
+        ERROR("invalid edge line %.*s", (int) (eol - p), p);
+    if(u < 1 || v < 1 || u > g->n || v > g->n)
+        ERROR("edge endpoint out of range in line %.*s", (int) (eol - p), p);
+    e[0] = u-1;
+    e[1] = v-1;
+    e[2] = w;
+}
+
+graph_t * graph_load_mmap(const char *filename)
+{
+    push_time();
 #ifdef TRACK_MEMORY
-    print_pop_memtrack();
-    fprintf(stdout, " ");
-    print_current_mem();
+    push_memtrack();
 #endif
-    fprintf(stdout, "\n");
-    fprintf(stdout, "terminals:");
-    for(index_t i=0; i<g->k; i++) 
-        fprintf(stdout, " %ld", g->terminals[i]+1);
-    fprintf(stdout, "\n");
-    fflush(stdout);
 
-    return g;
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0)
+        ERROR("unable to open file '%s'", filename);
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+    {
+        // pipes and the like go through the stream loader
+        FILE *in = fdopen(fd, "r");
+        if(in == NULL)
+            ERROR("unable to open file '%s'", filename);
+        pop_time();
+#ifdef TRACK_MEMORY
+        pop_memtrack();
+#endif
+        graph_t *g = graph_load(in);
+        fclose(in);
+        return g;
+    }
+    size_t len = st.st_size;
+    const char *buf = (const char *) mmap(NULL, len, PROT_READ, MAP_PRIVATE, 
+                                          fd, 0);
+    if(buf == MAP_FAILED)
+        ERROR("mmap failed for file '%s'", filename);
+    madvise((void *) buf, len, MADV_SEQUENTIAL);
+    const char *end = buf + len;
+
+    graph_t *g = graph_alloc();
+    index_t in_section = 0;
+    index_t x = 0;
+
+    // headers, terminals and cost
+    for(const char *p = buf; p < end; )
+    {
+        const char *eol = stp_eol(p, end);
+        const char *c = stp_blank(p, eol);
+        if(stp_keyword(c, eol, "e"))
+        {
+            // edge lines are parsed in parallel below
+        }
+        else if(stp_keyword(c, eol, "section"))
+        {
+            if(in_section == 1) { ERROR("nested sections");}
+            in_section = 1;
+
+            const char *s = stp_blank(c + 7, eol);
+            if(stp_keyword(s, eol, "comment"))
+                g->flags |= GRAPH_SEC_COMMENT;
+            else if(stp_keyword(s, eol, "graph"))
+                g->flags |= GRAPH_SEC_GRAPH;
+            else if(stp_keyword(s, eol, "terminals"))
+                g->flags |= GRAPH_SEC_TERMINALS;
+            else if(stp_keyword(s, eol, "groups"))
+                g->flags |= GRAPH_SEC_GROUPS;
+            else if(!stp_keyword(s, eol, "coordinates")) // ignored
+                ERROR("invalid section");
+        }
+        else if(stp_keyword(c, eol, "end"))
+        {
+            if(in_section == 0) { ERROR("no section to end");}
+            in_section = 0;
+        }
+        else if(stp_keyword(c, eol, "nodes"))
+        {
+            if(stp_int(c + 5, eol, &x) == NULL)
+                ERROR("invalid nodes line");
+            g->n = x;
+        }
+        else if(stp_keyword(c, eol, "edges"))
+        {
+            if(stp_int(c + 5, eol, &x) == NULL || x < 0)
+                ERROR("invalid edges line");
+            g->m = x;
+            FREE(g->edges);
+            g->edges = (index_t *) MALLOC(3*MAX(x, 1)*sizeof(index_t));
+            g->edge_capacity = MAX(x, 1);
+            g->flags |= GRAPH_EDGES_ALLOC;
+        }
+        else if(stp_keyword(c, eol, "terminals"))
+        {
+            if(stp_int(c + 9, eol, &x) == NULL)
+                ERROR("invalid terminals line");
+            g->k = x;
+            g->terminals = (index_t *) MALLOC(x*sizeof(index_t));
+            g->flags |= GRAPH_TERMINALS_ALLOC;
+        }
+        else if(stp_keyword(c, eol, "t"))
+        {
+            if(stp_int(c + 1, eol, &x) == NULL)
+                ERROR("invalid terminal line %.*s", (int) (eol - p), p);
+            graph_add_terminal(g, x-1);
+        }
+        else if(stp_keyword(c, eol, "groups"))
+        {
+            if(stp_int(c + 6, eol, &x) == NULL || x < 1)
+                ERROR("invalid groups line");
+            g->k = x;
+            g->terminals = (index_t *) MALLOC(x*sizeof(index_t));
+            g->group_pos = (index_t *) MALLOC((x+1)*sizeof(index_t));
+            g->group_pos[0] = 0;
+            g->flags |= GRAPH_GROUPS_ALLOC;
+        }
+        else if(stp_keyword(c, eol, "g"))
+        {
+            graph_add_group(g);
+            for(const char *q = stp_int(c + 1, eol, &x); q != NULL; 
+                q = stp_int(q, eol, &x))
+            {
+                if(x < 1 || x > g->n)
+                    ERROR("group member out of range in line %.*s", 
+                          (int) (eol - p), p);
+                graph_add_member(g, x-1);
+            }
+        }
+        else if(stp_keyword(c, eol, "cost"))
+        {
+            if(stp_int(c + 4, eol, &x) == NULL)
+                ERROR("invalid cost line %.*s", (int) (eol - p), p);
+            g->flags |= GRAPH_STEINER_COST;
+            g->cost = x;
+        }
+        p = eol + 1;
+    }
+
+    // edges, in chunks of whole lines
+    index_t nt = num_threads();
+    index_t chunk_count[MAX_THREADS+1];
+    const char *chunk[MAX_THREADS+1];
+    for(index_t th = 0; th <= nt; th++)
+    {
+        const char *p = buf + (len*th)/nt;
+        if(th > 0 && p < end && p[-1] != '\n')
+            p = stp_eol(p, end) + 1;
+        chunk[th] = MIN(p, end);
+    }
+    chunk[nt] = end;
+
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t th = 0; th < nt; th++)
+    {
+        index_t count = 0;
+        for(const char *p = chunk[th]; p < chunk[th+1]; )
+        {
+            const char *eol = stp_eol(p, end);
+            count += stp_edge_line(p, eol);
+            p = eol + 1;
+        }
+        chunk_count[th] = count;
+    }
+    index_t run = 0;
+    for(index_t th = 0; th < nt; th++)
+    {
+        index_t count = chunk_count[th];
+        chunk_count[th] = run;
+        run += count;
+    }
+    if(run != g->m)
+        ERROR("%ld edge lines for %ld edges", run, g->m);
+
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t th = 0; th < nt; th++)
+    {
+        index_t *e = g->edges + 3*chunk_count[th];
+        for(const char *p = chunk[th]; p < chunk[th+1]; )
+        {
+            const char *eol = stp_eol(p, end);
+            if(stp_edge_line(p, eol))
+            {
+                stp_parse_edge(g, p, eol, e);
+                e += 3;
+            }
+            p = eol + 1;
+        }
+    }
+    g->num_edges = run;
+
+    munmap((void *) buf, len);
+    close(fd);
+
+    return graph_loaded(g);
 }
 
 
@@ -685,30 +1137,48 @@ index_t prefixsum(index_t n, index_t *a, index_t k)
     return run;
 }
 
-/**************************************************************** Indexing. */
 
-// subset major index
-#define FV_INDEX(v, n, k, X) ((index_t)(X) * (n) + (v))
-#define BV_INDEX(v, n, k, X) (((index_t)(X) * (2*(n))) + (2*(v)))
-
-/******************************************************** Root query builder. */
+/********************************************************* Adjacency layout. */
 
-typedef struct steinerq
-{
-    index_t     n;
-    index_t     m;
-    index_t     k;
-    index_t     *kk;
-    index_t     *pos;
-    index_t     *adj;
-}steinerq_t;
+/*
+ * A build counts ARC_STEP in pos[u] for each arc of u, turns the counts
+ * into offsets with a prefix sum over ARC_HEADER extra slots, clears the
+ * headers with arcs_clear, appends all arcs and then calls arcs_close.
+ */
 
-steinerq_t *root_build(graph_t *g)
+static void arcs_clear(index_t n, index_t m, index_t *pos, adj_t *adj, 
+                       index_t slots)
 {
-#ifdef TRACK_MEMORY
-    push_memtrack();
-#endif
-    push_time();
+#ifdef COMPACT_GRAPH
+    assert(slots == ARC_SLOTS(n, m));
+    pos[n] = slots;
+#else
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t u = 0; u < n; u++)
+        adj[pos[u]] = 0;
+#endif
+}
+
+static void arcs_close(index_t n, index_t *pos)
+{
+#ifdef COMPACT_GRAPH
+    // the appends moved each offset on to the start of the next vertex
+    memmove(pos + 1, pos, n*sizeof(index_t));
+    pos[0] = 0;
+#endif
+}
+
+/******************************************************** Root query builder. */
+
+
+steinerq_t *root_build(graph_t *g)
+{
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    push_time();
 
     index_t n = g->n;
     index_t m = g->m;
@@ -717,20 +1187,23 @@ steinerq_t *root_build(graph_t *g)
 #ifdef BUILD_PARALLEL
     index_t nt = num_threads();
     assert(nt < MAX_THREADS);
-    index_t *pos = (index_t *) MALLOC((n+nt)*sizeof(index_t));
-    index_t *adj = (index_t *) MALLOC(((n+nt)+(4*m)+(2*n*nt))*sizeof(index_t));
-#else
-    index_t *pos = (index_t *) MALLOC((n+1)*sizeof(index_t));
-    index_t *adj = (index_t *) MALLOC(((n+1)+(4*m)+(2*n))*sizeof(index_t));
 #endif
+    index_t *pos = (index_t *) MALLOC(POS_LEN(n)*sizeof(index_t));
+    adj_t *adj = (adj_t *) MALLOC(ADJ_LEN(n, m)*sizeof(adj_t));
 
     steinerq_t *root = (steinerq_t *) MALLOC(sizeof(steinerq_t));
     root->n = n;
     root->m = m;
     root->k = k;
     root->kk  = kk;
+    root->gpos = NULL;
+    root->gv   = NULL;
     root->pos = pos;
     root->adj = adj;
+    root->perm = NULL;
+    root->red  = NULL;
+    root->map = NULL;
+    root->map_size = 0;
 
     fprintf(stdout, "root build: ");
 
@@ -748,128 +1221,110 @@ steinerq_t *root_build(graph_t *g)
     index_t *e = g->edges;
 
 #ifdef BUILD_PARALLEL
+    /* 
+     * Bucket the 2m edge ends by the vertex block of their endpoint: thread t
+     * counts the ends of its edge chunk per block, a prefix sum over (block,
+     * chunk) places them, and then thread b owns block b alone. The ends of 
+     * a block are in edge order, as in the serial build. An end is coded as 
+     * 2*j for the u end and 2*j+1 for the v end of edge j.
+     */
     index_t block_size = n/nt;
+    index_t *cnt  = (index_t *) MALLOC(nt*nt*sizeof(index_t));
+    index_t *ends = (index_t *) MALLOC(2*m*sizeof(index_t));
+#define VERTEX_BLOCK(u) ((block_size == 0) ? nt-1 : MIN((u)/block_size, nt-1))
+
 #pragma omp parallel for
-    for(index_t t = 0; t < nt; t++) 
+    for(index_t t = 0; t < nt; t++)
     {
-        index_t start = t*block_size;
-        index_t stop = (t == nt-1) ? n-1 : (start+block_size-1);
-        for(index_t j = 0; j < 3*m; j+=3) 
+        index_t *cnt_t = cnt + t*nt;
+        for(index_t b = 0; b < nt; b++)
+            cnt_t[b] = 0;
+        for(index_t j = (m*t)/nt; j < (m*(t+1))/nt; j++)
         {
-            index_t u = e[j];
-            index_t v = e[j+1];
-            if(start <= u && u <= stop)
-                pos[u]+=2; 
-            if(start <= v && v <= stop)
-                pos[v]+=2;
+            cnt_t[VERTEX_BLOCK(e[3*j+1])]++;
+            cnt_t[VERTEX_BLOCK(e[3*j])]++;
         }
     }
-#else
-    for(index_t j = 0; j < 3*m; j+=3)
+    index_t *bstart = (index_t *) MALLOC((nt+1)*sizeof(index_t));
+    index_t run_ends = 0;
+    for(index_t b = 0; b < nt; b++)
     {
-        pos[e[j]]+=2;
-        pos[e[j+1]]+=2;
+        bstart[b] = run_ends;
+        for(index_t t = 0; t < nt; t++)
+        {
+            index_t c = cnt[t*nt+b];
+            cnt[t*nt+b] = run_ends;
+            run_ends += c;
+        }
     }
-#endif
+    bstart[nt] = run_ends;
+    assert(run_ends == 2*m);
 
-#ifdef BUILD_PARALLEL
-    for(index_t th = 0; th < nt; th++)
-        pos[n+th] = (2*n);
+#pragma omp parallel for
+    for(index_t t = 0; t < nt; t++)
+    {
+        index_t *cnt_t = cnt + t*nt;
+        for(index_t j = (m*t)/nt; j < (m*(t+1))/nt; j++)
+        {
+            ends[cnt_t[VERTEX_BLOCK(e[3*j+1])]++] = 2*j+1;
+            ends[cnt_t[VERTEX_BLOCK(e[3*j])]++]   = 2*j;
+        }
+    }
 
-    index_t run = prefixsum(n+nt, pos, 1);
-    assert(run == ((n+nt)+(4*m)+(2*n*nt)));
+#pragma omp parallel for
+    for(index_t b = 0; b < nt; b++)
+        for(index_t i = bstart[b]; i < bstart[b+1]; i++)
+            pos[e[3*(ends[i]>>1) + (ends[i]&1)]] += ARC_STEP;
 #else
-    pos[n] = (2*n);
-    index_t run = prefixsum(n+1, pos, 1);
-    assert(run == ((n+1)+(4*m)+(2*n)));
+    for(index_t j = 0; j < 3*m; j+=3)
+    {
+        pos[e[j]] += ARC_STEP;
+        pos[e[j+1]] += ARC_STEP;
+    }
 #endif
 
+    index_t run = prefixsum(n, pos, ARC_HEADER);
+    assert(run == ARC_SLOTS(n, m));
+
     time = pop_time();
     fprintf(stdout, "[pos: %.2lf ms] ", time);
     fflush(stdout);
 
     push_time();
-#ifdef BUILD_PARALLEL
-#pragma omp parallel for
-#endif
-    for(index_t u = 0; u < n; u++)
-        adj[pos[u]] = 0;
+    arcs_clear(n, m, pos, adj, run);
 
 #ifdef BUILD_PARALLEL
-    block_size = n/nt;
-
 #pragma omp parallel for
-    for(index_t t = 0; t < nt; t++) 
+    for(index_t b = 0; b < nt; b++) 
     {
-        index_t start = t*block_size;
-        index_t stop = (t == nt-1) ? n-1 : (start+block_size-1);
-        for(index_t j = 0; j < 3*m; j+=3) 
+        for(index_t i = bstart[b]; i < bstart[b+1]; i++)
         {
-            index_t u = e[j+0];
-            index_t v = e[j+1];
-            index_t w  = e[j+2];
-            if(start <= u && u <= stop) 
-            {
-                index_t pu = pos[u];
-                adj[pu + 1 + (2*adj[pu])] = v;
-                adj[pu + 1 + ((2*adj[pu])+1)] = w;
-                adj[pu]++;
-            }
-            if(start <= v && v <= stop) 
-            {
-                index_t pv = pos[v];
-                adj[pv + 1 + (2*adj[pv])] = u;
-                adj[pv + 1 + (2*adj[pv]+1)] = w;
-                adj[pv]++;
-            }
+            index_t j    = ends[i] >> 1;
+            index_t side = ends[i] & 1;
+            index_t u    = e[3*j + side];     // owner of the end
+            index_t v    = e[3*j + 1 - side]; 
+            index_t w    = e[3*j + 2];
+            ARC_APPEND(pos, adj, m, u, v, w);
         }
     } 
+#undef VERTEX_BLOCK
+    FREE(bstart);
+    FREE(ends);
+    FREE(cnt);
 #else
     for(index_t j = 0; j < 3*m; j+=3)
     {
         index_t u = e[j+0];
         index_t v = e[j+1];
         index_t w  = e[j+2];
-        index_t pu = pos[u];
-        index_t pv = pos[v];
-
-        adj[pv + 1 + (2*adj[pv])] = u;
-        adj[pv + 1 + ((2*adj[pv])+1)] = w;
-        adj[pv]++;
-        adj[pu + 1 + (2*adj[pu])] = v;
-        adj[pu + 1 + ((2*adj[pu])+1)] = w;
-        adj[pu]++; 
-    }
-#endif
 
-#ifdef BUILD_PARALLEL
-#pragma omp parallel for
-    for(index_t th = 0; th < nt; th++)
-    {
-        index_t u = n+th;
-        index_t pu = pos[u];
-        adj[pu] = 0;
-
-        for(index_t v = 0; v < n; v++)
-        {
-            adj[pu + 1 + (2*adj[pu])] = v;
-            adj[pu + 1 + ((2*adj[pu])+1)] = MATH_INF;
-            adj[pu]++;
-        }
-    }
-#else
-    index_t u = n;
-    adj[pos[u]] = 0;
-    index_t pu = pos[u];
-    for(index_t v = 0; v < n; v++)
-    {
-        adj[pu + 1 + (2*adj[pu])] = v;
-        adj[pu + 1 + ((2*adj[pu])+1)] = MATH_INF;
-        adj[pu]++;
+        ARC_APPEND(pos, adj, m, v, u, w);
+        ARC_APPEND(pos, adj, m, u, v, w);
     }
 #endif
+    arcs_close(n, pos);
 
-    pop_time();
+    time = pop_time();
     fprintf(stdout, "[adj: %.2lf ms] ", time);
     fflush(stdout);
 
@@ -880,6 +1335,13 @@ steinerq_t *root_build(graph_t *g)
 #endif
     for(index_t u = 0; u < k; u++)
         kk[u] = tt[u];
+    if(g->group_pos != NULL)
+    {
+        root->gpos = (index_t *) MALLOC((k+1)*sizeof(index_t));
+        root->gv   = (index_t *) MALLOC(g->num_members*sizeof(index_t));
+        memcpy(root->gpos, g->group_pos, (k+1)*sizeof(index_t));
+        memcpy(root->gv, g->group_members, g->num_members*sizeof(index_t));
+    }
 
     time = pop_time(); 
     fprintf(stdout, "[term: %.2lf ms] ", time);
@@ -898,17 +1360,439 @@ steinerq_t *root_build(graph_t *g)
     return root;
 }
 
-void steinerq_free(steinerq_t *root)
+static void steinerq_release(steinerq_t *root)
 {
-    if(root->pos != NULL)
+    if(root->gpos != NULL)
+    {
+        FREE(root->gpos);
+        FREE(root->gv);
+    }
+    // a snapshot holds all arrays in one mapping or one allocation at kk
+    if(root->map != NULL)
+    {
+        munmap(root->map, root->map_size);
+    }
+    else if(root->pos == root->kk + root->k)
+    {
+        FREE(root->kk);
+    }
+    else
+    {
+        FREE(root->kk);
         FREE(root->pos);
-    if(root->adj != NULL)
         FREE(root->adj);
-    if(root->kk != NULL)
-        FREE(root->kk);
+        if(root->perm != NULL)
+            FREE(root->perm);
+    }
+    root->kk   = NULL;
+    root->gpos = NULL;
+    root->gv   = NULL;
+    root->pos  = NULL;
+    root->adj  = NULL;
+    root->perm = NULL;
+    root->map  = NULL;
+    root->map_size = 0;
+}
+
+void steinerq_free(steinerq_t *root)
+{
+    steinerq_release(root);
     FREE(root);
 }
 
+// the vertices of terminal t, its group or kk[t] alone
+static inline index_t *group_of(index_t *kk, index_t *gpos, index_t *gv, 
+                                index_t t, index_t *len)
+{
+    if(gpos == NULL)
+    {
+        *len = 1;
+        return kk + t;
+    }
+    *len = gpos[t+1] - gpos[t];
+    return gv + gpos[t];
+}
+
+// the vertex of terminal t with the least label in row f, a tree of the
+// row that ends there reaches t
+static index_t group_root(index_t *kk, index_t *gpos, index_t *gv, 
+                          index_t t, dist_t *f)
+{
+    index_t len;
+    index_t *g = group_of(kk, gpos, gv, t, &len);
+    index_t q = g[0];
+    for(index_t i = 1; i < len; i++)
+        if(f[g[i]] < f[q])
+            q = g[i];
+    return q;
+}
+
+/******************************************************** Vertex reordering. */
+/*
+ * Renumbers the vertices of a built query so that vertices visited close in
+ * time are stored close in memory. The 'bfs' order is Cuthill-McKee: 
+ * breadth-first from a vertex of least degree in each component, placing
+ * the new neighbours of a vertex by increasing degree. 'rcm' reverses it
+ * and 'degree' sorts the vertices by decreasing degree. The query keeps
+ * perm[u], the input vertex of u, to list solutions in input numbering.
+ */
+
+#define ORDER_NONE              0
+#define ORDER_BFS               1
+#define ORDER_RCM               2
+#define ORDER_DEGREE            3
+
+char *order_legend[] = { "none", "bfs", "rcm", "degree" };
+
+index_t order_parse(const char *name)
+{
+    for(index_t o = ORDER_BFS; o <= ORDER_DEGREE; o++)
+        if(!strcmp(name, order_legend[o]))
+            return o;
+    ERROR("unknown vertex order '%s', expected bfs, rcm or degree", name);
+    return ORDER_NONE;
+}
+
+static int order_cmp_degree(const void *a, const void *b, void *arg)
+{
+    // increasing degree, ties by vertex
+    index_t *deg = (index_t *) arg;
+    index_t u = *(const index_t *) a;
+    index_t v = *(const index_t *) b;
+    if(deg[u] != deg[v])
+        return (deg[u] < deg[v]) ? -1 : 1;
+    return (u > v) - (u < v);
+}
+
+static int order_cmp_hubs(const void *a, const void *b, void *arg)
+{
+    // decreasing degree, ties by vertex
+    index_t *deg = (index_t *) arg;
+    index_t u = *(const index_t *) a;
+    index_t v = *(const index_t *) b;
+    if(deg[u] != deg[v])
+        return (deg[u] > deg[v]) ? -1 : 1;
+    return (u > v) - (u < v);
+}
+
+static double arc_span(index_t n, index_t m, index_t *pos, adj_t *adj)
+{
+    // mean distance |u-v| in storage over all arcs
+    double span = 0;
+    for(index_t u = 0; u < n; u++)
+        for(index_t i = ARC_FIRST(pos, adj, u); i < ARC_END(pos, adj, u); 
+            i += ARC_STEP)
+            span += labs(ARC_HEAD(adj, m, i) - u);
+    return span/(2*m);
+}
+
+void root_reorder(steinerq_t *root, index_t order)
+{
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    push_time();
+
+    index_t n    = root->n;
+    index_t m    = root->m;
+    index_t k    = root->k;
+    index_t *pos = root->pos;
+    adj_t *adj   = root->adj;
+    double span  = arc_span(n, m, pos, adj);
+
+    index_t *deg  = (index_t *) MALLOC(n*sizeof(index_t));
+    index_t *perm = (index_t *) MALLOC(n*sizeof(index_t));
+    index_t *inv  = (index_t *) MALLOC(n*sizeof(index_t));
+    for(index_t u = 0; u < n; u++)
+    {
+        deg[u]  = ARC_DEGREE(pos, adj, u);
+        perm[u] = u;
+    }
+
+    if(order == ORDER_DEGREE)
+    {
+        qsort_r(perm, n, sizeof(index_t), order_cmp_hubs, deg);
+    }
+    else
+    {
+        // roots are tried by increasing degree, inv marks placed vertices
+        index_t *start = (index_t *) MALLOC(n*sizeof(index_t));
+        for(index_t u = 0; u < n; u++)
+        {
+            start[u] = u;
+            inv[u]   = UNDEFINED;
+        }
+        qsort_r(start, n, sizeof(index_t), order_cmp_degree, deg);
+
+        index_t tail = 0;
+        for(index_t s = 0; s < n; s++)
+        {
+            if(inv[start[s]] != UNDEFINED)
+                continue;
+            index_t head = tail;
+            inv[start[s]] = tail;
+            perm[tail++]  = start[s];
+            for(; head < tail; head++)
+            {
+                index_t u = perm[head];
+                index_t first = tail;
+                for(index_t i = ARC_FIRST(pos, adj, u); 
+                    i < ARC_END(pos, adj, u); i += ARC_STEP)
+                {
+                    index_t v = ARC_HEAD(adj, m, i);
+                    if(inv[v] == UNDEFINED)
+                    {
+                        inv[v] = tail;
+                        perm[tail++] = v;
+                    }
+                }
+                qsort_r(perm + first, tail - first, sizeof(index_t), 
+                        order_cmp_degree, deg);
+            }
+        }
+        assert(tail == n);
+        FREE(start);
+
+        if(order == ORDER_RCM)
+        {
+            for(index_t u = 0; u < n/2; u++)
+            {
+                index_t t     = perm[u];
+                perm[u]       = perm[n-1-u];
+                perm[n-1-u]   = t;
+            }
+        }
+    }
+    for(index_t u = 0; u < n; u++)
+        inv[perm[u]] = u;
+
+    // rebuild the adjacency in the new numbering
+    index_t *pos_r = (index_t *) MALLOC(POS_LEN(n)*sizeof(index_t));
+    adj_t *adj_r   = (adj_t *) MALLOC(ADJ_LEN(n, m)*sizeof(adj_t));
+    index_t *kk_r  = (index_t *) MALLOC(k*sizeof(index_t));
+    for(index_t u = 0; u < n; u++)
+        pos_r[u] = ARC_STEP*deg[perm[u]];
+    index_t run = prefixsum(n, pos_r, ARC_HEADER);
+    assert(run == ARC_SLOTS(n, m));
+    arcs_clear(n, m, pos_r, adj_r, run);
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t u = 0; u < n; u++)
+    {
+        index_t x = perm[u];
+        for(index_t i = ARC_FIRST(pos, adj, x); i < ARC_END(pos, adj, x); 
+            i += ARC_STEP)
+            ARC_APPEND(pos_r, adj_r, m, u, inv[ARC_HEAD(adj, m, i)], 
+                       ARC_WEIGHT(adj, m, i));
+    }
+    arcs_close(n, pos_r);
+    for(index_t t = 0; t < k; t++)
+        kk_r[t] = inv[root->kk[t]];
+    // the groups are renamed in place and kept across the release
+    index_t *gpos = root->gpos;
+    index_t *gv   = root->gv;
+    for(index_t i = 0; gpos != NULL && i < gpos[k]; i++)
+        gv[i] = inv[gv[i]];
+    root->gpos = NULL;
+    root->gv   = NULL;
+
+    // an already reordered query keeps mapping to the input numbering
+    if(root->perm != NULL)
+        for(index_t u = 0; u < n; u++)
+            perm[u] = root->perm[perm[u]];
+
+    steinerq_release(root);
+    root->kk   = kk_r;
+    root->gpos = gpos;
+    root->gv   = gv;
+    root->pos  = pos_r;
+    root->adj  = adj_r;
+    root->perm = perm;
+    FREE(inv);
+    FREE(deg);
+
+    double time = pop_time();
+    fprintf(stdout, "reorder: [order: %s] [span: %.2lf -> %.2lf] done. "
+                    "[%.2lf ms] ", order_legend[order], span, 
+                    arc_span(n, m, pos_r, adj_r), time);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    fflush(stdout);
+}
+
+/********************************************************* Binary snapshots. */
+/*
+ * A snapshot stores a built root query: a versioned header, then the
+ * terminals and pos as index_t arrays, adj as adj_t and, for a reordered
+ * query, perm as index_t, in that order. Loading a file maps it and points
+ * the query at the arrays without copying, the mapping is private so the
+ * arrays stay writable.
+ */
+
+
+static size_t snapshot_payload(snapshot_header_t *h)
+{
+    return (h->k + POS_LEN(h->n))*sizeof(index_t) + 
+           ADJ_LEN(h->n, h->m)*sizeof(adj_t) +
+           ((h->layout & SNAPSHOT_REORDER) ? h->n*sizeof(index_t) : 0);
+}
+
+void snapshot_dump(const char *filename, steinerq_t *root, index_t cost)
+{
+    push_time();
+    FILE *out = fopen(filename, "wb");
+    if(out == NULL)
+        ERROR("unable to open snapshot file '%s'", filename);
+
+    snapshot_header_t h;
+    memset(&h, 0, sizeof(h));
+    h.magic       = SNAPSHOT_MAGIC;
+    h.version     = SNAPSHOT_VERSION;
+    h.index_bytes = sizeof(index_t);
+    h.n           = root->n;
+    h.m           = root->m;
+    h.k           = root->k;
+    h.cost        = cost;
+    h.layout      = SNAPSHOT_LAYOUT | (root->perm ? SNAPSHOT_REORDER : 0);
+    size_t len_pos = POS_LEN(root->n);
+    size_t len_adj = ADJ_LEN(root->n, root->m);
+    if(fwrite(&h, sizeof(h), 1, out) != 1 ||
+       fwrite(root->kk, sizeof(index_t), root->k, out) != (size_t) root->k ||
+       fwrite(root->pos, sizeof(index_t), len_pos, out) != len_pos ||
+       fwrite(root->adj, sizeof(adj_t), len_adj, out) != len_adj ||
+       (root->perm != NULL && 
+        fwrite(root->perm, sizeof(index_t), root->n, out) != (size_t) root->n))
+        ERROR("unable to write snapshot file '%s'", filename);
+    fclose(out);
+    double time = pop_time();
+    fprintf(stdout, "dump: %s [%.2lf ms]\n", filename, time);
+    fflush(stdout);
+}
+
+index_t snapshot_probe(const char *filename)
+{
+    index_t magic = 0;
+    FILE *in = fopen(filename, "rb");
+    if(in == NULL)
+        ERROR("unable to open file '%s'", filename);
+    if(fread(&magic, sizeof(magic), 1, in) != 1)
+        magic = 0;
+    fclose(in);
+    return magic == SNAPSHOT_MAGIC;
+}
+
+static void snapshot_check(snapshot_header_t *h, size_t size)
+{
+    if(h->magic != SNAPSHOT_MAGIC)
+        ERROR("not a snapshot");
+    if(h->version != SNAPSHOT_VERSION || h->index_bytes != sizeof(index_t))
+        ERROR("snapshot version %ld with %ld-byte indices, expected "
+              "version %d with %d-byte indices", h->version, h->index_bytes,
+              SNAPSHOT_VERSION, (int) sizeof(index_t));
+    if((h->layout & SNAPSHOT_COMPACT) != SNAPSHOT_LAYOUT)
+        ERROR("snapshot has the %s adjacency layout, this build reads the %s "
+              "layout", (h->layout & SNAPSHOT_COMPACT) ? "compact" : "default",
+              SNAPSHOT_LAYOUT ? "compact" : "default");
+    if(h->n <= 0 || h->m <= 0 || h->k <= 0 || h->k > MAX_K)
+        ERROR("invalid snapshot header");
+    size_t want = sizeof(snapshot_header_t) + snapshot_payload(h);
+    if(size != want)
+        ERROR("snapshot size %ld, expected %ld", (index_t) size, 
+              (index_t) want);
+}
+
+static steinerq_t *snapshot_root(snapshot_header_t *h, index_t *a, 
+                                 index_t *min_cost, double time)
+{
+    steinerq_t *root = (steinerq_t *) MALLOC(sizeof(steinerq_t));
+    root->n   = h->n;
+    root->m   = h->m;
+    root->k   = h->k;
+    root->kk  = a;
+    root->gpos = NULL;
+    root->gv   = NULL;
+    root->pos = a + h->k;
+    root->adj = (adj_t *) (root->pos + POS_LEN(h->n));
+    root->perm = (h->layout & SNAPSHOT_REORDER) ? 
+                 (index_t *) (root->adj + ADJ_LEN(h->n, h->m)) : NULL;
+    root->red = NULL;
+    root->map = NULL;
+    root->map_size = 0;
+    *min_cost = h->cost;
+
+    // same report as the loader and root build, nothing is built here
+    fprintf(stdout, "input: snapshot, n = %ld, m = %ld, k = %ld, cost = %ld "
+                    "[%.2lf ms] ", root->n, root->m, root->k, h->cost, time);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    fprintf(stdout, "terminals:");
+    for(index_t i = 0; i < root->k; i++) 
+        fprintf(stdout, " %ld", (root->perm ? root->perm[root->kk[i]] : 
+                                              root->kk[i])+1);
+    fprintf(stdout, "\n");
+    fprintf(stdout, "root build: snapshot [zero: 0.00 ms] [pos: 0.00 ms] "
+                    "[adj: 0.00 ms] [term: 0.00 ms] done. [0.00 ms] ");
+#ifdef TRACK_MEMORY
+    fprintf(stdout, "{peak: %.2lfGiB} ", inGiB(current_mem()));
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    fflush(stdout);
+    return root;
+}
+
+steinerq_t *snapshot_load(const char *filename, index_t *min_cost)
+{
+    push_time();
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if(fd < 0 || fstat(fd, &st) != 0)
+        ERROR("unable to open file '%s'", filename);
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED)
+        ERROR("mmap failed for snapshot '%s'", filename);
+    close(fd);
+
+    snapshot_header_t *h = (snapshot_header_t *) map;
+    snapshot_check(h, size);
+    index_t *a = (index_t *) ((char *) map + sizeof(snapshot_header_t));
+    steinerq_t *root = snapshot_root(h, a, min_cost, pop_time());
+    root->map      = map;
+    root->map_size = size;
+    return root;
+}
+
+steinerq_t *snapshot_read(FILE *in, index_t *min_cost)
+{
+    // streams cannot be mapped, this reads the arrays into one allocation
+    push_time();
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    snapshot_header_t h;
+    if(fread(&h, sizeof(h), 1, in) != 1)
+        ERROR("unable to read snapshot header");
+    size_t len = snapshot_payload(&h);
+    snapshot_check(&h, sizeof(h) + len);
+    index_t *a = (index_t *) MALLOC(len);
+    if(fread(a, 1, len, in) != len)
+        ERROR("truncated snapshot");
+    return snapshot_root(&h, a, min_cost, pop_time());
+}
+
 /********************************************************* Debug routines. */
 
 #ifdef DEBUG
@@ -948,14 +1832,13 @@ void print_array(index_t n, index_t *a)
     fflush(stdout);
 }
 
-void print_adj(index_t u, index_t *pos, index_t *adj)
+void print_adj(index_t u, index_t m, index_t *pos, adj_t *adj)
 {
-    index_t p = pos[u];
-    index_t nu = adj[p];
-    index_t *adj_u = adj + p + 1;
     fprintf(stdout, "adjacency list (%ld) : ", u);
-    for(index_t i = 0; i < nu; i++)
-        fprintf(stdout, " %ld %ld|", adj_u[2*i]+1, adj_u[2*i+1]);
+    for(index_t i = ARC_FIRST(pos, adj, u); i < ARC_END(pos, adj, u); 
+        i += ARC_STEP)
+        fprintf(stdout, " %ld %ld|", ARC_HEAD(adj, m, i)+1, 
+                                     ARC_WEIGHT(adj, m, i));
     fprintf(stdout, "\n");
 }
 
@@ -1029,26 +1912,22 @@ void print_steinerq(steinerq_t *root)
     fprintf(stdout, "m: %ld\n", root->m);
     fprintf(stdout, "k: %ld\n", root->k);
     index_t *pos = root->pos;
-    index_t *adj = root->adj;
+    adj_t *adj   = root->adj;
     fprintf(stdout, "pos:");
-    for(index_t i = 0; i < root->n; i++)
+    for(index_t i = 0; i < POS_LEN(root->n); i++)
         fprintf(stdout, " %ld", pos[i]);
     fprintf(stdout, "\nadj:\n");
-#ifdef BUILD_PARALLEL
-    index_t n = root->n + num_threads();
-#else
-    index_t n = root->n + 1;
-#endif
+    index_t n = root->n;
     for(index_t u = 0; u < n; u++)
     {
-        index_t pu = pos[u];
-        index_t adj_u = adj[pu];
-        fprintf(stdout, "node: %ld edges: %ld|", u+1, adj_u);
-        for(index_t i = 0; i < adj_u; i++)
+        fprintf(stdout, "node: %ld edges: %ld|", u+1, 
+                        (index_t) ARC_DEGREE(pos, adj, u));
+        for(index_t i = ARC_FIRST(pos, adj, u); i < ARC_END(pos, adj, u); 
+            i += ARC_STEP)
         {
             fprintf(stdout, " %4ld %4ld|", 
-                            adj[pu + 1 + (2*i)]+1, 
-                            adj[pu + 1 + (2*i+1)]);
+                            ARC_HEAD(adj, root->m, i)+1, 
+                            ARC_WEIGHT(adj, root->m, i));
         }
         fprintf(stdout, "\n");
     }
@@ -1056,7 +1935,7 @@ void print_steinerq(steinerq_t *root)
     fflush(stdout);
 }
 
-void print_f_v(index_t n, index_t k, index_t *f_v)
+void print_f_v(index_t n, index_t k, dist_t *f_v)
 {
     fprintf(stdout, "f_v: \n");
     for(index_t v = 0; v < n; v++) 
@@ -1066,16 +1945,16 @@ void print_f_v(index_t n, index_t k, index_t *f_v)
         {
             index_t i_X = FV_INDEX(v, n, k, X);
             print_nbits(k, X);
-            if(f_v[i_X] == MATH_INF)
+            if(f_v[i_X] == DIST_INF)
                 fprintf(stdout, " MATH_INF\n");
             else
-                fprintf(stdout, " %ld\n", f_v[i_X]);
+                fprintf(stdout, " %ld\n", (index_t) f_v[i_X]);
         }    
     }    
     fflush(stdout);
 }
 
-void print_b_v(index_t n, index_t k, index_t *b_v)
+void print_b_v(index_t n, index_t k, bptr_t *b_v)
 {
     fprintf(stdout, "b_v: \n");
     for(index_t v = 0; v < n; v++) 
@@ -1086,8 +1965,8 @@ void print_b_v(index_t n, index_t k, index_t *b_v)
             fprintf(stdout, "X: ");
             print_nbits(k, X);
             index_t i_bv = BV_INDEX(v, n, k, X);
-            index_t v = b_v[i_bv];
-            index_t Xd = b_v[i_bv + 1];
+            index_t v = BV_VERTEX(b_v[i_bv]);
+            index_t Xd = b_v[i_bv].X;
             fprintf(stdout, " v: %3ld Xd: ", v == -1 ? -1 : v+1);
             print_nbits(k, Xd); 
             fprintf(stdout, "\n");
@@ -1333,6 +2212,26 @@ static index_t bh_delete_min(bheap_t * h)
     bh_delete((bheap_t *)h, u);
     return u;
 }
+
+// bottom-up heap construction from the items with a finite key, O(n)
+static void bh_build(bheap_t *h, index_t n, dist_t *key, dist_t ub)
+{
+    h->n = 0;
+    for(index_t v = 0; v < n; v++)
+    {
+        if(key[v] == DIST_INF || key[v] > ub)
+            continue;
+        index_t i = ++(h->n);
+        h->a[i].item = v;
+        h->a[i].key  = key[v];
+        h->p[v] = i;
+    }
+    for(index_t i = h->n/2; i >= 1; i--)
+        bh_siftup(h, i, h->n);
+#ifdef TRACK_BANDWIDTH
+    h->mem += n;
+#endif
+}
 #endif
 
 /********************************************* Fibonacci heap implementation. */
@@ -1354,6 +2253,7 @@ typedef struct fheap
 {
     fheap_node_t **trees;
     fheap_node_t **nodes;
+    fheap_node_t *pool;  // one node per vertex, no allocation per insert
     index_t max_nodes; 
     index_t max_trees;
     index_t n;
@@ -1375,6 +2275,7 @@ fheap_t *fh_alloc(index_t max_nodes)
     h->max_nodes = max_nodes;
     h->trees = (fheap_node_t **) calloc(h->max_trees, sizeof(fheap_node_t *));
     h->nodes = (fheap_node_t **) calloc(max_nodes, sizeof(fheap_node_t *));
+    h->pool = (fheap_node_t *) malloc(max_nodes*sizeof(fheap_node_t));
     h->n = 0;
     h->value = 0;
 #ifdef TRACK_BANDWIDTH
@@ -1399,8 +2300,7 @@ void fh_free(fheap_t *h)
                      (h->max_nodes*sizeof(fheap_node_t *)) +
                      (h->max_nodes*sizeof(fheap_node_t)));
 #endif
-    //for(index_t i = 0; i < h->max_nodes; i++)
-    //    free(h->nodes[i]);
+    free(h->pool);
     free(h->nodes);
     free(h->trees);
     free(h);
@@ -1483,7 +2383,7 @@ void fh_meld(fheap_t *h, fheap_node_t *tree_list)
 void fh_insert(fheap_t *h, index_t vertex_no, index_t k)
 {
     fheap_node_t *new_node;
-    new_node = (fheap_node_t *) malloc(sizeof(fheap_node_t));
+    new_node = h->pool + vertex_no;
     new_node->child = NULL;
     new_node->left = new_node->right = new_node;
     new_node->rank = 0;
@@ -1546,7 +2446,6 @@ index_t fh_delete_min(fheap_t *h)
 
     vertex_no = min_node->vertex_no;
     h->nodes[vertex_no] = NULL;
-    free(min_node);
     h->n--;
 
 #ifdef TRACK_BANDWIDTH
@@ -1633,6 +2532,13 @@ void fh_decrease_key(fheap_t *h, index_t vertex_no, index_t new_value)
 #endif
 }
 
+void fh_build(fheap_t *h, index_t n, dist_t *key, dist_t ub)
+{
+    for(index_t v = 0; v < n; v++)
+        if(key[v] != DIST_INF && key[v] <= ub)
+            fh_insert(h, v, key[v]);
+}
+
 /************************************************** Debugging functions. */
 
 #if FHEAP_DUMP
@@ -1717,33 +2623,248 @@ void fh_dump(fheap_t *h)
 
 #endif
 
-/************************************************** Heap wrapper functions. */
+/************************************************* Radix heap implementation. */
+/*
+ * Monotone priority queue for non-negative integer keys. An item with key x 
+ * is kept in bucket 0 if x equals the last extracted minimum, and otherwise
+ * in bucket 1 + (position of the highest bit where x and the last minimum
+ * differ). Dijkstra with non-negative integer edge weights extracts keys in
+ * non-decreasing order, which is all that the structure relies on. Insert and
+ * decrease key are O(1), delete min is O(log C) amortised. 
+ *
+ */
 
-#ifdef BIN_HEAP
-// allocation
-#define heap_alloc(n) bh_alloc((n))
-#define heap_free(h) bh_free((bheap_t *)(h));
-// heap operations
-#define heap_insert(h, v, k) bh_insert((h), (v), (k))
-#define heap_delete_min(h) bh_delete_min((h));
-#define heap_decrease_key(h, v, k) bh_decrease_key((h), (v), (k));
-// fetch structure elements
-#define heap_n(h) ((bheap_t *)h)->n;
-#define heap_key_comps(h) ((bheap_t *)h)->key_comps;
-#define heap_mem(h) (h)->mem;
-// debug
-#define heap_dump(h) bh_dump((bheap_t *)(h));
+#ifdef RADIX_HEAP
+#define RHEAP_BUCKETS 64 // keys are below 2^63, bit 63 never differs
 
-#define heap_node_t bheap_item_t
-#define heap_t bheap_t
+typedef struct rheap_node
+{
+    index_t key;
+    index_t prev;   // bucket list neighbours, -1 terminates
+    index_t next;
+    index_t bucket;
+} rheap_node_t;
+
+typedef struct rheap
+{
+    index_t max_n;
+    index_t n;                         // number of items in the heap
+    index_t last;                      // last extracted minimum
+    unsigned long nonempty;            // bit b is set if bucket b is in use
+    index_t head[RHEAP_BUCKETS];       // first item of each bucket
+    rheap_node_t *a;                   // per item key and bucket links
+#ifdef TRACK_BANDWIDTH
+    index_t key_comps;
+    index_t mem;
+#endif
+} rheap_t;
+
+rheap_t * rh_alloc(index_t n)
+{
+    rheap_t *h = (rheap_t *) malloc(sizeof(rheap_t));
+    h->max_n = n;
+    h->n = 0;
+    h->last = 0;
+    h->nonempty = 0;
+    for(index_t b = 0; b < RHEAP_BUCKETS; b++)
+        h->head[b] = -1;
+    h->a = (rheap_node_t *) malloc(n*sizeof(rheap_node_t));
+#ifdef TRACK_BANDWIDTH
+    h->key_comps  = 0; 
+    h->mem = 0;
+#endif
+#ifdef TRACK_MEMORY
+    inc_malloc_total(sizeof(rheap_t) + (n*sizeof(rheap_node_t)));
+#endif
+    return h;
+}
+
+void rh_free(rheap_t *h)
+{
+#ifdef TRACK_MEMORY
+    dec_malloc_total(sizeof(rheap_t) + (h->max_n*sizeof(rheap_node_t)));
+#endif
+    free(h->a);
+    free(h);
+}
+
+/*************************************************** Radix heap operations. */
+
+static inline index_t rh_bucket(rheap_t *h, index_t key)
+{
+    index_t x = key ^ h->last;
+    return (x == 0) ? 0 : 64 - __builtin_clzl((unsigned long) x);
+}
+
+static inline void rh_link(rheap_t *h, index_t item, index_t b)
+{
+    rheap_node_t *e = h->a + item;
+    index_t first = h->head[b];
+    e->bucket = b;
+    e->prev = -1;
+    e->next = first;
+    if(first != -1)
+        h->a[first].prev = item;
+    h->head[b] = item;
+    h->nonempty |= (1UL << b);
+}
+
+static inline void rh_unlink(rheap_t *h, index_t item)
+{
+    rheap_node_t *e = h->a + item;
+    index_t b = e->bucket;
+    if(e->prev != -1)
+        h->a[e->prev].next = e->next;
+    else
+        h->head[b] = e->next;
+    if(e->next != -1)
+        h->a[e->next].prev = e->prev;
+    if(h->head[b] == -1)
+        h->nonempty &= ~(1UL << b);
+}
+
+static void rh_insert(rheap_t *h, index_t item, index_t key)
+{
+    assert(key >= h->last);
+    h->a[item].key = key;
+    rh_link(h, item, rh_bucket(h, key));
+    h->n++;
+#ifdef TRACK_BANDWIDTH
+    h->mem += 2;
+#endif
+}
+
+static void rh_decrease_key(rheap_t *h, index_t item, index_t new_key)
+{
+    assert(new_key >= h->last);
+    index_t b = rh_bucket(h, new_key);
+    h->a[item].key = new_key;
+#ifdef TRACK_BANDWIDTH
+    h->mem++;
+#endif
+    if(b != h->a[item].bucket)
+    {
+        rh_unlink(h, item);
+        rh_link(h, item, b);
+#ifdef TRACK_BANDWIDTH
+        h->mem += 4;
+#endif
+    }
+}
+
+static index_t rh_delete_min(rheap_t *h)
+{
+#ifdef TRACK_BANDWIDTH
+    index_t mem = 0;
+    index_t key_comps = 0;
+#endif
+    if(h->head[0] == -1)
+    {
+        // smallest non-empty bucket holds the minimum, redistribute it 
+        index_t b = __builtin_ctzl(h->nonempty);
+        index_t min = MATH_INF;
+        for(index_t i = h->head[b]; i != -1; i = h->a[i].next)
+        {
+#ifdef TRACK_BANDWIDTH
+            mem++;
+            key_comps++;
+#endif
+            if(h->a[i].key < min)
+                min = h->a[i].key;
+        }
+        h->last = min;
+
+        index_t i = h->head[b];
+        h->head[b] = -1;
+        h->nonempty &= ~(1UL << b);
+        while(i != -1)
+        {
+            index_t next = h->a[i].next;
+            rh_link(h, i, rh_bucket(h, h->a[i].key));
+            i = next;
+#ifdef TRACK_BANDWIDTH
+            mem += 2;
+#endif
+        }
+    }
+
+    index_t u = h->head[0];
+    rh_unlink(h, u);
+    h->n--;
+#ifdef TRACK_BANDWIDTH
+    h->mem += mem + 2;
+    h->key_comps += key_comps;
+#endif
+    return u;
+}
+
+// empty heap accepts keys from zero again
+static void rh_reset(rheap_t *h)
+{
+    assert(h->n == 0 && h->nonempty == 0);
+    h->last = 0;
+}
+
+static void rh_build(rheap_t *h, index_t n, dist_t *key, dist_t ub)
+{
+    for(index_t v = 0; v < n; v++)
+        if(key[v] != DIST_INF && key[v] <= ub)
+            rh_insert(h, v, key[v]);
+}
+
+#ifdef RHEAP_DUMP
+// debug function
+void rh_dump(rheap_t *h)
+{
+    fprintf(stdout, "Radix heap: last = %ld\n", h->last);
+    for(index_t b = 0; b < RHEAP_BUCKETS; b++)
+    {
+        if(h->head[b] == -1)
+            continue;
+        fprintf(stdout, "bucket %ld:", b);
+        for(index_t i = h->head[b]; i != -1; i = h->a[i].next)
+        {
+            fprintf(stdout, " %ld(%ld)", i, h->a[i].key);
+            if(rh_bucket(h, h->a[i].key) != b)
+                ERROR("bucket error at item %ld, key %ld", i, h->a[i].key);
+        }
+        fprintf(stdout, "\n");
+    }
+}
+#endif
+#endif
+
+/************************************************** Heap wrapper functions. */
+
+#ifdef BIN_HEAP
+// allocation
+#define heap_alloc(n) bh_alloc((n))
+#define heap_free(h) bh_free((bheap_t *)(h));
+#define heap_reset(h) ((bheap_t *)(h))->n = 0;
+// heap operations
+#define heap_insert(h, v, k) bh_insert((h), (v), (k))
+#define heap_build(h, n, k, ub) bh_build((h), (n), (k), (ub))
+#define heap_delete_min(h) bh_delete_min((h));
+#define heap_decrease_key(h, v, k) bh_decrease_key((h), (v), (k));
+// fetch structure elements
+#define heap_n(h) ((bheap_t *)h)->n;
+#define heap_key_comps(h) ((bheap_t *)h)->key_comps;
+#define heap_mem(h) (h)->mem;
+// debug
+#define heap_dump(h) bh_dump((bheap_t *)(h));
+
+#define heap_node_t bheap_item_t
+#define heap_t bheap_t
 #endif
 
 #ifdef FIB_HEAP
 // allocation
 #define heap_alloc(n) fh_alloc((n))
 #define heap_free(h) fh_free((fheap_t *)(h));
+#define heap_reset(h) assert(((fheap_t *)(h))->n == 0);
 // heap operations
 #define heap_insert(h, v, k) fh_insert((h), (v), (k));
+#define heap_build(h, n, k, ub) fh_build((h), (n), (k), (ub))
 #define heap_delete_min(h) fh_delete_min((h));
 #define heap_decrease_key(h, v, k) fh_decrease_key((h), (v), (k));
 // fetch structure elements
@@ -1757,18 +2878,107 @@ void fh_dump(fheap_t *h)
 #define heap_t fheap_t
 #endif
 
+#ifdef RADIX_HEAP
+// allocation
+#define heap_alloc(n) rh_alloc((n))
+#define heap_free(h) rh_free((rheap_t *)(h));
+#define heap_reset(h) rh_reset((rheap_t *)(h));
+// heap operations
+#define heap_insert(h, v, k) rh_insert((h), (v), (k))
+#define heap_build(h, n, k, ub) rh_build((h), (n), (k), (ub))
+#define heap_delete_min(h) rh_delete_min((h));
+#define heap_decrease_key(h, v, k) rh_decrease_key((h), (v), (k));
+// fetch structure elements
+#define heap_n(h) ((rheap_t *)h)->n;
+#define heap_key_comps(h) ((rheap_t *)h)->key_comps;
+#define heap_mem(h) (h)->mem;
+// debug
+#define heap_dump(h) rh_dump((rheap_t *)(h));
+
+#define heap_node_t rheap_node_t
+#define heap_t rheap_t
+#endif
+
+// bytes of a heap entry of this build, for the bandwidth figures
+size_t heap_node_size(void)
+{
+    return sizeof(heap_node_t);
+}
+
+/********************************************************* Dijkstra workspace. */
+/*
+ * Per-thread scratch state for repeated Dijkstra runs, allocated once per 
+ * solve. Instead of clearing a visit array, every run takes a fresh 
+ * generation g: vertex v is labelled by a relaxation in the current run if
+ * mark[v] == g, and settled if mark[v] == g+1. The marks are only cleared 
+ * when the generation counter wraps around.
+ *
+ */
+
+struct dijkstra_ws
+{
+    index_t n;
+    heap_t *h;
+    unsigned int gen;
+    unsigned int *mark;
+#ifdef TRACK_OPTIMAL
+    index_t *p;           // predecessors of the vertices settled in last run
+#endif
+};
+
+dijkstra_ws_t *dijkstra_ws_alloc(index_t n)
+{
+    dijkstra_ws_t *ws = (dijkstra_ws_t *) MALLOC(sizeof(dijkstra_ws_t));
+    ws->n    = n;
+    ws->h    = heap_alloc(n);
+    ws->gen  = 0;
+    ws->mark = (unsigned int *) CALLOC(n, sizeof(unsigned int));
+#ifdef TRACK_OPTIMAL
+    ws->p    = (index_t *) MALLOC(n*sizeof(index_t));
+#endif
+    return ws;
+}
+
+void dijkstra_ws_free(dijkstra_ws_t *ws)
+{
+    heap_free(ws->h);
+    FREE(ws->mark);
+#ifdef TRACK_OPTIMAL
+    FREE(ws->p);
+#endif
+    FREE(ws);
+}
+
+#ifdef TRACK_OPTIMAL
+index_t *dijkstra_ws_pred(dijkstra_ws_t *ws)
+{
+    return ws->p;
+}
+#endif
+
+// start a new run, returns the generation of the run 
+static unsigned int dijkstra_ws_next(dijkstra_ws_t *ws)
+{
+    if(ws->gen >= UINT_MAX-3)
+    {
+        for(index_t v = 0; v < ws->n; v++)
+            ws->mark[v] = 0;
+        ws->gen = 0;
+    }
+    ws->gen += 2;
+    heap_reset(ws->h);
+    return ws->gen;
+}
+
 /************************************************** Dijkstra shortest path*/
 
 void dijkstra(index_t n,
               index_t m, 
               index_t *pos, 
-              index_t *adj, 
+              adj_t *adj, 
               index_t s, 
-              index_t *d,
-              index_t *visit
-#ifdef TRACK_OPTIMAL
-              ,index_t *p
-#endif
+              dist_t *d,
+              dijkstra_ws_t *ws
 #ifdef TRACK_BANDWIDTH
               ,index_t *heap_ops
 #endif
@@ -1780,7 +2990,12 @@ void dijkstra(index_t n,
     fflush(stdout);
 #endif
 
-    heap_t *h = heap_alloc(n);
+    heap_t *h = ws->h;
+    unsigned int *mark = ws->mark;
+    unsigned int g = dijkstra_ws_next(ws);
+#ifdef TRACK_OPTIMAL
+    index_t *p = ws->p;
+#endif
 
 #ifdef DIJKSTRA_BENCHMARK
 #ifdef TRACK_MEMORY
@@ -1790,13 +3005,7 @@ void dijkstra(index_t n,
 #endif
 
     for(index_t v = 0; v < n; v++)
-    {
-        d[v]     = MAX_DISTANCE; // mem: n
-        visit[v] = 0; // mem: n
-#ifdef TRACK_OPTIMAL
-        p[v] = UNDEFINED; // mem: n
-#endif
-    }
+        d[v] = DIST_INF; // mem: n
     d[s] = 0;
 
 #ifdef DIJKSTRA_BENCHMARK
@@ -1821,18 +3030,21 @@ void dijkstra(index_t n,
     while(h->n > 0)
     {
         index_t u = heap_delete_min(h); 
-        visit[u]  = 1;
+#ifdef TRACK_OPTIMAL
+        if(mark[u] != g)
+            p[u] = UNDEFINED;
+#endif
+        mark[u] = g+1;
 
-        index_t pos_u  = pos[u];
-        index_t *adj_u = adj + pos_u;
-        index_t n_u  = adj_u[0];
-        for(index_t i = 1; i <= 2*n_u; i += 2)
+        index_t end_u = ARC_END(pos, adj, u);
+        for(index_t i = ARC_FIRST(pos, adj, u); i < end_u; i += ARC_STEP)
         {
-            index_t v   = adj_u[i];
-            index_t d_v = d[u] + adj_u[i+1];
-            if(!visit[v] && d[v] > d_v)
+            index_t v   = ARC_HEAD(adj, m, i);
+            index_t d_v = d[u] + ARC_WEIGHT(adj, m, i);
+            if(mark[v] != g+1 && d[v] > d_v)
             {
                 d[v] = d_v;
+                mark[v] = g;
                 heap_decrease_key(h, v, d_v);
 #ifdef TRACK_OPTIMAL
                 p[v] = u;
@@ -1876,450 +3088,4233 @@ void dijkstra(index_t n,
 #ifdef TRACK_BANDWIDTH
     *heap_ops = heap_mem(h);
 #endif
-    heap_free(h);
 }
 
-/*************************************************** Traceback Steiner tree. */
+/*********************************************** Multi-source Dijkstra. */
+/*
+ * Shortest path labels from the initial labels in d, computed in place:
+ * on return d[v] = min_u (d[u] + dist(u, v)). Only vertices with a finite
+ * initial label are placed in the heap, the rest enter when first reached.
+ * With TRACK_OPTIMAL, ws->p[v] of a settled vertex v is its predecessor, or
+ * UNDEFINED if the initial label of v was not improved. Returns the least
+ * settled label.
+ *
+ * With pruning, labels above the upper bound pr->ub are left as they are
+ * and never propagated, and a settled vertex u is not scanned if d[u] + 
+ * lb(u) > ub, where lb(u) is the largest distance d(u, kk[t]) = 
+ * pr->lb[u*pr->kb + t] over the terminals t in 'mask'. Thread th counts the
+ * labels over the bound, the skipped scans and the skipped merges in 
+ * pr->pruned[3*th], [3*th+1] and [3*th+2].
+ */
 
-#ifdef TRACK_OPTIMAL
-void list_solution(graph_t *g)
+struct prune
 {
-    index_t m = g->num_edges;
-    index_t *e = g->edges;
-    index_t i = 0;
+    dist_t ub;          // cost of a heuristic tree
+    index_t kb;         // terminal distances per vertex in lb
+    dist_t *lb;
+    dist_t *row_min;    // least label of each finished subset, 0 if unknown
+    index_t *pruned;
+};
 
-    fprintf(stdout, "solution: [");
-    for(i = 0; i < (3*m-3); i+=3)
+dist_t dijkstra_multi(index_t n,
+                      index_t m, 
+                      index_t *pos, 
+                      adj_t *adj, 
+                      dist_t *d,
+                      dijkstra_ws_t *ws,
+                      prune_t *pr,
+                      index_t mask,
+                      index_t th
+#ifdef TRACK_BANDWIDTH
+                      ,index_t *heap_ops
+#endif
+                     )
+{
+    heap_t *h = ws->h;
+    unsigned int *mark = ws->mark;
+    unsigned int g = dijkstra_ws_next(ws);
+#ifdef TRACK_OPTIMAL
+    index_t *p = ws->p;
+#endif
+    dist_t ub = DIST_INF;
+    dist_t *lb = NULL;
+    index_t *pruned = NULL;
+    if(pr != NULL)
     {
-        index_t u = e[i];
-        index_t v = e[i+1];
-        //index_t w = e[i+2];
-        fprintf(stdout, "\"%ld %ld\", ", u+1, v+1);
+        ub = pr->ub;
+        lb = (mask != 0) ? pr->lb : NULL;
+        pruned = pr->pruned + 3*th;
+        for(index_t v = 0; v < n; v++)
+            if(d[v] != DIST_INF && d[v] > ub)
+                pruned[0]++;
     }
-    index_t u = e[i];
-    index_t v = e[i+1];
-    //index_t w = e[i+2];
-    fprintf(stdout, "\"%ld %ld\"", u+1, v+1);
-    fprintf(stdout, "]\n");
-    fflush(stdout);
-}
 
-void backtrack(index_t n, index_t k, index_t v, 
-               index_t X, index_t *kk, index_t *b_v,
-               graph_t *g)
-{
-    if(X == 0 || v == -1)
-        return;
-
-    index_t i_X = BV_INDEX(v, n, k, X);
-    index_t u = b_v[i_X];
+    // labels above ub stay in place but out of the heap
+    heap_build(h, n, d, ub);
 
-    if(v != u)
-    {
-        graph_add_edge(g, v, u, 1);
-        index_t Xd = b_v[i_X+1];
-        backtrack(n, k, u, Xd, kk, b_v, g);
-    }
-    else
+    //visit and label
+    dist_t d_min = DIST_INF;
+    while(h->n > 0)
     {
-        index_t Xd = b_v[i_X+1];
-        index_t X_Xd = (X & ~Xd);
-        if(X == Xd)
-            return;
-        backtrack(n, k, u, Xd, kk, b_v, g);
-        backtrack(n, k, u, X_Xd, kk, b_v, g);
+        index_t u = heap_delete_min(h); 
+#ifdef TRACK_OPTIMAL
+        if(mark[u] != g)
+            p[u] = UNDEFINED;
+#endif
+        mark[u] = g+1;
+        if(d_min == DIST_INF)
+            d_min = d[u];
+
+        if(lb != NULL)
+        {
+            // the rest of a tree through u reaches every terminal in mask
+            dist_t *lb_u = lb + u*pr->kb;
+            dist_t lb_max = 0;
+            for(index_t M = mask; M != 0; M &= M-1)
+                lb_max = MAX(lb_max, lb_u[__builtin_ctzl(M)]);
+            if(lb_max > ub - d[u])
+            {
+                pruned[1]++;
+                continue;
+            }
+        }
+
+        index_t end_u = ARC_END(pos, adj, u);
+        for(index_t i = ARC_FIRST(pos, adj, u); i < end_u; i += ARC_STEP)
+        {
+            index_t v   = ARC_HEAD(adj, m, i);
+            index_t d_v = d[u] + ARC_WEIGHT(adj, m, i);
+            if(mark[v] != g+1 && d[v] > d_v)
+            {
+                if(d_v > ub)
+                {
+                    pruned[0]++;
+                    continue;
+                }
+                if(d[v] == DIST_INF || d[v] > ub) 
+                {
+                    heap_insert(h, v, d_v);
+                }
+                else
+                {
+                    heap_decrease_key(h, v, d_v);
+                }
+                d[v] = d_v;
+                mark[v] = g;
+#ifdef TRACK_OPTIMAL
+                p[v] = u;
+#endif
+            }
+        }
+        // mem: n+6m
     }
+
+#ifdef TRACK_BANDWIDTH
+    *heap_ops = heap_mem(h);
+#endif
+    return d_min;
 }
 
-graph_t * build_tree(index_t n, index_t k, index_t *kk, index_t *b_v)
+/************************************************** Parallel delta-stepping. */
+/*
+ * Multi-source shortest paths with all threads on one table row, for the 
+ * levels with fewer subsets than threads. Same contract as dijkstra_multi
+ * with ws->p replaced by dw->p, the labels come out equal to it.
+ *
+ * Labels are kept in buckets of width delta, bucket b holding the labels
+ * in [b*delta, (b+1)*delta). The threads scan the least non-empty bucket
+ * together and lower the labels of the heads with compare-and-swap, a 
+ * lowered head goes to the bucket of its new label in a per-thread ring 
+ * of nb buckets. Labels past the window of the ring wait in a per-thread
+ * overflow list until the window reaches them. A vertex is scanned again
+ * if its label drops within the current bucket, and an entry whose vertex
+ * has since moved to a lower bucket is stale and skipped.
+ *
+ * The step width is the mean arc weight. With TRACK_OPTIMAL the
+ * predecessors are recovered afterwards: a lowered label takes a neighbour
+ * with a smaller label on a shortest path, and labels tied over zero
+ * weight arcs are chained to a resolved neighbour in a last serial pass.
+ */
+
+#ifndef DELTA_MIN_N
+#define DELTA_MIN_N  4096    // smaller rows stay with one thread
+#endif
+#define DELTA_RING   (1L << 16)
+#define DELTA_NONE   ((index_t) 0x7FFFFFFFFFFFFFFFL)
+
+typedef struct delta_queue
 {
-    index_t c = k-1;
-    index_t C = (1<<c)-1;
-    index_t q = kk[k-1];
+    index_t len;
+    index_t cap;
+    index_t *v;
+} delta_queue_t;
 
-    graph_t *g = graph_alloc();
-    g->n = n;
-    backtrack(n, k, q, C, kk, b_v, g);
-    return g;
+struct delta_ws
+{
+    index_t n;
+    index_t nt;
+    index_t *pos;           // graph the step width is for
+    adj_t *adj;
+    index_t delta;
+    index_t nb;
+    delta_queue_t *bin;     // nt rings of nb buckets
+    delta_queue_t *over;    // per thread overflow
+    index_t *ring_len;      // entries in the ring of a thread
+    index_t *ring_lo;       // least bucket the ring of a thread may hold
+    index_t *over_lo;       // least bucket in the overflow of a thread
+    index_t *cand;          // least bucket of a thread in this step
+    index_t *count;         // entries of a thread in the current bucket
+    index_t *front;         // entries of the current bucket
+    index_t front_cap;
+#ifdef TRACK_OPTIMAL
+    dist_t *d0;             // labels before the run
+    char *settled;
+    index_t *p;
+#endif
+};
+
+delta_ws_t *delta_ws_alloc(index_t n, index_t nt)
+{
+    delta_ws_t *dw = (delta_ws_t *) MALLOC(sizeof(delta_ws_t));
+    dw->n         = n;
+    dw->nt        = nt;
+    dw->pos       = NULL;
+    dw->adj       = NULL;
+    dw->delta     = 1;
+    dw->nb        = 0;
+    dw->bin       = NULL;
+    dw->over      = (delta_queue_t *) CALLOC(nt, sizeof(delta_queue_t));
+    dw->ring_len  = (index_t *) MALLOC(nt*sizeof(index_t));
+    dw->ring_lo   = (index_t *) MALLOC(nt*sizeof(index_t));
+    dw->over_lo   = (index_t *) MALLOC(nt*sizeof(index_t));
+    dw->cand      = (index_t *) MALLOC(nt*sizeof(index_t));
+    dw->count     = (index_t *) MALLOC(nt*sizeof(index_t));
+    dw->front_cap = n;
+    dw->front     = (index_t *) MALLOC(n*sizeof(index_t));
+#ifdef TRACK_OPTIMAL
+    dw->d0        = (dist_t *) MALLOC(n*sizeof(dist_t));
+    dw->settled   = (char *) MALLOC(n*sizeof(char));
+    dw->p         = (index_t *) MALLOC(n*sizeof(index_t));
+#endif
+    return dw;
 }
 
-graph_t * tracepath(index_t n, index_t s, index_t v, index_t *p)
+static void delta_queues_free(delta_queue_t *a, index_t len)
 {
-    index_t u = p[v];
+    for(index_t i = 0; i < len; i++)
+        free(a[i].v);
+    FREE(a);
+}
 
-    graph_t *g = graph_alloc();
-    g->n = n;
-    while(u != s)
+void delta_ws_free(delta_ws_t *dw)
+{
+    if(dw->bin != NULL)
+        delta_queues_free(dw->bin, dw->nt*dw->nb);
+    delta_queues_free(dw->over, dw->nt);
+    FREE(dw->ring_len);
+    FREE(dw->ring_lo);
+    FREE(dw->over_lo);
+    FREE(dw->cand);
+    FREE(dw->count);
+    FREE(dw->front);
+#ifdef TRACK_OPTIMAL
+    FREE(dw->d0);
+    FREE(dw->settled);
+    FREE(dw->p);
+#endif
+    FREE(dw);
+}
+
+// step width and ring size of the graph, once per graph
+static void delta_ws_graph(delta_ws_t *dw, index_t n, index_t m, 
+                           index_t *pos, adj_t *adj)
+{
+    if(dw->pos == pos && dw->adj == adj)
+        return;
+    index_t total = 0;
+    index_t w_max = 0;
+    index_t arcs  = 0;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for reduction(+:total,arcs) reduction(max:w_max)
+#endif
+    for(index_t u = 0; u < n; u++)
     {
-        graph_add_edge(g, v, u, 1);
-        v = u;
-        u = p[v];
+        index_t end_u = ARC_END(pos, adj, u);
+        for(index_t i = ARC_FIRST(pos, adj, u); i < end_u; i += ARC_STEP)
+        {
+            index_t w = ARC_WEIGHT(adj, m, i);
+            total += w;
+            w_max  = MAX(w_max, w);
+            arcs++;
+        }
     }
-    graph_add_edge(g, v, u, 1);
-    return g;
+    index_t delta = MAX(1, (arcs > 0) ? total/arcs : 1);
+    // a relaxation lands at most w_max/delta + 1 buckets ahead
+    index_t nb = 256;
+    while(nb < DELTA_RING && nb < 2*(w_max/delta + 2))
+        nb *= 2;
+    if(dw->bin != NULL)
+        delta_queues_free(dw->bin, dw->nt*dw->nb);
+    dw->bin   = (delta_queue_t *) CALLOC(dw->nt*nb, sizeof(delta_queue_t));
+    dw->nb    = nb;
+    dw->delta = delta;
+    dw->pos   = pos;
+    dw->adj   = adj;
 }
 
-#endif
+// the threads grow their queues at once, so not through the memory 
+// tracker, whose counters are not locked
+static inline void delta_queue_push(delta_queue_t *q, index_t v)
+{
+    if(q->len == q->cap)
+    {
+        index_t cap = MAX(2*q->cap, 64);
+        q->v = (index_t *) realloc(q->v, cap*sizeof(index_t));
+        if(q->v == NULL)
+            ERROR("malloc fails");
+        q->cap = cap;
+    }
+    q->v[q->len++] = v;
+}
 
-/**************************************************** Erickson Monma Veinott. */
+// queue v of thread th at bucket b, cur is the bucket scanned now
+static inline void delta_push(delta_ws_t *dw, index_t th, index_t v, 
+                              index_t b, index_t cur)
+{
+    if(b < cur + dw->nb)
+    {
+        delta_queue_push(dw->bin + th*dw->nb + (b & (dw->nb-1)), v);
+        dw->ring_len[th]++;
+        dw->ring_lo[th] = MIN(dw->ring_lo[th], b);
+    }
+    else
+    {
+        delta_queue_push(dw->over + th, v);
+        dw->over_lo[th] = MIN(dw->over_lo[th], b);
+    }
+}
 
-index_t emv_kernel(index_t n, 
-                    index_t m, 
-                    index_t k, 
-                    index_t c, 
-                    index_t C, 
-                    index_t q, 
-                    index_t *kk, 
-                    index_t *f_v, 
-                    index_t *pos, 
-                    index_t *adj, 
-                    index_t *d,  
-                    index_t *visit,
-                    index_t nt
-#ifdef TRACK_OPTIMAL
-                    ,index_t *p
-                    ,index_t *b_v 
-#endif
-#ifdef TRACK_BANDWIDTH
-                    ,index_t *heap_ops
-#endif
-                    )
+dist_t delta_multi(index_t n,
+                   index_t m, 
+                   index_t *pos, 
+                   adj_t *adj, 
+                   dist_t *d,
+                   delta_ws_t *dw,
+                   prune_t *pr,
+                   index_t mask)
 {
-    // initialisation
-    index_t block_size = k/nt;
+    delta_ws_graph(dw, n, m, pos, adj);
+    index_t nt    = dw->nt;
+    index_t nb    = dw->nb;
+    index_t delta = dw->delta;
+    dist_t ub = (pr != NULL) ? pr->ub : DIST_INF;
+    dist_t *lb = (pr != NULL && mask != 0) ? pr->lb : NULL;
+
+    dist_t d_min = DIST_INF;
 #ifdef BUILD_PARALLEL
-#pragma omp parallel for
+#pragma omp parallel for reduction(min:d_min)
 #endif
-    for(index_t th = 0; th < nt; th++) // one thread per core
+    for(index_t v = 0; v < n; v++)
     {
-        index_t start = th*block_size;
-        index_t stop = (th == nt-1) ? k-1 : (start+block_size-1);
-        index_t *d_th = d + (n+nt)*th;
-        index_t *visit_th = visit + (n+nt)*th;
 #ifdef TRACK_OPTIMAL
-        index_t *p_th = p + (n+nt)*th;
-#endif
-#ifdef TRACK_BANDWIDTH
-        index_t *heap_ops_th = heap_ops + th;
+        dw->d0[v] = d[v];
 #endif
+        if(d[v] <= ub)
+            d_min = MIN(d_min, d[v]);
+    }
+    // labels above ub stay in place and are never queued
+    index_t base = (d_min == DIST_INF) ? 0 : ((index_t) d_min)/delta;
 
-        for(index_t t = start; t <= stop; t++) 
-        {    
-            dijkstra(n+1, m, pos, adj, kk[t], d_th, visit_th
-#ifdef TRACK_OPTIMAL
-                     ,p_th
-#endif
-#ifdef TRACK_BANDWIDTH
-                     ,heap_ops_th
+#ifdef BUILD_PARALLEL
+#pragma omp parallel num_threads(nt)
 #endif
-                     );
-            index_t *f_t = f_v + FV_INDEX(0, n, k, 1<<t);
-#ifdef TRACK_OPTIMAL
-            index_t *b_t = b_v + BV_INDEX(0, n, k, 1<<t);
+    {
+        index_t th = thread_id();
+        index_t *pruned = (pr != NULL) ? pr->pruned + 3*th : NULL;
+        delta_queue_t *ring = dw->bin + th*nb;
+        delta_queue_t *over = dw->over + th;
+        dw->ring_len[th] = 0;
+        dw->ring_lo[th]  = DELTA_NONE;
+        dw->over_lo[th]  = DELTA_NONE;
+        index_t cur = base;
+#ifdef BUILD_PARALLEL
+#pragma omp for schedule(static)
 #endif
+        for(index_t v = 0; v < n; v++)
+        {
+            if(d[v] == DIST_INF)
+                continue;
+            if(d[v] > ub)
+                pruned[0]++;
+            else
+                delta_push(dw, th, v, ((index_t) d[v])/delta, cur);
+        }
 
-            for(index_t v = 0; v < n; v++) 
+        while(1)
+        {
+            // the least non-empty bucket over all threads
+            if(dw->ring_len[th] == 0)
+                dw->ring_lo[th] = DELTA_NONE;
+            else
             {
-                f_t[v] = d_th[v]; 
-#ifdef TRACK_OPTIMAL
-                b_t[2*v] = kk[t];
-                b_t[2*v + 1] = (1<<t);
-#endif
+                index_t b = MAX(dw->ring_lo[th], cur);
+                while(ring[b & (nb-1)].len == 0)
+                    b++;
+                dw->ring_lo[th] = b;
             }
-            // mem: 2*k*n
-        }    
-    }
-
-    for(index_t m = 2; m <= k; m++) // k-2
-    {    
-        index_t kCm = choose(k, m);
-     
-        index_t i = 0; 
-        index_t *X_a = (index_t *) MALLOC(kCm * sizeof(index_t));
+            dw->cand[th] = MIN(dw->ring_lo[th], dw->over_lo[th]);
+#ifdef BUILD_PARALLEL
+#pragma omp barrier
+#endif
+            index_t next = DELTA_NONE;
+            for(index_t j = 0; j < nt; j++)
+                next = MIN(next, dw->cand[j]);
+            if(next == DELTA_NONE)
+                break;
+            cur = next;
 
-        index_t z = 0;
-        for(index_t X = (1<<m)-1;
-            X < (1<<k);
-            z = X|(X-1), X = (z+1)|(((~z & -~z)-1) >> (__builtin_ctz(X) + 1))) // cCm
-        {
-            X_a[i++] = X;
-        }
+            // the window moved over some overflow, bring it into the ring
+            if(dw->over_lo[th] < cur + nb)
+            {
+                index_t len = over->len;
+                over->len = 0;
+                dw->over_lo[th] = DELTA_NONE;
+                for(index_t i = 0; i < len; i++)
+                {
+                    index_t v = over->v[i];
+                    index_t b = ((index_t) d[v])/delta;
+                    if(b >= cur)
+                        delta_push(dw, th, v, b, cur);
+                }
+            }
 
-        index_t block_size = kCm/nt;
+            // gather the bucket, the frontier grows to the largest bucket
+            delta_queue_t *q = ring + (cur & (nb-1));
+            dw->count[th] = q->len;
 #ifdef BUILD_PARALLEL
-#pragma omp parallel for
+#pragma omp barrier
 #endif
-        for(index_t th = 0; th < nt; th++) // one thread per core
-        {
-            index_t start = th*block_size;
-            index_t stop = (th == nt-1) ? kCm-1 : (start+block_size-1);
-            index_t *d_th = d + (n+nt)*th;
-            index_t *visit_th = visit + (n+nt)*th;
-#ifdef TRACK_BANDWIDTH
-            index_t *heap_ops_th = heap_ops + th;
+            index_t offset = 0;
+            index_t total  = 0;
+            for(index_t j = 0; j < nt; j++)
+            {
+                offset += (j < th) ? dw->count[j] : 0;
+                total  += dw->count[j];
+            }
+#ifdef BUILD_PARALLEL
+#pragma omp single
 #endif
-            for(index_t i = start; i <= stop; i++)
+            if(total > dw->front_cap)
             {
-                index_t X = X_a[i]; // mem: 2^k
-                index_t *f_X    = f_v + FV_INDEX(0, n, k, X);
-#ifdef TRACK_OPTIMAL
-                index_t *b_X  = b_v + BV_INDEX(0, n, k, X);
+                FREE(dw->front);
+                dw->front_cap = MAX(total, 2*dw->front_cap);
+                dw->front = (index_t *) MALLOC(dw->front_cap*sizeof(index_t));
+            }
+            for(index_t i = 0; i < q->len; i++)
+                dw->front[offset+i] = q->v[i];
+            dw->ring_len[th] -= q->len;
+            q->len = 0;
+#ifdef BUILD_PARALLEL
+#pragma omp barrier
+#endif
+
+            // scan the bucket, lowered heads go to the queues of this thread
+#ifdef BUILD_PARALLEL
+#pragma omp for schedule(dynamic, 64)
 #endif
-                // bit twiddling hacks: generating proper subsets of X 
-                index_t Xd = 0;
-                for(Xd = X & (Xd - X); Xd != X; Xd = X & (Xd - X)) // 2^m - 2
+            for(index_t i = 0; i < total; i++)
+            {
+                index_t u = dw->front[i];
+                index_t d_u = __atomic_load_n(d + u, __ATOMIC_RELAXED);
+                if(d_u/delta < cur)
+                    continue; // scanned at its lower label
+                if(lb != NULL)
                 {
-                    index_t X_Xd = (X & ~Xd); // X - X' 
-                    index_t *f_Xd   = f_v + FV_INDEX(0, n, k, Xd);
-                    index_t *f_X_Xd = f_v + FV_INDEX(0, n, k, X_Xd);
-                    for(index_t v = 0; v < n; v++)
+                    dist_t *lb_u = lb + u*pr->kb;
+                    dist_t lb_max = 0;
+                    for(index_t M = mask; M != 0; M &= M-1)
+                        lb_max = MAX(lb_max, lb_u[__builtin_ctzl(M)]);
+                    if(lb_max > ub - d_u)
                     {
-                        index_t min_Xd = f_Xd[v] + f_X_Xd[v];
-                        if(min_Xd < f_X[v])
-                        {
-                            f_X[v] = min_Xd;
-#ifdef TRACK_OPTIMAL    
-                            b_X[2*v] = v;
-                            b_X[2*v + 1] = Xd;
-#endif
-                        }
-                        // mem: 3^k*3n
+                        pruned[1]++;
+                        continue;
                     }
                 }
-
-                index_t s = n + th;
-                index_t ps = pos[s];
-                index_t *adj_s = adj + (ps+1);
-#ifdef TRACK_OPTIMAL
-                index_t *p_th = p + (n+nt)*th;
-#endif
-                for(index_t u = 0; u < n; u++)
-                    adj_s[2*u+1] = f_X[u]; // mem: 2^k * n
-
-                for(index_t t = 0; t < k; t++)
+                index_t end_u = ARC_END(pos, adj, u);
+                for(index_t j = ARC_FIRST(pos, adj, u); j < end_u; 
+                    j += ARC_STEP)
                 {
-                    if(!(X & (1<<t)))
+                    index_t v   = ARC_HEAD(adj, m, j);
+                    index_t d_v = d_u + ARC_WEIGHT(adj, m, j);
+                    dist_t was  = __atomic_load_n(d + v, __ATOMIC_RELAXED);
+                    if(was <= d_v)
+                        continue;
+                    if(d_v > ub)
+                    {
+                        pruned[0]++;
                         continue;
-                    index_t u     = kk[t];
-                    index_t X_u   = (X & ~(1<<t));
-                    index_t i_X_u = FV_INDEX(u, n, k, X_u);
-                    adj_s[2*u+1]  = f_v[i_X_u];
+                    }
+                    while(was > d_v &&
+                          !__atomic_compare_exchange_n(d + v, &was, 
+                                                       (dist_t) d_v, 0,
+                                                       __ATOMIC_RELAXED,
+                                                       __ATOMIC_RELAXED))
+                        ;
+                    if(was > d_v)
+                        delta_push(dw, th, v, d_v/delta, cur);
                 }
+            }
+        }
 
-                dijkstra(n+nt, m+n, pos, adj, s, d_th, visit_th
 #ifdef TRACK_OPTIMAL
-                         ,p_th
+        // a lowered label takes a neighbour with a smaller label on a 
+        // shortest path, ties over zero weight arcs are left for below
+        index_t *p = dw->p;
+        char *settled = dw->settled;
+#ifdef BUILD_PARALLEL
+#pragma omp for schedule(static)
 #endif
-#ifdef TRACK_BANDWIDTH
-                         ,heap_ops_th
+        for(index_t v = 0; v < n; v++)
+        {
+            p[v] = UNDEFINED;
+            settled[v] = (d[v] == dw->d0[v]);
+            if(settled[v])
+                continue;
+            index_t end_v = ARC_END(pos, adj, v);
+            for(index_t j = ARC_FIRST(pos, adj, v); j < end_v; j += ARC_STEP)
+            {
+                index_t u = ARC_HEAD(adj, m, j);
+                if(d[u] < d[v] && 
+                   (index_t) d[u] + ARC_WEIGHT(adj, m, j) == (index_t) d[v])
+                {
+                    p[v] = u;
+                    settled[v] = 1;
+                    break;
+                }
+            }
+            if(!settled[v])
+                delta_queue_push(over, v);
+        }
+#ifdef BUILD_PARALLEL
+#pragma omp single
 #endif
-                         );
-                for(index_t v = 0; v < n; v++)
+        {
+            index_t progress = 1;
+            while(progress)
+            {
+                progress = 0;
+                for(index_t j = 0; j < nt; j++)
                 {
-                    f_X[v] = d_th[v];
-                    // mem: 2^k * n 
-#ifdef TRACK_OPTIMAL
-                    index_t u = p_th[v];
-                    if(u != s)
+                    delta_queue_t *o = dw->over + j;
+                    index_t len = o->len;
+                    o->len = 0;
+                    for(index_t i = 0; i < len; i++)
                     {
-                        b_X[2*v] = u;
-                        b_X[2*v + 1] = X;
+                        index_t v = o->v[i];
+                        index_t end_v = ARC_END(pos, adj, v);
+                        for(index_t a = ARC_FIRST(pos, adj, v); 
+                            a < end_v && !settled[v]; a += ARC_STEP)
+                        {
+                            index_t u = ARC_HEAD(adj, m, a);
+                            if(settled[u] && d[u] == d[v] && 
+                               ARC_WEIGHT(adj, m, a) == 0)
+                            {
+                                p[v] = u;
+                                settled[v] = 1;
+                                progress = 1;
+                            }
+                        }
+                        if(!settled[v])
+                            o->v[o->len++] = v;
                     }
-                    // mem: 2^k * 2n 
-#endif
                 }
             }
+            for(index_t j = 0; j < nt; j++)
+                dw->over[j].len = 0;
         }
-        FREE(X_a);
+#endif
     }
+    return d_min;
+}
 
-    //print_b_v(n, k, b_v);
-    index_t i_q_C  = FV_INDEX(q, n, k, C);
-    return f_v[i_q_C];
+/*************************************************************** Reductions. */
+/*
+ * Shrinks the input graph ahead of the root build with tests that keep an
+ * optimal Steiner tree: a non-terminal leaf is deleted, a non-terminal of
+ * degree two is replaced by an edge joining its neighbours, the edge of a
+ * terminal of degree one is forced into the solution and an edge longer 
+ * than the special distance of its ends is deleted. The special distance
+ * of (u, v) is bounded by the least max{d(u, z), B(z, y), d(y, v)} over
+ * terminals z and y, with B the bottleneck distance in the distance network
+ * of the terminals. Replaced and forced edges are kept so that a solution
+ * of the reduced graph is listed in input edges.
+ */
+
+typedef struct reduce_ws
+{
+    reduce_t *r;
+    index_t *alive;
+    index_t *slot;      // incidence slots of the u and the v end
+    index_t *ipos;
+    index_t *inc;       // live edges of each vertex, UNDEFINED if deleted
+    index_t *deg;
+    index_t *term;
+    index_t *stack;     // vertices to test
+    index_t *queued;
+    index_t top;
+    index_t k;          // terminals left
+} reduce_ws_t;
+
+#define RD_OTHER(r, f, v) (((r)->e[3*(f)] == (v)) ? (r)->e[3*(f)+1] : \
+                                                    (r)->e[3*(f)])
+#define RD_END(r, f, v)   (((r)->e[3*(f)] == (v)) ? 0 : 1)
+
+static void rd_push(reduce_ws_t *w, index_t v)
+{
+    if(!w->queued[v])
+    {
+        w->queued[v] = 1;
+        w->stack[w->top++] = v;
+    }
 }
 
-index_t erickson_monma_veinott(steinerq_t *root, index_t list_soln)
+static void rd_delete(reduce_ws_t *w, index_t f)
 {
-#ifdef TRACK_MEMORY
-    push_memtrack();
-#endif
-    push_time();
+    index_t *x = w->r->e + 3*f;
+    w->alive[f] = 0;
+    w->inc[w->slot[2*f]]   = UNDEFINED;
+    w->inc[w->slot[2*f+1]] = UNDEFINED;
+    w->deg[x[0]]--;
+    w->deg[x[1]]--;
+    rd_push(w, x[0]);
+    rd_push(w, x[1]);
+}
 
-    double time;
-    index_t n   = root->n;
-    index_t m   = root->m;
-    index_t k   = root->k;
-    index_t *kk = root->kk;
-    index_t min_cost = 0;
+static index_t rd_edges(reduce_ws_t *w, index_t v, index_t *f, index_t max)
+{
+    // up to max live edges of v
+    index_t c = 0;
+    for(index_t i = w->ipos[v]; i < w->ipos[v+1] && c < max; i++)
+        if(w->inc[i] != UNDEFINED)
+            f[c++] = w->inc[i];
+    return c;
+}
 
-#ifdef TRACK_OPTIMAL
-    graph_t *g = NULL;
-#endif
+static void rd_contract(reduce_ws_t *w, index_t v, index_t f1, index_t f2)
+{
+    // the edge of the path u - v - x takes over the slots of f1 at u and
+    // of f2 at x, the degrees of u and x stay
+    reduce_t *r = w->r;
+    index_t u = RD_OTHER(r, f1, v);
+    index_t x = RD_OTHER(r, f2, v);
+    index_t f = r->m++;
+    r->e[3*f]   = u;
+    r->e[3*f+1] = x;
+    r->e[3*f+2] = r->e[3*f1+2] + r->e[3*f2+2];
+    r->sub[2*f]   = f1;
+    r->sub[2*f+1] = f2;
+    w->slot[2*f]   = w->slot[2*f1 + RD_END(r, f1, u)];
+    w->slot[2*f+1] = w->slot[2*f2 + RD_END(r, f2, x)];
+    w->inc[w->slot[2*f]]   = f;
+    w->inc[w->slot[2*f+1]] = f;
+    w->inc[w->slot[2*f1 + RD_END(r, f1, v)]] = UNDEFINED;
+    w->inc[w->slot[2*f2 + RD_END(r, f2, v)]] = UNDEFINED;
+    w->alive[f]  = 1;
+    w->alive[f1] = 0;
+    w->alive[f2] = 0;
+    w->deg[v]    = 0;
+}
 
-    if(k == 2)
+static void rd_degree_tests(reduce_ws_t *w, index_t *leaves, index_t *paths,
+                            index_t *forced)
+{
+    reduce_t *r = w->r;
+    index_t f[2];
+    while(w->top > 0)
     {
-        index_t u   = kk[0];
-        index_t v   = kk[1];
-        index_t *d  = (index_t *) MALLOC(n*sizeof(index_t));
-        index_t *visit = (index_t *) MALLOC(n*sizeof(index_t));
-#ifdef TRACK_OPTIMAL
-        index_t *p  = (index_t *) MALLOC(n*sizeof(index_t));
-#endif
-#ifdef TRACK_BANDWIDTH
-        index_t heap_ops = 0;
-#endif
-        fprintf(stdout, "erickson: ");
-        push_time();
-        dijkstra(n, m, root->pos, root->adj, u, d, visit
-#ifdef TRACK_OPTIMAL
-                ,p
-#endif
-#ifdef TRACK_BANDWIDTH
-                ,&heap_ops
+        index_t v = w->stack[--w->top];
+        w->queued[v] = 0;
+        if(w->deg[v] == 1 && !w->term[v])
+        {
+            rd_edges(w, v, f, 1);
+            rd_delete(w, f[0]);
+            (*leaves)++;
+        }
+        else if(w->deg[v] == 2 && !w->term[v])
+        {
+            rd_edges(w, v, f, 2);
+            if(RD_OTHER(r, f[0], v) == RD_OTHER(r, f[1], v))
+            {
+                // a dead end of two parallel edges
+                rd_delete(w, f[0]);
+                rd_delete(w, f[1]);
+                (*leaves)++;
+                continue;
+            }
+#ifdef COMPACT_GRAPH
+            if(r->e[3*f[0]+2] + r->e[3*f[1]+2] > (index_t) UINT32_MAX)
+                continue;
 #endif
-                );
-        time = pop_time();
+            rd_contract(w, v, f[0], f[1]);
+            (*paths)++;
+        }
+        else if(w->deg[v] == 1 && w->term[v])
+        {
+            rd_edges(w, v, f, 1);
+            index_t u = RD_OTHER(r, f[0], v);
+            if(w->term[u] && w->k == 2)
+                continue; // the edge is the whole solution
+            r->forced[r->num_forced++] = f[0];
+            r->fixed += r->e[3*f[0]+2];
+            rd_delete(w, f[0]);
+            w->term[v] = 0;
+            if(w->term[u])
+                w->k--;
+            w->term[u] = 1;
+            (*forced)++;
+        }
+    }
+}
 
-        // compute bandwidth
-        double trans_rate = 0;
-#ifdef TRACK_OPTIMAL
-        index_t mem_graph = 5*n+6*m;
-#else
-        index_t mem_graph = 4*n+6*m;
-#endif
+static index_t rd_special_distance(reduce_ws_t *w)
+{
+    reduce_t *r = w->r;
+    index_t n = r->n;
 
-#ifdef TRACK_BANDWIDTH
-        index_t trans_bytes = mem_graph*sizeof(index_t) +
-                              heap_ops*sizeof(heap_node_t);
-        trans_rate = trans_bytes / (time / 1000.0);
-#endif
-        fprintf(stdout, "[kernel: %.2lf ms %.2lfGiB/s] ", 
-                        time, trans_rate / (1<<30));
+    // shortest paths from the terminals over the live edges
+    index_t ml = 0;
+    index_t *pos = (index_t *) MALLOC(POS_LEN(n)*sizeof(index_t));
+    for(index_t u = 0; u < n; u++)
+        pos[u] = 0;
+    for(index_t f = 0; f < r->m; f++)
+    {
+        if(!w->alive[f])
+            continue;
+        pos[r->e[3*f]]   += ARC_STEP;
+        pos[r->e[3*f+1]] += ARC_STEP;
+        ml++;
+    }
+    adj_t *adj = (adj_t *) MALLOC(ADJ_LEN(n, ml)*sizeof(adj_t));
+    index_t run = prefixsum(n, pos, ARC_HEADER);
+    assert(run == ARC_SLOTS(n, ml));
+    arcs_clear(n, ml, pos, adj, run);
+    for(index_t f = 0; f < r->m; f++)
+    {
+        if(!w->alive[f])
+            continue;
+        index_t *x = r->e + 3*f;
+        ARC_APPEND(pos, adj, ml, x[0], x[1], x[2]);
+        ARC_APPEND(pos, adj, ml, x[1], x[0], x[2]);
+    }
+    arcs_close(n, pos);
 
-        min_cost = d[v];
-#ifdef TRACK_OPTIMAL
-        g = tracepath(n, u, v, p);
+    index_t kc = 0;
+    index_t zz[MAX_K];
+    for(index_t u = 0; u < n; u++)
+        if(w->term[u])
+            zz[kc++] = u;
+    dist_t *dz = (dist_t *) MALLOC(kc*n*sizeof(dist_t));
+    dijkstra_ws_t *ws = dijkstra_ws_alloc(n);
+    for(index_t i = 0; i < kc; i++)
+    {
+#ifdef TRACK_BANDWIDTH
+        index_t heap_ops = 0;
 #endif
-
-        FREE(d);
-        FREE(visit);
-#ifdef TRACK_OPTIMAL
-        FREE(p);
+        dijkstra(n, ml, pos, adj, zz[i], dz + i*n, ws
+#ifdef TRACK_BANDWIDTH
+                 ,&heap_ops
 #endif
+                 );
     }
-    else
+    dijkstra_ws_free(ws);
+    FREE(adj);
+    FREE(pos);
+
+    // bottleneck distances of the terminal distance network
+    dist_t B[MAX_K][MAX_K];
+    for(index_t i = 0; i < kc; i++)
+        for(index_t j = 0; j < kc; j++)
+            B[i][j] = dz[i*n + zz[j]];
+    for(index_t t = 0; t < kc; t++)
+        for(index_t i = 0; i < kc; i++)
+            for(index_t j = 0; j < kc; j++)
+                B[i][j] = MIN(B[i][j], MAX(B[i][t], B[t][j]));
+
+    index_t deleted = 0;
+    dist_t g_u[MAX_K];
+    for(index_t u = 0; u < n; u++)
     {
-        index_t nt = num_threads();
-        assert(nt < MAX_THREADS);
+        if(w->deg[u] == 0)
+            continue;
+        // g_u[y] = min_z max{d(u, z), B(z, y)}
+        for(index_t j = 0; j < kc; j++)
+        {
+            g_u[j] = DIST_INF;
+            for(index_t i = 0; i < kc; i++)
+                g_u[j] = MIN(g_u[j], MAX(dz[i*n + u], B[i][j]));
+        }
+        for(index_t i = w->ipos[u]; i < w->ipos[u+1]; i++)
+        {
+            index_t f = w->inc[i];
+            if(f == UNDEFINED || r->e[3*f] != u)
+                continue;
+            index_t v = r->e[3*f+1];
+            dist_t sd = DIST_INF;
+            for(index_t j = 0; j < kc; j++)
+                sd = MIN(sd, MAX(g_u[j], dz[j*n + v]));
+            if(sd < r->e[3*f+2])
+            {
+                rd_delete(w, f);
+                deleted++;
+            }
+        }
+    }
+    FREE(dz);
+    return deleted;
+}
 
-        index_t *f_v = (index_t *) MALLOC(n*(1<<k)*sizeof(index_t));
+static int rd_cmp_key(const void *a, const void *b, void *arg)
+{
+    // by ends, then by weight
+    index_t *e = (index_t *) arg;
+    const index_t *x = (const index_t *) a;
+    const index_t *y = (const index_t *) b;
+    if(x[0] != y[0])
+        return (x[0] < y[0]) ? -1 : 1;
+    if(x[1] != y[1])
+        return (x[1] < y[1]) ? -1 : 1;
+    index_t wx = e[3*x[2]+2];
+    index_t wy = e[3*y[2]+2];
+    return (wx > wy) - (wx < wy);
+}
 
-#ifdef BUILD_PARALLEL
-        index_t *d     = (index_t *) MALLOC(nt*(n+nt)*sizeof(index_t));
-        index_t *visit = (index_t *) MALLOC(nt*(n+nt)*sizeof(index_t));
-#else
-        index_t *d      = (index_t *) MALLOC((n+1)*sizeof(index_t));
-        index_t *visit  = (index_t *) MALLOC((n+1)*sizeof(index_t));
+graph_t *graph_reduce(graph_t *g, reduce_t **out)
+{
+#ifdef TRACK_MEMORY
+    push_memtrack();
 #endif
+    push_time();
 
-#ifdef TRACK_OPTIMAL
-        index_t *b_v = (index_t *) MALLOC(2*n*(1<<k)*sizeof(index_t));
-#ifdef BUILD_PARALLEL
-        index_t *p = (index_t *) MALLOC(nt*(n+nt)*sizeof(index_t));
-#else
-        index_t *p = (index_t *) MALLOC((n+1)*sizeof(index_t));
-#endif
+    index_t n   = g->n;
+    index_t m   = g->m;
+    index_t cap = m + n; // a contraction adds an edge and removes a vertex
+
+    reduce_t *r = (reduce_t *) MALLOC(sizeof(reduce_t));
+    r->n          = n;
+    r->m          = m;
+    r->e          = (index_t *) MALLOC(3*cap*sizeof(index_t));
+    r->sub        = (index_t *) MALLOC(2*cap*sizeof(index_t));
+    r->forced     = (index_t *) MALLOC(n*sizeof(index_t));
+    r->num_forced = 0;
+    r->fixed      = 0;
+    for(index_t i = 0; i < 3*m; i++)
+        r->e[i] = g->edges[i];
+    for(index_t i = 0; i < 2*m; i++)
+        r->sub[i] = UNDEFINED;
+
+    reduce_ws_t w;
+    w.r      = r;
+    w.alive  = (index_t *) MALLOC(cap*sizeof(index_t));
+    w.slot   = (index_t *) MALLOC(2*cap*sizeof(index_t));
+    w.ipos   = (index_t *) MALLOC((n+1)*sizeof(index_t));
+    w.inc    = (index_t *) MALLOC(2*m*sizeof(index_t));
+    w.deg    = (index_t *) MALLOC(n*sizeof(index_t));
+    w.term   = (index_t *) MALLOC(n*sizeof(index_t));
+    w.stack  = (index_t *) MALLOC(n*sizeof(index_t));
+    w.queued = (index_t *) MALLOC(n*sizeof(index_t));
+    w.top    = 0;
+    w.k      = 0;
+
+    // incidence lists, self-loops are never in a tree
+    for(index_t u = 0; u < n; u++)
+    {
+        w.deg[u]    = 0;
+        w.term[u]   = 0;
+        w.queued[u] = 0;
+    }
+    for(index_t f = 0; f < m; f++)
+    {
+        w.alive[f] = (r->e[3*f] != r->e[3*f+1]);
+        if(w.alive[f])
+        {
+            w.deg[r->e[3*f]]++;
+            w.deg[r->e[3*f+1]]++;
+        }
+    }
+    w.ipos[0] = 0;
+    for(index_t u = 0; u < n; u++)
+        w.ipos[u+1] = w.ipos[u] + w.deg[u];
+    for(index_t i = 0; i < 2*m; i++)
+        w.inc[i] = UNDEFINED;
+    for(index_t f = 0; f < m; f++)
+    {
+        if(!w.alive[f])
+            continue;
+        for(index_t s = 0; s < 2; s++)
+        {
+            index_t u = r->e[3*f+s];
+            w.slot[2*f+s] = w.ipos[u+1] - w.deg[u];
+            w.inc[w.slot[2*f+s]] = f;
+            w.deg[u]--;
+        }
+    }
+    for(index_t f = 0; f < m; f++)
+    {
+        if(!w.alive[f])
+            continue;
+        w.deg[r->e[3*f]]++;
+        w.deg[r->e[3*f+1]]++;
+    }
+    for(index_t i = 0; i < g->k; i++)
+    {
+        if(!w.term[g->terminals[i]])
+            w.k++;
+        w.term[g->terminals[i]] = 1;
+    }
+    for(index_t u = n-1; u >= 0; u--)
+        rd_push(&w, u);
+
+    index_t leaves = 0;
+    index_t paths  = 0;
+    index_t forced = 0;
+    index_t sd     = 0;
+    index_t rounds = 0;
+    index_t deleted;
+    do
+    {
+        rd_degree_tests(&w, &leaves, &paths, &forced);
+        deleted = (w.k > 1) ? rd_special_distance(&w) : 0;
+        sd += deleted;
+        rounds++;
+    }
+    while(deleted > 0);
+
+    // the reduced graph over the vertices left
+    index_t *vnew = w.stack;
+    index_t n_r = 0;
+    for(index_t u = 0; u < n; u++)
+        vnew[u] = (w.deg[u] > 0 || w.term[u]) ? n_r++ : UNDEFINED;
+
+    graph_t *gr = graph_alloc();
+    gr->root  = g->root;
+    gr->flags = g->flags;
+    gr->n     = n_r;
+    gr->k     = w.k;
+    gr->cost  = (g->cost == -1) ? -1 : g->cost - r->fixed;
+    gr->terminals = (index_t *) MALLOC(w.k*sizeof(index_t));
+    for(index_t u = 0; u < n; u++)
+        if(w.term[u])
+            graph_add_terminal(gr, vnew[u]);
+    for(index_t f = 0; f < r->m; f++)
+        if(w.alive[f])
+            graph_add_edge(gr, vnew[r->e[3*f]], vnew[r->e[3*f+1]], 
+                           r->e[3*f+2]);
+    gr->m = gr->num_edges;
+    r->n_r  = n_r;
+    r->vmap = (index_t *) MALLOC(MAX(n_r, 1)*sizeof(index_t));
+    for(index_t u = 0; u < n; u++)
+        if(vnew[u] != UNDEFINED)
+            r->vmap[vnew[u]] = u;
+
+    index_t m_r = 0;
+    r->key = (index_t *) MALLOC(3*MAX(gr->m, 1)*sizeof(index_t));
+    for(index_t f = 0; f < r->m; f++)
+    {
+        if(!w.alive[f])
+            continue;
+        index_t a = vnew[r->e[3*f]];
+        index_t b = vnew[r->e[3*f+1]];
+        r->key[3*m_r]   = MIN(a, b);
+        r->key[3*m_r+1] = MAX(a, b);
+        r->key[3*m_r+2] = f;
+        m_r++;
+    }
+    r->m_r = m_r;
+    qsort_r(r->key, m_r, 3*sizeof(index_t), rd_cmp_key, r->e);
+
+    FREE(w.alive);
+    FREE(w.slot);
+    FREE(w.ipos);
+    FREE(w.inc);
+    FREE(w.deg);
+    FREE(w.term);
+    FREE(w.stack);
+    FREE(w.queued);
+
+    double time = pop_time();
+    fprintf(stdout, "reduce: [leaves: %ld] [paths: %ld] [forced: %ld] "
+                    "[sd: %ld] [rounds: %ld] n = %ld, m = %ld, k = %ld, "
+                    "fixed = %ld done. [%.2lf ms] ", 
+                    leaves, paths, forced, sd, rounds, 
+                    gr->n, gr->m, gr->k, r->fixed, time);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    fflush(stdout);
+
+    *out = r;
+    return gr;
+}
+
+static void rd_expand(reduce_t *r, index_t f, index_t *stack, graph_t *s)
+{
+    index_t top = 0;
+    stack[top++] = f;
+    while(top > 0)
+    {
+        f = stack[--top];
+        if(r->sub[2*f] == UNDEFINED)
+        {
+            graph_add_edge(s, r->e[3*f], r->e[3*f+1], r->e[3*f+2]);
+        }
+        else
+        {
+            stack[top++] = r->sub[2*f+1];
+            stack[top++] = r->sub[2*f];
+        }
+    }
+}
+
+graph_t *reduce_expand(reduce_t *r, graph_t *t)
+{
+    // input edges of a solution of the reduced graph and the forced edges
+    graph_t *s = graph_alloc();
+    s->n = r->n;
+    index_t *stack = (index_t *) MALLOC(r->m*sizeof(index_t));
+    for(index_t i = 0; i < t->num_edges; i++)
+    {
+        index_t a  = MIN(t->edges[3*i], t->edges[3*i+1]);
+        index_t b  = MAX(t->edges[3*i], t->edges[3*i+1]);
+        index_t lo = 0;
+        index_t hi = r->m_r;
+        while(lo < hi)
+        {
+            index_t mid = (lo+hi)/2;
+            index_t *x  = r->key + 3*mid;
+            if(x[0] < a || (x[0] == a && x[1] < b))
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        if(lo < r->m_r && r->key[3*lo] == a && r->key[3*lo+1] == b)
+            rd_expand(r, r->key[3*lo+2], stack, s);
+        else // the back-pointer traceback may join the ends of a path
+            graph_add_edge(s, r->vmap[a], r->vmap[b], 1);
+    }
+    for(index_t i = 0; i < r->num_forced; i++)
+        rd_expand(r, r->forced[i], stack, s);
+    s->m = s->num_edges;
+    FREE(stack);
+    return s;
+}
+
+void reduce_free(reduce_t *r)
+{
+    FREE(r->e);
+    FREE(r->sub);
+    FREE(r->key);
+    FREE(r->vmap);
+    FREE(r->forced);
+    FREE(r);
+}
+
+/*************************************************** Traceback Steiner tree. */
+
+#ifdef LIST_OPTIMAL
+void list_solution(graph_t *g)
+{
+    index_t m = g->num_edges;
+    index_t *e = g->edges;
+    index_t i = 0;
+
+    if(m == 0)
+    {
+        // the groups share a vertex
+        fprintf(stdout, "solution: []\n");
+        fflush(stdout);
+        return;
+    }
+    fprintf(stdout, "solution: [");
+    for(i = 0; i < (3*m-3); i+=3)
+    {
+        index_t u = e[i];
+        index_t v = e[i+1];
+        //index_t w = e[i+2];
+        fprintf(stdout, "\"%ld %ld\", ", u+1, v+1);
+    }
+    index_t u = e[i];
+    index_t v = e[i+1];
+    //index_t w = e[i+2];
+    fprintf(stdout, "\"%ld %ld\"", u+1, v+1);
+    fprintf(stdout, "]\n");
+    fflush(stdout);
+}
+#endif
+
+#ifdef TRACK_OPTIMAL
+void backtrack(index_t n, index_t k, index_t v, 
+               index_t X, index_t *kk, bptr_t *b_v,
+               graph_t *g)
+{
+    if(X == 0 || v == -1)
+        return;
+
+    index_t i_X = BV_INDEX(v, n, k, X);
+    index_t u = BV_VERTEX(b_v[i_X]);
+
+    if(v != u)
+    {
+        graph_add_edge(g, v, u, 1);
+        index_t Xd = b_v[i_X].X;
+        backtrack(n, k, u, Xd, kk, b_v, g);
+    }
+    else
+    {
+        index_t Xd = b_v[i_X].X;
+        index_t X_Xd = (X & ~Xd);
+        if(X == Xd)
+            return;
+        backtrack(n, k, u, Xd, kk, b_v, g);
+        backtrack(n, k, u, X_Xd, kk, b_v, g);
+    }
+}
+
+// the tree of (q, C), q is kk[k-1] or the best vertex of the root group
+graph_t * build_tree(index_t n, index_t k, index_t *kk, index_t q, 
+                     bptr_t *b_v)
+{
+    index_t c = k-1;
+    index_t C = (1<<c)-1;
+
+    graph_t *g = graph_alloc();
+    g->n = n;
+    backtrack(n, k, q, C, kk, b_v, g);
+    return g;
+}
+
+// s = UNDEFINED follows a multi-source run back to the source it started at
+graph_t * tracepath(index_t n, index_t s, index_t v, index_t *p)
+{
+    graph_t *g = graph_alloc();
+    g->n = n;
+    if(s == UNDEFINED)
+    {
+        for(index_t u = p[v]; u != UNDEFINED; v = u, u = p[v])
+            graph_add_edge(g, v, u, 1);
+        return g;
+    }
+
+    index_t u = p[v];
+    while(u != s)
+    {
+        graph_add_edge(g, v, u, 1);
+        v = u;
+        u = p[v];
+    }
+    graph_add_edge(g, v, u, 1);
+    return g;
+}
+#endif
+
+#ifdef RECOMPUTE_OPTIMAL
+/*
+ * Traceback without back-pointers, top-down from (q, C) over the stored
+ * rows only. The value f_X[v] either
+ *    comes from a split, f_X[v] = f_Xd[v] + f_X-Xd[v],
+ *    picks up a terminal v = kk[t] in X, f_X[v] = f_X-t[v], or a vertex v
+ *    of group t in a group instance,
+ *    or arrives over an edge (w, v) with f_X[v] = f_X[w] + c(w, v),
+ * and the first two end the shortest path walk of X at v. Zero weight 
+ * edges are resolved by a search over the plateau f_X[w] = f_X[v].
+ */
+
+#define RT_NONE  0
+#define RT_TERM  1
+#define RT_SPLIT 2
+
+// v is terminal t, or in group t
+#define RT_IN(r, t, v) ((r)->gmask != NULL ? ((r)->gmask[v] >> (t)) & 1 : \
+                                            (r)->kk[t] == (v))
+
+typedef struct retrace
+{
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t *kk;
+    index_t *gmask;  // groups of each vertex in a group instance, or NULL
+    index_t *pos;
+    adj_t *adj;
+    dist_t *f_v;
+    index_t *parent; // plateau search
+    index_t *queue;
+    unsigned *mark;
+    unsigned gen;
+    graph_t *g;
+} retrace_t;
+
+static index_t rt_decompose(retrace_t *r, index_t v, index_t X, index_t *Xd)
+{
+    index_t n = r->n;
+    dist_t f = r->f_v[FV_INDEX(v, n, r->k, X)];
+
+    // singletons end at their terminal
+    if((X & (X-1)) == 0)
+        return RT_IN(r, __builtin_ctzl(X), v) ? RT_TERM : RT_NONE;
+
+    for(index_t t = 0; X >> t; t++)
+    {
+        if(!(X & (1<<t)) || !RT_IN(r, t, v))
+            continue;
+        if(r->f_v[FV_INDEX(v, n, r->k, X & ~(1<<t))] == f)
+        {
+            *Xd = X & ~(1<<t);
+            return RT_TERM;
+        }
+    }
+
+    index_t lo = X & (-X);
+    index_t R  = X & ~lo;
+    for(index_t Y = 0; Y != R; Y = (Y - R) & R)
+    {
+        dist_t a = r->f_v[FV_INDEX(v, n, r->k, lo | Y)];
+        dist_t b = r->f_v[FV_INDEX(v, n, r->k, R & ~Y)];
+        if(a != DIST_INF && b != DIST_INF && a + b == f)
+        {
+            *Xd = lo | Y;
+            return RT_SPLIT;
+        }
+    }
+    return RT_NONE;
+}
+
+static index_t rt_pred(retrace_t *r, index_t v, dist_t *f_X)
+{
+    // a neighbour over a positive edge on a shortest path to v
+    for(index_t i = ARC_FIRST(r->pos, r->adj, v); 
+        i < ARC_END(r->pos, r->adj, v); i += ARC_STEP)
+    {
+        index_t w = ARC_HEAD(r->adj, r->m, i);
+        index_t c = ARC_WEIGHT(r->adj, r->m, i);
+        if(c > 0 && f_X[w] != DIST_INF && f_X[w] + c == f_X[v])
+            return w;
+    }
+    return UNDEFINED;
+}
+
+static index_t rt_plateau(retrace_t *r, index_t v, index_t X, dist_t *f_X)
+{
+    // breadth-first over zero weight edges to the nearest vertex where the
+    // walk can go on, the edges leading there join the tree
+    index_t Xd;
+    unsigned g = ++r->gen;
+    if(g == 0)
+    {
+        memset(r->mark, 0, r->n*sizeof(unsigned));
+        g = r->gen = 1;
+    }
+    index_t head = 0;
+    index_t tail = 0;
+    r->queue[tail++] = v;
+    r->mark[v] = g;
+    while(head < tail)
+    {
+        index_t y = r->queue[head++];
+        for(index_t i = ARC_FIRST(r->pos, r->adj, y); 
+            i < ARC_END(r->pos, r->adj, y); i += ARC_STEP)
+        {
+            index_t z = ARC_HEAD(r->adj, r->m, i);
+            if(ARC_WEIGHT(r->adj, r->m, i) != 0 || f_X[z] != f_X[v] || 
+               r->mark[z] == g)
+                continue;
+            r->mark[z] = g;
+            r->parent[z] = y;
+            if(rt_decompose(r, z, X, &Xd) != RT_NONE ||
+               rt_pred(r, z, f_X) != UNDEFINED)
+            {
+                for(index_t u = z; u != v; u = r->parent[u])
+                    graph_add_edge(r->g, u, r->parent[u], 1);
+                return z;
+            }
+            r->queue[tail++] = z;
+        }
+    }
+    ERROR("traceback: no shortest path into vertex %ld", v);
+    return UNDEFINED;
+}
+
+static void rt_trace(retrace_t *r, index_t v, index_t X)
+{
+    if(X == 0)
+        return;
+
+    dist_t *f_X = r->f_v + FV_INDEX(0, r->n, r->k, X);
+    index_t Xd = 0;
+    index_t type;
+    while((type = rt_decompose(r, v, X, &Xd)) == RT_NONE)
+    {
+        index_t w = rt_pred(r, v, f_X);
+        if(w == UNDEFINED)
+        {
+            v = rt_plateau(r, v, X, f_X);
+            continue;
+        }
+        graph_add_edge(r->g, v, w, 1);
+        v = w;
+    }
+
+    if(type == RT_TERM)
+    {
+        if((X & (X-1)) != 0)
+            rt_trace(r, v, Xd);
+    }
+    else
+    {
+        rt_trace(r, v, Xd);
+        rt_trace(r, v, X & ~Xd);
+    }
+}
+
+graph_t * retrace_tree(index_t n, index_t m, index_t k, index_t *kk, 
+                       index_t *gpos, index_t *gv, index_t *pos, adj_t *adj,
+                       dist_t *f_v)
+{
+    index_t c = k-1;
+    index_t C = (1<<c)-1;
+    index_t q = group_root(kk, gpos, gv, k-1, f_v + FV_INDEX(0, n, k, C));
+
+    retrace_t r;
+    r.n = n; r.m = m; r.k = k; r.kk = kk; r.pos = pos; r.adj = adj; r.f_v = f_v;
+    r.gmask = NULL;
+    if(gpos != NULL)
+    {
+        r.gmask = (index_t *) MALLOC(n*sizeof(index_t));
+        memset(r.gmask, 0, n*sizeof(index_t));
+        for(index_t t = 0; t < k; t++)
+            for(index_t i = gpos[t]; i < gpos[t+1]; i++)
+                r.gmask[gv[i]] |= 1L<<t;
+    }
+    r.parent = (index_t *) MALLOC(n*sizeof(index_t));
+    r.queue  = (index_t *) MALLOC(n*sizeof(index_t));
+    r.mark   = (unsigned *) MALLOC(n*sizeof(unsigned));
+    memset(r.mark, 0, n*sizeof(unsigned));
+    r.gen = 0;
+    r.g = graph_alloc();
+    r.g->n = n;
+
+    rt_trace(&r, q, C);
+
+    if(r.gmask != NULL)
+        FREE(r.gmask);
+    FREE(r.parent);
+    FREE(r.queue);
+    FREE(r.mark);
+    return r.g;
+}
+#endif
+
+/******************************************************* Subset merge kernel. */
+/*
+ * Min-plus merge of the rows of a split {Xd, X-Xd} into the row of X,
+ *    f_X[v] = min(f_X[v], f_Xd[v] + f_X_Xd[v])  for v0 <= v < v1,
+ * recording (v, Xd) in b_X for the improved entries with TRACK_OPTIMAL. 
+ * The AVX-512 and AVX2 variants are branchless and are picked by the target
+ * instruction set, the scalar loop handles the remainder.
+ *
+ * The kernel runs all splits of X over one tile of MERGE_TILE vertices 
+ * before moving to the next, so that the tile of f_X (and b_X) stays in 
+ * cache and only the rows of the splits are streamed from memory.
+ *
+ */
+
+
+void merge_rows(index_t v0,
+                index_t v1,
+                dist_t *f_X,
+                dist_t *f_Xd,
+                dist_t *f_X_Xd
+#ifdef TRACK_OPTIMAL
+                ,bptr_t *b_X
+                ,index_t Xd
+#endif
+                )
+{
+    index_t v = v0;
+#if defined(NARROW_TABLE) && defined(__AVX2__)
+    // 32-bit lanes, saturating a + b as a + min(b, INF - a)
+    __m256i inf = _mm256_set1_epi32(-1);
+#ifdef TRACK_OPTIMAL
+    __m256i idx_lo = _mm256_set_epi32(3, 3, 2, 2, 1, 1, 0, 0);
+    __m256i idx_hi = _mm256_set_epi32(7, 7, 6, 6, 5, 5, 4, 4);
+#endif
+    for(; v + 8 <= v1; v += 8)
+    {
+        __m256i a = _mm256_loadu_si256((__m256i *) (f_Xd + v));
+        __m256i b = _mm256_loadu_si256((__m256i *) (f_X_Xd + v));
+        __m256i x = _mm256_loadu_si256((__m256i *) (f_X + v));
+        __m256i s = _mm256_add_epi32(a, 
+                        _mm256_min_epu32(b, _mm256_sub_epi32(inf, a)));
+        __m256i y = _mm256_min_epu32(x, s);
+        _mm256_storeu_si256((__m256i *) (f_X + v), y);
+#ifdef TRACK_OPTIMAL
+        __m256i eq = _mm256_cmpeq_epi32(x, y);
+        if(_mm256_movemask_epi8(eq) != -1)
+        {
+            // (u, X) pairs are 8 bytes, widen each lane of lt to a pair 
+            __m256i lt = _mm256_xor_si256(eq, inf);
+            __m256i lt_lo = _mm256_permutevar8x32_epi32(lt, idx_lo);
+            __m256i lt_hi = _mm256_permutevar8x32_epi32(lt, idx_hi);
+            int X_ = (int) Xd;
+            _mm256_maskstore_epi32((int *) (b_X + v), lt_lo,
+                     _mm256_set_epi32(X_, v+3, X_, v+2, X_, v+1, X_, v));
+            _mm256_maskstore_epi32((int *) (b_X + v + 4), lt_hi,
+                     _mm256_set_epi32(X_, v+7, X_, v+6, X_, v+5, X_, v+4));
+        }
+#endif
+    }
+#elif defined(__AVX512F__)
+#ifdef TRACK_OPTIMAL
+    // (v+j, Xd) pairs for j = 0..7, the vertex lanes are offset by v below
+    __m512i b_lo = _mm512_set_epi64(Xd, 3, Xd, 2, Xd, 1, Xd, 0);
+    __m512i b_hi = _mm512_set_epi64(Xd, 7, Xd, 6, Xd, 5, Xd, 4);
+    index_t *b_w = (index_t *) b_X;
+#endif
+    for(; v + 8 <= v1; v += 8)
+    {
+        __m512i a = _mm512_loadu_si512((void *) (f_Xd + v));
+        __m512i b = _mm512_loadu_si512((void *) (f_X_Xd + v));
+        __m512i x = _mm512_loadu_si512((void *) (f_X + v));
+        __m512i s = _mm512_add_epi64(a, b);
+        __mmask8 lt = _mm512_cmplt_epi64_mask(s, x);
+        _mm512_mask_storeu_epi64((void *) (f_X + v), lt, s);
+#ifdef TRACK_OPTIMAL
+        if(lt)
+        {
+            // widen each lane bit of lt to the two entries of a b_X pair
+            unsigned int w = 0;
+            for(index_t j = 0; j < 8; j++)
+                w |= (((unsigned int) lt >> j) & 1) * (3u << (2*j));
+            __m512i base = _mm512_maskz_set1_epi64(0x55, v);
+            _mm512_mask_storeu_epi64((void *) (b_w + 2*v), (__mmask8) w,
+                                     _mm512_add_epi64(b_lo, base));
+            _mm512_mask_storeu_epi64((void *) (b_w + 2*v + 8), 
+                                     (__mmask8) (w >> 8),
+                                     _mm512_add_epi64(b_hi, base));
+        }
+#endif
+    }
+#elif defined(__AVX2__)
+#ifdef TRACK_OPTIMAL
+    index_t *b_w = (index_t *) b_X;
+#endif
+    for(; v + 4 <= v1; v += 4)
+    {
+        __m256i a = _mm256_loadu_si256((__m256i *) (f_Xd + v));
+        __m256i b = _mm256_loadu_si256((__m256i *) (f_X_Xd + v));
+        __m256i x = _mm256_loadu_si256((__m256i *) (f_X + v));
+        __m256i s = _mm256_add_epi64(a, b);
+        __m256i lt = _mm256_cmpgt_epi64(x, s);
+        _mm256_storeu_si256((__m256i *) (f_X + v), 
+                            _mm256_blendv_epi8(x, s, lt));
+#ifdef TRACK_OPTIMAL
+        if(!_mm256_testz_si256(lt, lt))
+        {
+            // lanes (0,0,1,1) and (2,2,3,3) of lt mask the b_X pairs
+            __m256i lt_lo = _mm256_permute4x64_epi64(lt, 0x50);
+            __m256i lt_hi = _mm256_permute4x64_epi64(lt, 0xFA);
+            _mm256_maskstore_epi64((long long *) (b_w + 2*v), lt_lo,
+                                   _mm256_set_epi64x(Xd, v+1, Xd, v));
+            _mm256_maskstore_epi64((long long *) (b_w + 2*v + 4), lt_hi,
+                                   _mm256_set_epi64x(Xd, v+3, Xd, v+2));
+        }
+#endif
+    }
+#endif
+    for(; v < v1; v++)
+    {
+#ifdef NARROW_TABLE
+        dist_t min_Xd = f_Xd[v] + MIN(f_X_Xd[v], DIST_INF - f_Xd[v]);
+#else
+        dist_t min_Xd = f_Xd[v] + f_X_Xd[v];
+#endif
+        if(min_Xd < f_X[v])
+        {
+            f_X[v] = min_Xd;
+#ifdef TRACK_OPTIMAL    
+            BV_SET(b_X[v], v, Xd);
+#endif
+        }
+        // mem: 3^k*3n/2
+    }
+}
+
+/************************************************************ Checkpointing. */
+/*
+ * A checkpoint file holds a header followed by the table at its in-memory
+ * layout, f_v and then b_v. Once a level is complete a writer thread stores
+ * its rows. While it runs, the kernel computes the next level, which only
+ * reads the finished rows. The header's level field is updated only after
+ * the rows are synced, so a preempted run resumes after the last level
+ * that is fully on disk.
+ */
+
+#define CKPT_MAGIC 0x314b434556454d45L // "EMVECK1"
+
+typedef struct ckpt_header
+{
+    index_t magic;
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t kt;
+    index_t dist_bytes;
+    index_t bptr_bytes;
+    uint64_t hash;
+    index_t level;   // last level on disk
+    index_t kk[MAX_K];
+} ckpt_header_t;
+
+typedef struct ckpt
+{
+    int fd;
+    ckpt_header_t hdr;
+    dist_t *f_v;
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_v;
+#endif
+    index_t resumed;    // level restored at open
+    index_t writing;    // level of the running writer, 0 if none
+    double write_time;  // seconds spent by writers
+    pthread_t writer;
+} ckpt_t;
+
+uint64_t graph_hash(steinerq_t *root)
+{
+    // FNV-1a over the adjacency, the terminals and the groups
+    uint64_t h = 0xcbf29ce484222325UL;
+    index_t len = ADJ_LEN(root->n, root->m);
+    for(index_t i = 0; i < len; i++)
+        h = (h ^ (uint64_t) root->adj[i]) * 0x100000001b3UL;
+#ifdef COMPACT_GRAPH
+    // the compact arrays hold no degrees
+    for(index_t i = 0; i < POS_LEN(root->n); i++)
+        h = (h ^ (uint64_t) root->pos[i]) * 0x100000001b3UL;
+#endif
+    for(index_t i = 0; i < root->k; i++)
+        h = (h ^ (uint64_t) root->kk[i]) * 0x100000001b3UL;
+    for(index_t i = 0; root->gpos != NULL && i < root->gpos[root->k]; i++)
+        h = (h ^ (uint64_t) root->gv[i]) * 0x100000001b3UL;
+    return h;
+}
+
+static void ckpt_pio(int fd, void *buf, size_t bytes, off_t off, 
+                     index_t write)
+{
+    char *p = (char *) buf;
+    while(bytes > 0)
+    {
+        ssize_t r = write ? pwrite(fd, p, bytes, off) : pread(fd, p, bytes, off);
+        if(r <= 0)
+            ERROR("checkpoint %s failed at offset %ld", 
+                  write ? "write" : "read", (index_t) off);
+        p     += r;
+        off   += r;
+        bytes -= r;
+    }
+}
+
+static off_t ckpt_f_offset(ckpt_t *ck, index_t X)
+{
+    return (off_t) sizeof(ckpt_header_t) + 
+           (off_t) FV_INDEX(0, ck->hdr.n, ck->hdr.k, X)*sizeof(dist_t);
+}
+
+#ifdef TRACK_OPTIMAL
+static off_t ckpt_b_offset(ckpt_t *ck, index_t X)
+{
+    return (off_t) sizeof(ckpt_header_t) + 
+           (off_t) ck->hdr.n*(1<<ck->hdr.kt)*sizeof(dist_t) +
+           (off_t) BV_INDEX(0, ck->hdr.n, ck->hdr.k, X)*sizeof(bptr_t);
+}
+#endif
+
+static void ckpt_rows(ckpt_t *ck, index_t level, index_t write)
+{
+    index_t n  = ck->hdr.n;
+    index_t kt = ck->hdr.kt;
+    index_t z  = 0;
+    for(index_t X = (1<<level)-1;
+        X < (1<<kt);
+        z = X|(X-1), X = (z+1)|(((~z & -~z)-1) >> (__builtin_ctz(X) + 1)))
+    {
+        ckpt_pio(ck->fd, ck->f_v + FV_INDEX(0, n, ck->hdr.k, X), n*sizeof(dist_t),
+                 ckpt_f_offset(ck, X), write);
+#ifdef TRACK_OPTIMAL
+        ckpt_pio(ck->fd, ck->b_v + BV_INDEX(0, n, ck->hdr.k, X), n*sizeof(bptr_t),
+                 ckpt_b_offset(ck, X), write);
+#endif
+    }
+}
+
+static void *ckpt_writer(void *arg)
+{
+    ckpt_t *ck = (ckpt_t *) arg;
+    double start = omp_get_wtime();
+    ckpt_rows(ck, ck->writing, 1);
+    if(fdatasync(ck->fd) != 0)
+        ERROR("checkpoint sync failed");
+    ck->hdr.level = ck->writing;
+    ckpt_pio(ck->fd, &ck->hdr, sizeof(ckpt_header_t), 0, 1);
+    if(fdatasync(ck->fd) != 0)
+        ERROR("checkpoint sync failed");
+    ck->write_time += omp_get_wtime() - start;
+    return NULL;
+}
+
+static void ckpt_wait(ckpt_t *ck)
+{
+    if(ck->writing == 0)
+        return;
+    pthread_join(ck->writer, NULL);
+    ck->writing = 0;
+}
+
+ckpt_t *ckpt_open(const char *path, steinerq_t *root, index_t kt, 
+                  dist_t *f_v
+#ifdef TRACK_OPTIMAL
+                  ,bptr_t *b_v
+#endif
+                  )
+{
+    ckpt_t *ck = (ckpt_t *) MALLOC(sizeof(ckpt_t));
+    memset(&ck->hdr, 0, sizeof(ckpt_header_t));
+    ck->hdr.magic      = CKPT_MAGIC;
+    ck->hdr.n          = root->n;
+    ck->hdr.m          = root->m;
+    ck->hdr.k          = root->k;
+    ck->hdr.kt         = kt;
+    ck->hdr.dist_bytes = sizeof(dist_t);
+#ifdef TRACK_OPTIMAL
+    ck->hdr.bptr_bytes = sizeof(bptr_t);
+#endif
+    ck->hdr.hash       = graph_hash(root);
+    for(index_t i = 0; i < root->k; i++)
+        ck->hdr.kk[i] = root->kk[i];
+    ck->f_v        = f_v;
+#ifdef TRACK_OPTIMAL
+    ck->b_v        = b_v;
+#endif
+    ck->resumed    = 0;
+    ck->writing    = 0;
+    ck->write_time = 0;
+
+    ck->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if(ck->fd < 0)
+        ERROR("unable to open checkpoint file '%s'", path);
+
+    ckpt_header_t hdr;
+    if(pread(ck->fd, &hdr, sizeof(hdr), 0) == sizeof(hdr) && hdr.level > 0)
+    {
+        // same instance, same table layout, else refuse to overwrite it
+        index_t level = hdr.level;
+        hdr.level = 0;
+        if(memcmp(&hdr, &ck->hdr, sizeof(hdr)) != 0)
+            ERROR("checkpoint file '%s' belongs to a different instance "
+                  "or build", path);
+        for(index_t l = 1; l <= level; l++)
+            ckpt_rows(ck, l, 0);
+        ck->hdr.level = level;
+        ck->resumed   = level;
+    }
+    else
+    {
+        ckpt_pio(ck->fd, &ck->hdr, sizeof(ckpt_header_t), 0, 1);
+    }
+    return ck;
+}
+
+void ckpt_level(ckpt_t *ck, index_t level)
+{
+    // at most one level in flight, the previous one is on disk first
+    ckpt_wait(ck);
+    ck->writing = level;
+    if(pthread_create(&ck->writer, NULL, ckpt_writer, ck) != 0)
+        ERROR("unable to start checkpoint writer");
+}
+
+void ckpt_close(ckpt_t *ck)
+{
+    ckpt_wait(ck);
+    close(ck->fd);
+    FREE(ck);
+}
+
+/******************************************************************* Metrics. */
+/*
+ * Per level figures of one emv_kernel run, written with -metrics <file> as
+ * JSON, or as CSV if the file name ends in ".csv". Thread th adds the time
+ * of its merges and Dijkstra runs, its heap operations and subsets to its
+ * own slot mx->slot[l*nt + th] of level l, nothing is shared while the 
+ * kernel runs.
+ *
+ * With -counters each thread of the kernel opens perf_event counters for
+ * itself (cycles, instructions, last level cache misses) and reads them
+ * around both phases of every subset. DRAM traffic is estimated as one 
+ * cache line per LLC miss.
+ *
+ */
+
+#define MX_MERGE    0
+#define MX_SSSP     1
+#define MX_PHASES   2
+
+#define HW_CYCLES   0
+#define HW_INSTR    1
+#define HW_LLC_MISS 2
+#define HW_COUNTERS 3
+
+typedef struct metrics_slot
+{
+    double time[MX_PHASES];             // seconds
+    uint64_t hw[MX_PHASES][HW_COUNTERS];
+    index_t subsets;
+    index_t merges;                     // split merges, rows of n each
+    index_t heap_ops;
+} metrics_slot_t;
+
+typedef struct metrics
+{
+    index_t kt;
+    index_t nt;
+    index_t hw;                         // counters open
+    int fd[MAX_THREADS][HW_COUNTERS];
+    double *wall;                       // seconds per level, 0 in task mode
+    metrics_slot_t *slot;
+} metrics_t;
+
+typedef struct mx_mark
+{
+    double time;
+    uint64_t hw[HW_COUNTERS];
+} mx_mark_t;
+
+static int mx_perf_open(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    // this thread on any cpu
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+metrics_t *metrics_alloc(index_t kt, index_t nt, index_t counters)
+{
+    metrics_t *mx = (metrics_t *) MALLOC(sizeof(metrics_t));
+    mx->kt   = kt;
+    mx->nt   = nt;
+    mx->hw   = 0;
+    mx->wall = (double *) MALLOC((kt+1)*sizeof(double));
+    mx->slot = (metrics_slot_t *) MALLOC((kt+1)*nt*sizeof(metrics_slot_t));
+    for(index_t l = 0; l <= kt; l++)
+        mx->wall[l] = 0;
+    memset(mx->slot, 0, (kt+1)*nt*sizeof(metrics_slot_t));
+    for(index_t th = 0; th < nt; th++)
+        for(index_t c = 0; c < HW_COUNTERS; c++)
+            mx->fd[th][c] = -1;
+    if(!counters)
+        return mx;
+
+    // the kernel teams reuse the threads of this one
+    index_t failed = 0;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel num_threads(nt) reduction(+:failed)
+#endif
+    {
+        index_t th = thread_id();
+        int *fd = mx->fd[th];
+        fd[HW_CYCLES]   = mx_perf_open(PERF_TYPE_HARDWARE, 
+                                       PERF_COUNT_HW_CPU_CYCLES);
+        fd[HW_INSTR]    = mx_perf_open(PERF_TYPE_HARDWARE, 
+                                       PERF_COUNT_HW_INSTRUCTIONS);
+        fd[HW_LLC_MISS] = mx_perf_open(PERF_TYPE_HARDWARE,
+                                       PERF_COUNT_HW_CACHE_MISSES);
+        for(index_t c = 0; c < HW_COUNTERS; c++)
+            if(fd[c] < 0)
+                failed++;
+    }
+    if(failed > 0)
+    {
+        // e.g. denied by /proc/sys/kernel/perf_event_paranoid
+        for(index_t th = 0; th < nt; th++)
+            for(index_t c = 0; c < HW_COUNTERS; c++)
+                if(mx->fd[th][c] >= 0)
+                    close(mx->fd[th][c]);
+    }
+    else
+    {
+        mx->hw = 1;
+    }
+    return mx;
+}
+
+void metrics_free(metrics_t *mx)
+{
+    if(mx->hw)
+        for(index_t th = 0; th < mx->nt; th++)
+            for(index_t c = 0; c < HW_COUNTERS; c++)
+                close(mx->fd[th][c]);
+    FREE(mx->wall);
+    FREE(mx->slot);
+    FREE(mx);
+}
+
+static inline void mx_mark(metrics_t *mx, index_t th, mx_mark_t *a)
+{
+    a->time = omp_get_wtime();
+    if(!mx->hw)
+        return;
+    for(index_t c = 0; c < HW_COUNTERS; c++)
+        if(read(mx->fd[th][c], a->hw + c, sizeof(uint64_t)) != 
+           sizeof(uint64_t))
+            a->hw[c] = 0;
+}
+
+// adds the time and counts since a to a phase of level l, a moves on to now
+static inline void mx_add(metrics_t *mx, index_t l, index_t th, 
+                          index_t phase, mx_mark_t *a)
+{
+    mx_mark_t b;
+    mx_mark(mx, th, &b);
+    metrics_slot_t *s = mx->slot + l*mx->nt + th;
+    s->time[phase] += b.time - a->time;
+    if(mx->hw)
+        for(index_t c = 0; c < HW_COUNTERS; c++)
+            s->hw[phase][c] += b.hw[c] - a->hw[c];
+    *a = b;
+}
+
+static void mx_counters_json(FILE *out, uint64_t *hw, double time)
+{
+    fprintf(out, "{\"cycles\": %lu, \"instructions\": %lu, \"ipc\": %.3lf, "
+                 "\"llc_misses\": %lu, \"dram_gib_s\": %.3lf}",
+                 hw[HW_CYCLES], hw[HW_INSTR], 
+                 hw[HW_CYCLES] ? (double) hw[HW_INSTR]/hw[HW_CYCLES] : 0.0,
+                 hw[HW_LLC_MISS], 
+                 time > 0 ? 64.0*hw[HW_LLC_MISS]/time/(1 << 30) : 0.0);
+}
+
+void metrics_write(metrics_t *mx, const char *path, steinerq_t *root,
+                   index_t tasks, index_t cost, double kernel_time)
+{
+    FILE *out = fopen(path, "w");
+    if(out == NULL)
+        ERROR("unable to open metrics file '%s'", path);
+    size_t len = strlen(path);
+    index_t csv = len >= 4 && !strcmp(path + len - 4, ".csv");
+    index_t n = root->n;
+    index_t nt = mx->nt;
+#ifdef TRACK_OPTIMAL
+    index_t mem_graph = 5*n+6*root->m;
+#else
+    index_t mem_graph = 4*n+6*root->m;
+#endif
+
+    if(csv)
+        fprintf(out, "m,subsets,wall_ms,merge_ms,dijkstra_ms,busy_max_ms,"
+                     "busy_mean_ms,imbalance,heap_ops,merges,bytes,"
+                     "merge_cycles,merge_instructions,merge_llc_misses,"
+                     "dijkstra_cycles,dijkstra_instructions,"
+                     "dijkstra_llc_misses\n");
+    else
+        fprintf(out, "{\n  \"n\": %ld, \"m\": %ld, \"k\": %ld, \"kt\": %ld, "
+                     "\"threads\": %ld, \"scheduler\": \"%s\", "
+                     "\"counters\": %s,\n  \"cost\": %ld, "
+                     "\"kernel_ms\": %.3lf,\n  \"levels\": [",
+                     n, root->m, root->k, mx->kt, nt, 
+                     tasks ? "tasks" : "levels", mx->hw ? "true" : "false",
+                     cost, kernel_time);
+
+    for(index_t l = 1; l <= mx->kt; l++)
+    {
+        metrics_slot_t *s = mx->slot + l*nt;
+        metrics_slot_t sum;
+        memset(&sum, 0, sizeof(sum));
+        double busy_max = 0;
+        index_t active = 0;
+        for(index_t th = 0; th < nt; th++)
+        {
+            if(s[th].time[MX_MERGE] + s[th].time[MX_SSSP] > 0)
+                active++;
+            for(index_t p = 0; p < MX_PHASES; p++)
+            {
+                sum.time[p] += s[th].time[p];
+                for(index_t c = 0; c < HW_COUNTERS; c++)
+                    sum.hw[p][c] += s[th].hw[p][c];
+            }
+            sum.subsets  += s[th].subsets;
+            sum.merges   += s[th].merges;
+            sum.heap_ops += s[th].heap_ops;
+            busy_max = MAX(busy_max, s[th].time[MX_MERGE] + 
+                                     s[th].time[MX_SSSP]);
+        }
+        // over the threads that could take part, a level of fewer subsets
+        // than threads is not counted as imbalanced for its idle threads
+        index_t part = MAX(1, MIN(nt, MAX(sum.subsets, active)));
+        double busy_mean = (sum.time[MX_MERGE] + sum.time[MX_SSSP])/part;
+        double imbalance = busy_mean > 0 ? busy_max/busy_mean : 1.0;
+        index_t bytes = sum.merges*3*n*sizeof(dist_t) +
+                        sum.subsets*mem_graph*sizeof(index_t) +
+                        sum.heap_ops*sizeof(heap_node_t);
+
+        if(csv)
+        {
+            fprintf(out, "%ld,%ld,%.3lf,%.3lf,%.3lf,%.3lf,%.3lf,%.3lf,"
+                         "%ld,%ld,%ld,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                         l, sum.subsets, 1000.0*mx->wall[l], 
+                         1000.0*sum.time[MX_MERGE], 1000.0*sum.time[MX_SSSP],
+                         1000.0*busy_max, 1000.0*busy_mean, imbalance,
+                         sum.heap_ops, sum.merges, bytes,
+                         sum.hw[MX_MERGE][HW_CYCLES], 
+                         sum.hw[MX_MERGE][HW_INSTR],
+                         sum.hw[MX_MERGE][HW_LLC_MISS], 
+                         sum.hw[MX_SSSP][HW_CYCLES],
+                         sum.hw[MX_SSSP][HW_INSTR], 
+                         sum.hw[MX_SSSP][HW_LLC_MISS]);
+            continue;
+        }
+        fprintf(out, "%s\n    {\"m\": %ld, \"subsets\": %ld, "
+                     "\"wall_ms\": %.3lf, \"merge_ms\": %.3lf, "
+                     "\"dijkstra_ms\": %.3lf,\n     \"busy_ms\": [",
+                     (l == 1) ? "" : ",", l, sum.subsets, 
+                     1000.0*mx->wall[l], 1000.0*sum.time[MX_MERGE], 
+                     1000.0*sum.time[MX_SSSP]);
+        for(index_t th = 0; th < nt; th++)
+            fprintf(out, "%s%.3lf", (th == 0) ? "" : ", ", 
+                         1000.0*(s[th].time[MX_MERGE] + s[th].time[MX_SSSP]));
+        fprintf(out, "], \"imbalance\": %.3lf,\n     \"heap_ops\": %ld, "
+                     "\"merges\": %ld, \"bytes\": %ld",
+                     imbalance, sum.heap_ops, sum.merges, bytes);
+        if(mx->hw)
+        {
+            fprintf(out, ",\n     \"merge_counters\": ");
+            mx_counters_json(out, sum.hw[MX_MERGE], sum.time[MX_MERGE]);
+            fprintf(out, ",\n     \"dijkstra_counters\": ");
+            mx_counters_json(out, sum.hw[MX_SSSP], sum.time[MX_SSSP]);
+        }
+        fprintf(out, "}");
+    }
+    if(!csv)
+        fprintf(out, "\n  ]\n}\n");
+    fclose(out);
+}
+
+/*********************************************************** Heuristic tree. */
+/*
+ * A tree from the singleton rows alone, f_t[v] = d(v, t) for the first kt
+ * terminals or groups. The shortest path heuristic grows a tree from a
+ * vertex r of the root, each step joins the terminal closest to the tree
+ * by a shortest path, walked down row t to the terminal. A minimum
+ * spanning tree of the vertices reached then replaces the tree, and its
+ * leaves that no terminal needs are cut off. The tree gives the anytime
+ * answer and an upper bound for pruning.
+ */
+
+typedef struct heur
+{
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t *pos;
+    adj_t *adj;
+    index_t *gm;      // terminals of each vertex, bit t for terminal t
+    char *in;         // vertex in the tree
+    index_t *tv;      // the vertices of the tree
+    index_t nv;
+    index_t *parent;  // plateau search
+    index_t *queue;
+    unsigned *mark;
+    unsigned gen;
+} heur_t;
+
+static void hr_join(heur_t *h, index_t v, index_t kt, dist_t *f_v, 
+                    dist_t *best, index_t *att)
+{
+    // v joins the tree, the terminals outside may now be closer to it
+    if(h->in[v])
+        return;
+    h->in[v] = 1;
+    h->tv[h->nv++] = v;
+    for(index_t t = 0; t < kt; t++)
+    {
+        dist_t d = f_v[FV_INDEX(v, h->n, h->k, 1<<t)];
+        if(d < best[t])
+        {
+            best[t] = d;
+            att[t]  = v;
+        }
+    }
+}
+
+static index_t hr_exit(heur_t *h, index_t v, dist_t *f_t)
+{
+    // a neighbour over a positive edge on a shortest path from v
+    for(index_t i = ARC_FIRST(h->pos, h->adj, v); 
+        i < ARC_END(h->pos, h->adj, v); i += ARC_STEP)
+    {
+        index_t w = ARC_HEAD(h->adj, h->m, i);
+        index_t c = ARC_WEIGHT(h->adj, h->m, i);
+        if(c > 0 && f_t[w] != DIST_INF && f_t[w] + c == f_t[v])
+            return w;
+    }
+    return UNDEFINED;
+}
+
+static index_t hr_down(heur_t *h, index_t v, index_t t, dist_t *f_t)
+{
+    // the next vertex on a shortest path from v down to terminal t, a
+    // breadth-first search crosses a plateau of zero weight edges
+    index_t w = hr_exit(h, v, f_t);
+    if(w != UNDEFINED)
+        return w;
+
+    unsigned g = ++h->gen;
+    if(g == 0)
+    {
+        memset(h->mark, 0, h->n*sizeof(unsigned));
+        g = h->gen = 1;
+    }
+    index_t head = 0;
+    index_t tail = 0;
+    h->queue[tail++] = v;
+    h->mark[v] = g;
+    while(head < tail)
+    {
+        index_t y = h->queue[head++];
+        for(index_t i = ARC_FIRST(h->pos, h->adj, y); 
+            i < ARC_END(h->pos, h->adj, y); i += ARC_STEP)
+        {
+            index_t z = ARC_HEAD(h->adj, h->m, i);
+            if(ARC_WEIGHT(h->adj, h->m, i) != 0 || f_t[z] != f_t[v] || 
+               h->mark[z] == g)
+                continue;
+            h->mark[z] = g;
+            h->parent[z] = y;
+            h->queue[tail++] = z;
+            if(((h->gm[z] >> t) & 1) || hr_exit(h, z, f_t) != UNDEFINED)
+            {
+                // the first step of the path over the plateau
+                while(h->parent[z] != v)
+                    z = h->parent[z];
+                return z;
+            }
+        }
+    }
+    return UNDEFINED;
+}
+
+static int hr_cmp_weight(const void *a, const void *b)
+{
+    index_t wa = ((const index_t *) a)[2];
+    index_t wb = ((const index_t *) b)[2];
+    return (wa > wb) - (wa < wb);
+}
+
+static index_t hr_find(index_t *uf, index_t x)
+{
+    while(uf[x] != x)
+        x = uf[x] = uf[uf[x]];
+    return x;
+}
+
+// returns NULL if some terminal is out of reach
+graph_t *heuristic_tree(index_t n, index_t m, index_t k, index_t kt, 
+                        index_t *kk, index_t *gpos, index_t *gv, 
+                        index_t *pos, adj_t *adj, dist_t *f_v)
+{
+    heur_t h;
+    h.n = n; h.m = m; h.k = k; h.pos = pos; h.adj = adj; h.nv = 0; h.gen = 0;
+    h.gm     = (index_t *) MALLOC(n*sizeof(index_t));
+    h.in     = (char *) MALLOC(n*sizeof(char));
+    h.tv     = (index_t *) MALLOC(n*sizeof(index_t));
+    h.parent = (index_t *) MALLOC(n*sizeof(index_t));
+    h.queue  = (index_t *) MALLOC(n*sizeof(index_t));
+    h.mark   = (unsigned *) MALLOC(n*sizeof(unsigned));
+    memset(h.gm, 0, n*sizeof(index_t));
+    memset(h.in, 0, n*sizeof(char));
+    memset(h.mark, 0, n*sizeof(unsigned));
+    for(index_t t = 0; t < k; t++)
+    {
+        index_t len;
+        index_t *g_t = group_of(kk, gpos, gv, t, &len);
+        for(index_t i = 0; i < len; i++)
+            h.gm[g_t[i]] |= 1L<<t;
+    }
+
+    // the root vertex with the cheapest star to the other terminals
+    index_t len;
+    index_t *g_q = group_of(kk, gpos, gv, k-1, &len);
+    index_t r = g_q[0];
+    index_t r_star = (index_t) DIST_INF;
+    for(index_t i = 0; i < len; i++)
+    {
+        index_t star = 0;
+        for(index_t t = 0; t < k-1; t++)
+            star += f_v[FV_INDEX(g_q[i], n, k, 1<<t)];
+        if(star < r_star)
+        {
+            r = g_q[i];
+            r_star = star;
+        }
+    }
+
+    dist_t best[MAX_K];
+    index_t att[MAX_K];
+    index_t left = (1L<<(k-1))-1;
+    for(index_t t = 0; t < kt; t++)
+        best[t] = DIST_INF;
+    hr_join(&h, r, kt, f_v, best, att);
+    while(left != 0)
+    {
+        index_t s = UNDEFINED;
+        for(index_t L = left; L != 0; L &= L-1)
+        {
+            index_t t = __builtin_ctzl(L);
+            if(s == UNDEFINED || best[t] < best[s])
+                s = t;
+        }
+        if(best[s] == DIST_INF)
+            break;
+        left &= ~(1L<<s);
+
+        // walk down row s from the tree to a vertex of terminal s
+        dist_t *f_s = f_v + FV_INDEX(0, n, k, 1<<s);
+        for(index_t v = att[s]; !((h.gm[v] >> s) & 1); )
+        {
+            index_t w = hr_down(&h, v, s, f_s);
+            if(w == UNDEFINED)
+                ERROR("heuristic: no shortest path out of vertex %ld", v);
+            hr_join(&h, w, kt, f_v, best, att);
+            v = w;
+        }
+    }
+
+    graph_t *g = NULL;
+    if(left == 0)
+    {
+        // Kruskal over the edges between the vertices the paths reached
+        index_t ne  = 0;
+        index_t cap = MAX(h.nv, 1);
+        index_t *e  = (index_t *) MALLOC(3*cap*sizeof(index_t));
+        for(index_t j = 0; j < h.nv; j++)
+        {
+            index_t u = h.tv[j];
+            for(index_t i = ARC_FIRST(pos, adj, u); i < ARC_END(pos, adj, u); 
+                i += ARC_STEP)
+            {
+                index_t w = ARC_HEAD(adj, m, i);
+                if(w <= u || !h.in[w])
+                    continue;
+                if(ne == cap)
+                {
+                    e = enlarge(6*cap, 3*cap, e);
+                    cap *= 2;
+                }
+                e[3*ne]   = u;
+                e[3*ne+1] = w;
+                e[3*ne+2] = ARC_WEIGHT(adj, m, i);
+                ne++;
+            }
+        }
+        qsort(e, ne, 3*sizeof(index_t), hr_cmp_weight);
+        index_t *uf  = h.parent;
+        index_t *deg = h.queue;
+        for(index_t j = 0; j < h.nv; j++)
+        {
+            uf[h.tv[j]]  = h.tv[j];
+            deg[h.tv[j]] = 0;
+        }
+        index_t nm = 0;
+        for(index_t j = 0; j < ne; j++)
+        {
+            index_t a = hr_find(uf, e[3*j]);
+            index_t b = hr_find(uf, e[3*j+1]);
+            if(a == b)
+                continue;
+            uf[a] = b;
+            deg[e[3*j]]++;
+            deg[e[3*j+1]]++;
+            for(index_t x = 0; x < 3; x++)
+                e[3*nm+x] = e[3*j+x];
+            nm++;
+        }
+
+        // cut the leaves whose terminals other tree vertices hold, the
+        // edges of vertex u are inc[off[u]..off[u]+deg[u]-1]
+        index_t *off  = uf;
+        index_t *inc  = (index_t *) MALLOC(2*MAX(nm, 1)*sizeof(index_t));
+        index_t *cand = (index_t *) MALLOC(h.nv*sizeof(index_t));
+        char *alive   = (char *) MALLOC(MAX(nm, 1)*sizeof(char));
+        index_t run = 0;
+        for(index_t j = 0; j < h.nv; j++)
+        {
+            off[h.tv[j]] = run;
+            run += deg[h.tv[j]];
+            deg[h.tv[j]] = 0;
+        }
+        for(index_t j = 0; j < nm; j++)
+        {
+            alive[j] = 1;
+            for(index_t x = 0; x < 2; x++)
+            {
+                index_t u = e[3*j+x];
+                inc[off[u] + deg[u]++] = j;
+            }
+        }
+        index_t cnt[MAX_K];
+        for(index_t t = 0; t < k; t++)
+            cnt[t] = 0;
+        for(index_t j = 0; j < h.nv; j++)
+            for(index_t M = h.gm[h.tv[j]]; M != 0; M &= M-1)
+                cnt[__builtin_ctzl(M)]++;
+        index_t top = 0;
+        for(index_t j = 0; j < h.nv; j++)
+            cand[top++] = h.tv[j];
+        while(top > 0)
+        {
+            index_t x = cand[--top];
+            index_t held = 1;
+            for(index_t M = h.gm[x]; M != 0; M &= M-1)
+                held &= (cnt[__builtin_ctzl(M)] > 1);
+            if(deg[x] != 1 || !held)
+                continue;
+            index_t j = UNDEFINED;
+            for(index_t i = off[x]; j == UNDEFINED; i++)
+                if(alive[inc[i]])
+                    j = inc[i];
+            index_t y = e[3*j] ^ e[3*j+1] ^ x;
+            alive[j] = 0;
+            deg[x]--;
+            deg[y]--;
+            for(index_t M = h.gm[x]; M != 0; M &= M-1)
+                cnt[__builtin_ctzl(M)]--;
+            cand[top++] = y;
+        }
+
+        g = graph_alloc();
+        g->n = n;
+        g->cost = 0;
+        for(index_t j = 0; j < nm; j++)
+        {
+            if(!alive[j])
+                continue;
+            graph_add_edge(g, e[3*j], e[3*j+1], e[3*j+2]);
+            g->cost += e[3*j+2];
+        }
+        g->m = g->num_edges;
+        FREE(inc);
+        FREE(cand);
+        FREE(alive);
+        FREE(e);
+    }
+
+    FREE(h.gm);
+    FREE(h.in);
+    FREE(h.tv);
+    FREE(h.parent);
+    FREE(h.queue);
+    FREE(h.mark);
+    return g;
+}
+
+/*
+ * Anytime mode: the heuristic tree answers until the table is done. Past
+ * the deadline the kernel skips the subsets left, done[X] marks the rows 
+ * that were finished. A tree of C at q costs at least f_X[q] for X in C, 
+ * the largest finished f_X[q] bounds the optimum from below. Pruning 
+ * leaves a label of X at q exact only if f_X[q] + d(q, t) <= ub for all 
+ * t outside X, so there the bound of X is capped at ub - d(q, t) + 1.
+ */
+
+typedef struct anytime
+{
+    double deadline;    // omp_get_wtime() to stop at, 0 for no budget
+    index_t stopped;
+    char *done;
+    graph_t *tree;      // heuristic tree, NULL if a terminal is unreachable
+    double tree_time;   // ms to build the heuristic tree, -1 if not built
+    index_t tree_cost;  // its cost, -1 without a tree
+} anytime_t;
+
+anytime_t *anytime_alloc(index_t kt, double deadline)
+{
+    anytime_t *at = (anytime_t *) MALLOC(sizeof(anytime_t));
+    at->deadline = deadline;
+    at->stopped  = 0;
+    at->done     = (char *) MALLOC((1<<kt)*sizeof(char));
+    at->tree     = NULL;
+    at->tree_time = -1;
+    at->tree_cost = -1;
+    memset(at->done, 0, (1<<kt)*sizeof(char));
+    return at;
+}
+
+void anytime_free(anytime_t *at)
+{
+    if(at->tree != NULL)
+        graph_free(at->tree);
+    FREE(at->done);
+    FREE(at);
+}
+
+static inline index_t anytime_expired(anytime_t *at)
+{
+    if(at == NULL || at->deadline == 0)
+        return 0;
+    if(omp_get_wtime() <= at->deadline)
+        return 0;
+#ifdef BUILD_PARALLEL
+#pragma omp atomic write
+#endif
+    at->stopped = 1;
+    return 1;
+}
+
+// the lower bound of the finished rows, and the smallest unfinished level
+index_t anytime_bound(anytime_t *at, index_t n, index_t k, index_t kt, 
+                      index_t *kk, index_t *gpos, index_t *gv, dist_t *f_v,
+                      dist_t ub, index_t *level)
+{
+    index_t C = (1<<(k-1))-1;
+    *level = kt+1;
+    for(index_t X = 1; X < (1<<kt); X++)
+        if(!at->done[X])
+            *level = MIN(*level, __builtin_popcountl(X));
+
+    index_t len;
+    index_t *g_q = group_of(kk, gpos, gv, k-1, &len);
+    index_t lb = (index_t) DIST_INF;
+    for(index_t i = 0; i < len; i++)
+    {
+        index_t q = g_q[i];
+        index_t lb_q = 0;
+        for(index_t X = 1; X <= C; X++)
+        {
+            if(!at->done[X])
+                continue;
+            index_t b = (index_t) f_v[FV_INDEX(q, n, k, X)];
+            if(ub != DIST_INF)
+            {
+                index_t d = 0;
+                for(index_t t = 0; t < kt; t++)
+                    if(!(X & (1<<t)))
+                        d = MAX(d, (index_t) f_v[FV_INDEX(q, n, k, 1<<t)]);
+                b = MIN(b, (index_t) ub - d + 1);
+            }
+            lb_q = MAX(lb_q, b);
+        }
+        lb = MIN(lb, lb_q);
+    }
+    return lb;
+}
+
+/**************************************************** Erickson Monma Veinott. */
+
+void first_touch(index_t n,
+                 index_t k,
+                 index_t kt,
+                 dist_t *f_v,
+                 index_t nt
+#ifdef TRACK_OPTIMAL
+                 ,bptr_t *b_v
+#endif
+                 )
+{
+    // each row is initialised by the thread that computes it in
+    // emv_kernel, same blocks on the same OpenMP threads, so its pages
+    // land on that node
+#ifdef BUILD_PARALLEL
+#pragma omp parallel num_threads(nt)
+#endif
+    for(index_t th = thread_id(); th < nt; th += omp_get_num_threads())
+    {
+        for(index_t X = 1; X < (1<<kt); X++)
+        {
+            index_t m = __builtin_popcountl(X);
+            index_t kCm = choose(kt, m);
+            index_t block_size = kCm/nt;
+            // rank of X among the m-subsets in increasing order
+            index_t rank = 0;
+            index_t j = 0;
+            for(index_t t = 0; t < kt; t++)
+            {
+                if(!(X & (1<<t)))
+                    continue;
+                j++;
+                if(t >= j)
+                    rank += choose(t, j);
+            }
+            index_t owner = (block_size == 0) ? nt-1 : MIN(rank/block_size, nt-1);
+            if(owner != th)
+                continue;
+
+            dist_t *f_X = f_v + FV_INDEX(0, n, k, X);
+            for(index_t v = 0; v < n; v++)
+                f_X[v] = DIST_INF;
+#ifdef TRACK_OPTIMAL
+            bptr_t *b_X = b_v + BV_INDEX(0, n, k, X);
+            for(index_t v = 0; v < n; v++)
+                BV_SET(b_X[v], UNDEFINED, 0);
+#endif
+        }
+    }
+    // the empty set row is never computed
+    for(index_t v = 0; v < n; v++)
+        f_v[v] = DIST_INF;
+#ifdef TRACK_OPTIMAL
+    for(index_t v = 0; v < n; v++)
+        BV_SET(b_v[v], UNDEFINED, 0);
+#endif
+}
+
+static void subset_rows(index_t n,
+                        index_t k,
+                        index_t X,
+                        dist_t *f_v,
+                        const int *fd,
+                        index_t writeback
+#ifdef TRACK_OPTIMAL
+                        ,bptr_t *b_v
+#endif
+                        )
+{
+    // out-of-core: page in the rows X reads, or write back the rows of X
+    if(!writeback)
+    {
+        for(index_t Y = (X-1) & X; Y != 0; Y = (Y-1) & X)
+            table_advise(fd[0], f_v, FV_INDEX(0, n, k, Y)*sizeof(dist_t),
+                         n*sizeof(dist_t), 0);
+    }
+    table_advise(fd[0], f_v, FV_INDEX(0, n, k, X)*sizeof(dist_t), 
+                 n*sizeof(dist_t), writeback);
+#ifdef TRACK_OPTIMAL
+    table_advise(fd[1], b_v, BV_INDEX(0, n, k, X)*sizeof(bptr_t),
+                 n*sizeof(bptr_t), writeback);
+#endif
+}
+
+static void emv_subset(index_t n, 
+                       index_t m, 
+                       index_t k, 
+                       index_t kt, 
+                       index_t *kk, 
+                       index_t *gpos,
+                       index_t *gv,
+                       dist_t *f_v, 
+                       index_t *pos, 
+                       adj_t *adj, 
+                       dijkstra_ws_t *ws_th,
+                       delta_ws_t *dw,
+                       index_t X,
+                       prune_t *pr,
+                       metrics_t *mx,
+                       index_t th
+#ifdef TRACK_OPTIMAL
+                       ,bptr_t *b_v 
+#endif
+#ifdef TRACK_BANDWIDTH
+                       ,index_t *heap_ops_th
+#endif
+                       )
+{
+    index_t l = __builtin_popcountl(X);
+    mx_mark_t a;
+    if(mx != NULL)
+        mx_mark(mx, th, &a);
+#ifdef TRACK_BANDWIDTH
+    index_t heap_was = *heap_ops_th;
+#endif
+    dist_t *f_X    = f_v + FV_INDEX(0, n, k, X);
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_X  = b_v + BV_INDEX(0, n, k, X);
+    index_t *p_th = (dw != NULL) ? dw->p : ws_th->p;
+#endif
+    // bit twiddling hacks: each unordered split {X', X - X'} is
+    // generated once, as the X' that contain the lowest bit of X
+    // with dw the tiles of the one subset are split over the threads
+    index_t lo = X & (-X);
+    index_t R  = X & ~lo;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for schedule(static) if(dw != NULL)
+#endif
+    for(index_t v0 = 0; v0 < n; v0 += MERGE_TILE)
+    {
+        index_t v1 = MIN(v0 + MERGE_TILE, n);
+        for(index_t Y = 0; Y != R; Y = (Y - R) & R) // 2^(|X|-1) - 1
+        {
+            index_t Xd   = lo | Y;
+            index_t X_Xd = (R & ~Y); // X - X' 
+            if(pr != NULL && (pr->row_min[Xd] > pr->ub || 
+                              pr->row_min[X_Xd] > pr->ub - pr->row_min[Xd]))
+            {
+                // no split label fits under the bound
+                if(v0 == 0)
+                    pr->pruned[3*th+2]++;
+                continue;
+            }
+            dist_t *f_Xd   = f_v + FV_INDEX(0, n, k, Xd);
+            dist_t *f_X_Xd = f_v + FV_INDEX(0, n, k, X_Xd);
+            merge_rows(v0, v1, f_X, f_Xd, f_X_Xd
+#ifdef TRACK_OPTIMAL
+                       ,b_X, Xd
+#endif
+                       );
+        }
+    }
+
+    for(index_t t = 0; t < kt; t++)
+    {
+        if(!(X & (1<<t)))
+            continue;
+        index_t len;
+        index_t *g_t  = group_of(kk, gpos, gv, t, &len);
+        index_t X_u   = (X & ~(1<<t));
+        for(index_t i = 0; i < len; i++)
+        {
+            index_t u     = g_t[i];
+            index_t i_X_u = FV_INDEX(u, n, k, X_u);
+            if(f_v[i_X_u] < f_X[u])
+            {
+                f_X[u] = f_v[i_X_u];
+#ifdef TRACK_OPTIMAL    
+                BV_SET(b_X[u], u, X_u);
+#endif
+            }
+        }
+    }
+
+    if(mx != NULL)
+        mx_add(mx, l, th, MX_MERGE, &a);
+
+    // shortest paths seeded with the labels f_X, in place, with pruning
+    // bounded by the terminals outside X
+    index_t mask = (pr != NULL) ? ((1<<pr->kb)-1) & ~X : 0;
+    dist_t d_min = (dw != NULL) ? 
+                   delta_multi(n, m, pos, adj, f_X, dw, pr, mask) :
+                   dijkstra_multi(n, m, pos, adj, f_X, ws_th, pr, mask, th
+#ifdef TRACK_BANDWIDTH
+                                  ,heap_ops_th
+#endif
+                                  );
+    if(pr != NULL)
+        pr->row_min[X] = d_min;
+#ifdef TRACK_OPTIMAL
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for schedule(static) if(dw != NULL)
+#endif
+    for(index_t v = 0; v < n; v++)
+    {
+        index_t u = p_th[v];
+        if(u != UNDEFINED && f_X[v] != DIST_INF)
+            BV_SET(b_X[v], u, X);
+        // mem: 2^k * 2n 
+    }
+#endif
+    if(mx != NULL)
+    {
+        mx_add(mx, l, th, MX_SSSP, &a);
+        metrics_slot_t *sl = mx->slot + l*mx->nt + th;
+        sl->subsets++;
+        sl->merges += (1<<(l-1))-1;
+#ifdef TRACK_BANDWIDTH
+        sl->heap_ops += *heap_ops_th - heap_was;
+#endif
+    }
+}
+
+static void emv_singleton(index_t n, 
+                          index_t m, 
+                          index_t k, 
+                          index_t *kk, 
+                          index_t *gpos,
+                          index_t *gv,
+                          dist_t *f_v, 
+                          index_t *pos, 
+                          adj_t *adj, 
+                          dijkstra_ws_t *ws_th,
+                          delta_ws_t *dw,
+                          index_t t,
+                          metrics_t *mx,
+                          index_t th
+#ifdef TRACK_OPTIMAL
+                          ,bptr_t *b_v 
+#endif
+#ifdef TRACK_BANDWIDTH
+                          ,index_t *heap_ops_th
+#endif
+                          )
+{
+    mx_mark_t a;
+    if(mx != NULL)
+        mx_mark(mx, th, &a);
+#ifdef TRACK_BANDWIDTH
+    index_t heap_was = *heap_ops_th;
+#endif
+    dist_t *f_t = f_v + FV_INDEX(0, n, k, 1<<t);
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_t = b_v + BV_INDEX(0, n, k, 1<<t);
+#endif
+    if(gpos == NULL && dw == NULL)
+    {
+        dijkstra(n, m, pos, adj, kk[t], f_t, ws_th
+#ifdef TRACK_BANDWIDTH
+                 ,heap_ops_th
+#endif
+                 );
+#ifdef TRACK_OPTIMAL
+        for(index_t v = 0; v < n; v++) 
+            BV_SET(b_t[v], kk[t], 1<<t);
+#endif
+    }
+    else if(gpos == NULL)
+    {
+        // the source alone, on all threads
+        for(index_t v = 0; v < n; v++)
+            f_t[v] = DIST_INF;
+        f_t[kk[t]] = 0;
+        delta_multi(n, m, pos, adj, f_t, dw, NULL, 0);
+#ifdef TRACK_OPTIMAL
+        for(index_t v = 0; v < n; v++) 
+            BV_SET(b_t[v], kk[t], 1<<t);
+#endif
+    }
+    else
+    {
+        // one multi-source run from all members of group t, the paths 
+        // end at the member they start from
+        for(index_t v = 0; v < n; v++)
+            f_t[v] = DIST_INF;
+        for(index_t i = gpos[t]; i < gpos[t+1]; i++)
+            f_t[gv[i]] = 0;
+        if(dw != NULL)
+            delta_multi(n, m, pos, adj, f_t, dw, NULL, 0);
+        else
+            dijkstra_multi(n, m, pos, adj, f_t, ws_th, NULL, 0, th
+#ifdef TRACK_BANDWIDTH
+                           ,heap_ops_th
+#endif
+                           );
+#ifdef TRACK_OPTIMAL
+        index_t *p_th = (dw != NULL) ? dw->p : ws_th->p;
+        for(index_t v = 0; v < n; v++)
+        {
+            index_t u = p_th[v];
+            BV_SET(b_t[v], (u != UNDEFINED && f_t[v] != DIST_INF) ? u : v, 
+                   1<<t);
+        }
+#endif
+    }
+    // mem: 2*k*n
+    if(mx != NULL)
+    {
+        mx_add(mx, 1, th, MX_SSSP, &a);
+        metrics_slot_t *sl = mx->slot + mx->nt + th;
+        sl->subsets++;
+#ifdef TRACK_BANDWIDTH
+        sl->heap_ops += *heap_ops_th - heap_was;
+#endif
+    }
+}
+
+/* 
+ * Task mode: subset X becomes ready once every X - {t} is done, which by
+ * induction covers all proper subsets read by the merges. 'pending[X]'
+ * counts the missing X - {t}, the task completing the last one spawns X.
+ */
+
+typedef struct emv_tasks
+{
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t kt;
+    index_t *kk;
+    index_t *gpos;
+    index_t *gv;
+    dist_t *f_v;
+    index_t *pos;
+    adj_t *adj;
+    dijkstra_ws_t **ws;
+    index_t *pending;
+    double *busy;
+    const int *ooc;
+    prune_t *pr;
+    metrics_t *mx;
+    anytime_t *at;
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_v;
+#endif
+#ifdef TRACK_BANDWIDTH
+    index_t *heap_ops;
+    index_t *merge_ops;
+    index_t *sssp_ops;
+#endif
+} emv_tasks_t;
+
+static void emv_release(emv_tasks_t *e, index_t X);
+
+static void emv_task(emv_tasks_t *e, index_t X)
+{
+    if(anytime_expired(e->at))
+    {
+        // out of time, the supersets are skipped in turn
+        emv_release(e, X);
+        return;
+    }
+    // the thread running the task is charged, not the one that spawned it
+    index_t th = thread_id();
+    double start = omp_get_wtime();
+    index_t size = __builtin_popcountl(X);
+    if(e->ooc)
+        subset_rows(e->n, e->k, X, e->f_v, e->ooc, 0
+#ifdef TRACK_OPTIMAL
+                    ,e->b_v
+#endif
+                    );
+    if(size == 1)
+    {
+        emv_singleton(e->n, e->m, e->k, e->kk, e->gpos, e->gv, e->f_v, 
+                      e->pos, e->adj, e->ws[th], NULL, __builtin_ctzl(X), 
+                      e->mx, th
+#ifdef TRACK_OPTIMAL
+                      ,e->b_v
+#endif
+#ifdef TRACK_BANDWIDTH
+                      ,e->heap_ops + th
+#endif
+                      );
+    }
+    else
+    {
+        emv_subset(e->n, e->m, e->k, e->kt, e->kk, e->gpos, e->gv, e->f_v, 
+                   e->pos, e->adj, e->ws[th], NULL, X, e->pr, e->mx, th
+#ifdef TRACK_OPTIMAL
+                   ,e->b_v
+#endif
+#ifdef TRACK_BANDWIDTH
+                   ,e->heap_ops + th
+#endif
+                   );
+    }
+    if(e->ooc)
+        subset_rows(e->n, e->k, X, e->f_v, e->ooc, 1
+#ifdef TRACK_OPTIMAL
+                    ,e->b_v
+#endif
+                    );
+#ifdef TRACK_BANDWIDTH
+    e->merge_ops[th] += (1<<(size-1))-1;
+    e->sssp_ops[th]++;
+#endif
+    e->busy[th] += omp_get_wtime() - start;
+    if(e->at != NULL)
+        e->at->done[X] = 1;
+    emv_release(e, X);
+}
+
+static void emv_release(emv_tasks_t *e, index_t X)
+{
+    // X is done, spawn the supersets it completes
+    for(index_t t = 0; t < e->kt; t++)
+    {
+        if(X & (1<<t))
+            continue;
+        index_t Y = X | (1<<t);
+        index_t left;
+#ifdef BUILD_PARALLEL
+#pragma omp atomic capture
+#endif
+        left = --e->pending[Y];
+        if(left == 0)
+        {
+#ifdef BUILD_PARALLEL
+#pragma omp task firstprivate(Y)
+#endif
+            emv_task(e, Y);
+        }
+    }
+}
+
+/*
+ * Pruning bound: the shortest paths along a minimum spanning tree of the
+ * distance network of the terminals span all terminals, so the weight of
+ * the tree bounds the optimum. The network and the lower bounds come from
+ * the singleton rows, d(q, t) of the root is read from row {t} when the
+ * table has no root row. The rows of a group instance hold the distances
+ * to whole groups, there the bound is the cheapest star of shortest paths 
+ * from a vertex of the root group to the other groups.
+ */
+
+prune_t *prune_alloc(index_t n, index_t kt, index_t nt)
+{
+    prune_t *pr = (prune_t *) MALLOC(sizeof(prune_t));
+    pr->ub      = DIST_INF;
+    pr->kb      = kt;
+    pr->lb      = (dist_t *) MALLOC(n*kt*sizeof(dist_t));
+    pr->row_min = (dist_t *) MALLOC((1<<kt)*sizeof(dist_t));
+    pr->pruned  = (index_t *) MALLOC(3*nt*sizeof(index_t));
+    for(index_t X = 0; X < (1<<kt); X++)
+        pr->row_min[X] = 0;
+    for(index_t i = 0; i < 3*nt; i++)
+        pr->pruned[i] = 0;
+    return pr;
+}
+
+void prune_free(prune_t *pr)
+{
+    FREE(pr->lb);
+    FREE(pr->row_min);
+    FREE(pr->pruned);
+    FREE(pr);
+}
+
+static void prune_bound(index_t n, index_t k, index_t kt, index_t *kk,
+                        index_t *gpos, index_t *gv, dist_t *f_v, prune_t *pr)
+{
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t v = 0; v < n; v++)
+        for(index_t t = 0; t < kt; t++)
+            pr->lb[v*kt + t] = f_v[FV_INDEX(v, n, k, 1<<t)];
+
+    if(gpos != NULL)
+    {
+        index_t best = (index_t) DIST_INF;
+        for(index_t i = gpos[k-1]; i < gpos[k]; i++)
+        {
+            index_t star = 0;
+            for(index_t t = 0; t < k-1 && star < best; t++)
+                star += f_v[FV_INDEX(gv[i], n, k, 1<<t)];
+            best = MIN(best, star);
+        }
+        pr->ub = (best >= (index_t) DIST_INF) ? DIST_INF : (dist_t) best;
+        return;
+    }
+
+    dist_t D[MAX_K][MAX_K];
+    for(index_t i = 0; i < k; i++)
+        for(index_t j = 0; j < k; j++)
+            D[i][j] = (i < kt) ? f_v[FV_INDEX(kk[j], n, k, 1<<i)] :
+                      (j < kt) ? f_v[FV_INDEX(kk[i], n, k, 1<<j)] : 0;
+
+    // Prim over the k terminals
+    index_t in[MAX_K];
+    dist_t key[MAX_K];
+    for(index_t i = 0; i < k; i++)
+    {
+        in[i]  = 0;
+        key[i] = DIST_INF;
+    }
+    key[0] = 0;
+    index_t total = 0;
+    for(index_t r = 0; r < k; r++)
+    {
+        index_t u = UNDEFINED;
+        for(index_t i = 0; i < k; i++)
+            if(!in[i] && (u == UNDEFINED || key[i] < key[u]))
+                u = i;
+        if(key[u] == DIST_INF)
+        {
+            total = (index_t) DIST_INF; // terminals in different components
+            break;
+        }
+        in[u] = 1;
+        total += key[u];
+        for(index_t j = 0; j < k; j++)
+            if(!in[j])
+                key[j] = MIN(key[j], D[u][j]);
+    }
+    pr->ub = (total >= (index_t) DIST_INF) ? DIST_INF : (dist_t) total;
+}
+
+static void emv_bounds(index_t n, index_t m, index_t k, index_t kt, 
+                       index_t *kk, index_t *gpos, index_t *gv, dist_t *f_v,
+                       index_t *pos, adj_t *adj, prune_t *pr, anytime_t *at)
+{
+    // the singleton rows are done, the heuristic tree is built from them
+    // and tightens the pruning bound
+    if(at != NULL)
+    {
+        for(index_t t = 0; t < kt; t++)
+            at->done[1<<t] = 1;
+        push_time();
+        at->tree = heuristic_tree(n, m, k, kt, kk, gpos, gv, pos, adj, f_v);
+        at->tree_time = pop_time();
+        at->tree_cost = (at->tree != NULL) ? at->tree->cost : -1;
+    }
+    if(pr != NULL)
+    {
+        prune_bound(n, k, kt, kk, gpos, gv, f_v, pr);
+        if(at != NULL && at->tree != NULL && at->tree->cost < pr->ub)
+            pr->ub = (dist_t) at->tree->cost;
+    }
+}
+
+index_t emv_kernel(index_t n, 
+                    index_t m, 
+                    index_t k, 
+                    index_t kt, 
+                    index_t c, 
+                    index_t C, 
+                    index_t q, 
+                    index_t *kk, 
+                    index_t *gpos,
+                    index_t *gv,
+                    dist_t *f_v, 
+                    index_t *pos, 
+                    adj_t *adj, 
+                    dijkstra_ws_t **ws,
+                    delta_ws_t *dw,
+                    index_t nt,
+                    index_t tasks,
+                    double *busy,
+                    const int *ooc,
+                    ckpt_t *ck,
+                    prune_t *pr,
+                    metrics_t *mx,
+                    anytime_t *at
+#ifdef TRACK_OPTIMAL
+                    ,bptr_t *b_v 
+#endif
+#ifdef TRACK_BANDWIDTH
+                    ,index_t *heap_ops
+                    ,index_t *merge_ops
+                    ,index_t *sssp_ops
+#endif
+                    )
+{
+    if(tasks)
+    {
+        emv_tasks_t e;
+        e.n = n; e.m = m; e.k = k; e.kt = kt; e.kk = kk; e.f_v = f_v;
+        e.gpos = gpos; e.gv = gv;
+        e.pos = pos; e.adj = adj; e.ws = ws; e.busy = busy; e.ooc = ooc;
+        e.pr = pr; e.mx = mx; e.at = at;
+#ifdef TRACK_OPTIMAL
+        e.b_v = b_v;
+#endif
+#ifdef TRACK_BANDWIDTH
+        e.heap_ops = heap_ops; e.merge_ops = merge_ops; e.sssp_ops = sssp_ops;
+#endif
+        e.pending = (index_t *) MALLOC((1<<kt)*sizeof(index_t));
+        for(index_t X = 0; X < (1<<kt); X++)
+            e.pending[X] = __builtin_popcountl(X);
+
+        // the singletons are the roots, the rest is spawned as it gets ready,
+        // pruning and the heuristic tree need all singletons first
+        if(pr != NULL || at != NULL)
+        {
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+            for(index_t t = 0; t < kt; t++)
+            {
+#ifdef BUILD_PARALLEL
+                index_t th = omp_get_thread_num();
+#else
+                index_t th = 0;
+#endif
+                double time = omp_get_wtime();
+                emv_singleton(n, m, k, kk, gpos, gv, f_v, pos, adj, ws[th], 
+                              NULL, t, mx, th
+#ifdef TRACK_OPTIMAL
+                              ,b_v
+#endif
+#ifdef TRACK_BANDWIDTH
+                              ,heap_ops + th
+#endif
+                              );
+#ifdef TRACK_BANDWIDTH
+                sssp_ops[th]++;
+#endif
+                busy[th] += omp_get_wtime() - time;
+            }
+            emv_bounds(n, m, k, kt, kk, gpos, gv, f_v, pos, adj, pr, at);
+        }
+#ifdef BUILD_PARALLEL
+#pragma omp parallel
+#pragma omp single
+#endif
+        for(index_t t = 0; t < kt; t++)
+        {
+#ifdef BUILD_PARALLEL
+#pragma omp task firstprivate(t)
+#endif
+            {
+                if(pr != NULL || at != NULL)
+                    emv_release(&e, 1<<t);
+                else
+                    emv_task(&e, 1<<t);
+            }
+        }
+        FREE(e.pending);
+
+        q = group_root(kk, gpos, gv, k-1, f_v + FV_INDEX(0, n, k, C));
+        index_t i_q_C  = FV_INDEX(q, n, k, C);
+        return (index_t) f_v[i_q_C];
+    }
+
+    // initialisation: the table spans the first kt terminals, with kt = k-1
+    // the root q = kk[k-1] gets no singleton row
+    // a resumed checkpoint holds the levels up to ck->resumed
+    index_t first = (ck != NULL) ? ck->resumed + 1 : 1;
+    for(index_t X = 1; at != NULL && X < (1<<kt); X++)
+        at->done[X] = (__builtin_popcountl(X) < first);
+    if(first == 1)
+    {
+        double wall = omp_get_wtime();
+        // fewer rows than threads: one row at a time on all threads
+        delta_ws_t *dw_l = (dw != NULL && kt < nt) ? dw : NULL;
+        index_t nt_l = (dw_l != NULL) ? 1 : nt;
+        index_t block_size = kt/nt_l;
+        // block th on OpenMP thread th, as pin_threads and first_touch
+#ifdef BUILD_PARALLEL
+#pragma omp parallel num_threads(nt_l) if(nt_l > 1)
+#endif
+        for(index_t th = thread_id(); th < nt_l; 
+            th += omp_get_num_threads()) // one thread per core
+        {
+            index_t start = th*block_size;
+            index_t stop = (th == nt_l-1) ? kt-1 : (start+block_size-1);
+            dijkstra_ws_t *ws_th = ws[th];
+            double time = omp_get_wtime();
+#ifdef TRACK_BANDWIDTH
+            index_t *heap_ops_th = heap_ops + th;
+            sssp_ops[th] += stop-start+1;
+#endif
+
+            for(index_t t = start; t <= stop; t++) 
+            {    
+                emv_singleton(n, m, k, kk, gpos, gv, f_v, pos, adj, ws_th, 
+                              dw_l, t, mx, th
+#ifdef TRACK_OPTIMAL
+                              ,b_v
+#endif
+#ifdef TRACK_BANDWIDTH
+                              ,heap_ops_th
+#endif
+                              );
+            }    
+            busy[th] += omp_get_wtime() - time;
+        }
+        for(index_t th = nt_l; th < nt; th++)
+            busy[th] += omp_get_wtime() - wall;
+        if(mx != NULL)
+            mx->wall[1] = omp_get_wtime() - wall;
+        if(ck != NULL)
+            ckpt_level(ck, 1);
+    }
+    if(pr != NULL || at != NULL)
+        emv_bounds(n, m, k, kt, kk, gpos, gv, f_v, pos, adj, pr, at);
+
+    // the widest level is m = kt/2, one subset array serves all levels
+    index_t *X_a = (index_t *) MALLOC(choose(kt, kt/2) * sizeof(index_t));
+    for(index_t l = MAX(first, 2); l <= kt; l++) // kt-2
+    {    
+        index_t kCm = choose(kt, l);
+     
+        index_t i = 0; 
+        index_t z = 0;
+        for(index_t X = (1<<l)-1;
+            X < (1<<kt);
+            z = X|(X-1), X = (z+1)|(((~z & -~z)-1) >> (__builtin_ctz(X) + 1))) // cCm
+        {
+            X_a[i++] = X;
+        }
+
+        double wall = omp_get_wtime();
+        // levels with fewer subsets than threads, e.g. the top ones, run one
+        // subset at a time on all threads
+        delta_ws_t *dw_l = (dw != NULL && kCm < nt) ? dw : NULL;
+        index_t nt_l = (dw_l != NULL) ? 1 : nt;
+        index_t block_size = kCm/nt_l;
+        // block th on OpenMP thread th, as pin_threads and first_touch
+#ifdef BUILD_PARALLEL
+#pragma omp parallel num_threads(nt_l) if(nt_l > 1)
+#endif
+        for(index_t th = thread_id(); th < nt_l; 
+            th += omp_get_num_threads()) // one thread per core
+        {
+            index_t start = th*block_size;
+            index_t stop = (th == nt_l-1) ? kCm-1 : (start+block_size-1);
+            dijkstra_ws_t *ws_th = ws[th];
+            double time = omp_get_wtime();
+#ifdef TRACK_BANDWIDTH
+            index_t *heap_ops_th = heap_ops + th;
+            merge_ops[th] += (stop-start+1)*((1<<(l-1))-1);
+            sssp_ops[th]  += stop-start+1;
+#endif
+            for(index_t i = start; i <= stop; i++)
+            {
+                if(anytime_expired(at))
+                    break;
+                // out-of-core: read ahead the rows of the next subset
+                if(ooc && i == start)
+                    subset_rows(n, k, X_a[i], f_v, ooc, 0
+#ifdef TRACK_OPTIMAL
+                                ,b_v
+#endif
+                                );
+                if(ooc && i < stop)
+                    subset_rows(n, k, X_a[i+1], f_v, ooc, 0
+#ifdef TRACK_OPTIMAL
+                                ,b_v
+#endif
+                                );
+                emv_subset(n, m, k, kt, kk, gpos, gv, f_v, pos, adj, ws_th, 
+                           dw_l, X_a[i], pr, mx, th
+#ifdef TRACK_OPTIMAL
+                           ,b_v
+#endif
+#ifdef TRACK_BANDWIDTH
+                           ,heap_ops_th
+#endif
+                           );
+                if(ooc)
+                    subset_rows(n, k, X_a[i], f_v, ooc, 1
+#ifdef TRACK_OPTIMAL
+                                ,b_v
+#endif
+                                );
+                if(at != NULL)
+                    at->done[X_a[i]] = 1;
+            }
+            busy[th] += omp_get_wtime() - time;
+        }
+        for(index_t th = nt_l; th < nt; th++)
+            busy[th] += omp_get_wtime() - wall;
+        if(mx != NULL)
+            mx->wall[l] = omp_get_wtime() - wall;
+        if(at != NULL && at->stopped)
+            break; // an unfinished level is not checkpointed
+        if(ck != NULL)
+            ckpt_level(ck, l);
+    }
+    FREE(X_a);
+
+    //print_b_v(n, k, b_v);
+    // a group instance ends at the best vertex of the root group
+    q = group_root(kk, gpos, gv, k-1, f_v + FV_INDEX(0, n, k, C));
+    index_t i_q_C  = FV_INDEX(q, n, k, C);
+    return (index_t) f_v[i_q_C];
+}
+
+#ifdef LIST_OPTIMAL
+// lists a tree of the root query in input numbering, frees it
+void solution_list(steinerq_t *root, graph_t *g)
+{
+    if(root->perm != NULL)
+        graph_relabel(g, root->perm);
+    if(root->red != NULL)
+    {
+        graph_t *s = reduce_expand(root->red, g);
+        graph_free(g);
+        g = s;
+    }
+    list_solution(g);
+    graph_free(g);
+}
+#endif
+
+
+emv_ws_t *emv_ws_alloc(index_t n, index_t kt, index_t numa, 
+                       const char *ooc_dir)
+{
+    emv_ws_t *w = (emv_ws_t *) MALLOC(sizeof(emv_ws_t));
+    w->n  = n;
+    w->kt = kt;
+    w->nt = num_threads();
+    assert(w->nt < MAX_THREADS);
+    w->numa    = numa;
+    w->ooc_dir = ooc_dir;
+    w->page_legend = NULL;
+
+    w->f_size = n*(1<<kt)*sizeof(dist_t);
+    w->ooc_fd[0] = w->ooc_fd[1] = -1;
+    w->f_v = ooc_dir ? (dist_t *) table_map(ooc_dir, w->f_size, w->ooc_fd) :
+             numa    ? (dist_t *) table_alloc(w->f_size, &w->page_legend) :
+                       (dist_t *) MALLOC(w->f_size);
+#ifdef TRACK_OPTIMAL
+    w->b_size = n*(1<<kt)*sizeof(bptr_t);
+    w->b_v = ooc_dir ? (bptr_t *) table_map(ooc_dir, w->b_size, 
+                                            w->ooc_fd + 1) :
+             numa    ? (bptr_t *) table_alloc(w->b_size, &w->page_legend) :
+                       (bptr_t *) MALLOC(w->b_size);
+#endif
+
+    w->ws = (dijkstra_ws_t **) MALLOC(w->nt*sizeof(dijkstra_ws_t *));
+    for(index_t th = 0; th < w->nt; th++)
+        w->ws[th] = dijkstra_ws_alloc(n);
+    w->dw = (w->nt > 1 && n >= DELTA_MIN_N) ? delta_ws_alloc(n, w->nt) : NULL;
+    return w;
+}
+
+void emv_ws_free(emv_ws_t *w)
+{
+    for(index_t th = 0; th < w->nt; th++)
+        dijkstra_ws_free(w->ws[th]);
+    FREE(w->ws);
+    if(w->dw != NULL)
+        delta_ws_free(w->dw);
+    if(w->ooc_dir)
+    {
+        table_unmap(w->f_v, w->f_size, w->ooc_fd[0]);
+#ifdef TRACK_OPTIMAL
+        table_unmap(w->b_v, w->b_size, w->ooc_fd[1]);
+#endif
+    }
+    else if(w->numa)
+    {
+        table_free(w->f_v, w->f_size);
+#ifdef TRACK_OPTIMAL
+        table_free(w->b_v, w->b_size);
+#endif
+    }
+    else
+    {
+        FREE(w->f_v); 
+#ifdef TRACK_OPTIMAL
+        FREE(w->b_v);
+#endif
+    }
+    FREE(w);
+}
+
+void emv_opts_init(emv_opts_t *opt)
+{
+    opt->list_soln    = 0;
+    opt->nonroot      = 0;
+    opt->numa         = 0;
+    opt->tasks        = 0;
+    opt->ooc_dir      = NULL;
+    opt->ckpt_path    = NULL;
+    opt->prune        = 0;
+    opt->metrics_path = NULL;
+    opt->counters     = 0;
+    opt->timeout      = 0;
+}
+
+index_t erickson_monma_veinott(steinerq_t *root, const emv_opts_t *opt, 
+                               index_t *exact, emv_ws_t *w)
+{
+    index_t nonroot          = opt->nonroot;
+    index_t numa             = opt->numa;
+    index_t tasks            = opt->tasks;
+    const char *ooc_dir      = opt->ooc_dir;
+    const char *ckpt_path    = opt->ckpt_path;
+    index_t prune            = opt->prune;
+    const char *metrics_path = opt->metrics_path;
+    index_t counters         = opt->counters;
+    double timeout           = opt->timeout;
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    push_time();
+    double deadline = (timeout > 0) ? omp_get_wtime() + timeout : 0;
+    if(exact != NULL)
+        *exact = 1;
+
+    double time;
+    index_t n   = root->n;
+    index_t m   = root->m;
+    index_t k   = root->k;
+    index_t *kk = root->kk;
+    index_t min_cost = 0;
+    const char *page_legend = NULL;
+    double busy[MAX_THREADS]; // seconds spent on subsets per thread
+    double kernel_time = 0;
+    index_t busy_nt = 0;
+    ckpt_t *ck = NULL;
+    double ckpt_restore_time = 0;
+    index_t ckpt_resumed = 0;
+    double ckpt_write_time = 0;
+    prune_t *pr = NULL;
+    index_t pruned[3] = {0, 0, 0};
+    dist_t prune_ub = DIST_INF;
+    metrics_t *mx = NULL;
+    const char *mx_counters = "off";
+    anytime_t *at = NULL;
+    index_t at_level = 0;
+    index_t at_kt = 0;
+    index_t at_cost = -1;
+    index_t at_bound = 0;
+    index_t at_stopped = 0;
+    double heur_time = -1;
+    index_t heur_cost = -1;
+#ifdef TRACK_BANDWIDTH
+    double node_rate[MAX_NODES];
+    index_t total_heap_ops = 0;
+#endif
+
+#ifdef LIST_OPTIMAL
+    graph_t *g = NULL;
+#endif
+
+    if(k == 2)
+    {
+        index_t u   = kk[0];
+        index_t v   = kk[1];
+#ifdef RECOMPUTE_OPTIMAL
+        // d is row {u} of a two row table for the traceback
+        dist_t *d_v = (w != NULL) ? w->f_v :
+                                    (dist_t *) MALLOC(2*n*sizeof(dist_t));
+        dist_t *d   = d_v + n;
+#else
+        dist_t *d   = (w != NULL) ? w->f_v : 
+                                    (dist_t *) MALLOC(n*sizeof(dist_t));
+#endif
+        dijkstra_ws_t *ws = (w != NULL) ? w->ws[0] : dijkstra_ws_alloc(n);
+#ifdef TRACK_BANDWIDTH
+        index_t heap_ops = 0;
+#endif
+        // no table levels, the metrics hold the totals only
+        if(metrics_path != NULL)
+            mx = metrics_alloc(0, 1, 0);
+        fprintf(stdout, "erickson: ");
+        push_time();
+        if(root->gpos == NULL)
+        {
+            dijkstra(n, m, root->pos, root->adj, u, d, ws
+#ifdef TRACK_BANDWIDTH
+                    ,&heap_ops
+#endif
+                    );
+        }
+        else
+        {
+            // from all of group 0 to the nearest vertex of group 1
+            for(index_t x = 0; x < n; x++)
+                d[x] = DIST_INF;
+            for(index_t i = root->gpos[0]; i < root->gpos[1]; i++)
+                d[root->gv[i]] = 0;
+            dijkstra_multi(n, m, root->pos, root->adj, d, ws, NULL, 0, 0
+#ifdef TRACK_BANDWIDTH
+                           ,&heap_ops
+#endif
+                           );
+            u = UNDEFINED;
+            v = group_root(kk, root->gpos, root->gv, 1, d);
+        }
+        time = pop_time();
+        kernel_time = time;
+
+        // compute bandwidth
+        double trans_rate = 0;
+#ifdef TRACK_BANDWIDTH
+#ifdef TRACK_OPTIMAL
+        index_t mem_graph = 5*n+6*m;
+#else
+        index_t mem_graph = 4*n+6*m;
+#endif
+        index_t trans_bytes = mem_graph*sizeof(index_t) +
+                              heap_ops*sizeof(heap_node_t);
+        trans_rate = trans_bytes / (time / 1000.0);
+#endif
+        fprintf(stdout, "[kernel: %.2lf ms %.2lfGiB/s] ", 
+                        time, trans_rate / (1<<30));
+
+        min_cost = (index_t) d[v];
+#ifdef TRACK_OPTIMAL
+        if(opt->list_soln)
+            g = tracepath(n, u, v, ws->p);
+#endif
+#ifdef RECOMPUTE_OPTIMAL
+        if(opt->list_soln)
+            g = retrace_tree(n, m, k, kk, root->gpos, root->gv, root->pos, 
+                             root->adj, d_v);
+        if(w == NULL)
+            FREE(d_v);
+#else
+        if(w == NULL)
+            FREE(d);
+#endif
+        if(w == NULL)
+            dijkstra_ws_free(ws);
+    }
+    else
+    {
+        // subsets containing the root are never read back, with 'nonroot'
+        // the table only holds the subsets of the k-1 non-root terminals
+        index_t kt = nonroot ? k-1 : k;
+        emv_ws_t *own = NULL;
+        if(w == NULL)
+            w = own = emv_ws_alloc(n, kt, numa, ooc_dir);
+        assert(w->kt >= kt);
+        index_t nt = w->nt;
+        dist_t *f_v = w->f_v;
+        dijkstra_ws_t **ws = w->ws;
+        page_legend = w->page_legend;
+#ifdef TRACK_OPTIMAL
+        bptr_t *b_v = w->b_v;
 #endif
 
 #ifdef TRACK_BANDWIDTH
+        index_t *heap_ops  = (index_t *) MALLOC(nt*sizeof(index_t));
+        index_t *merge_ops = (index_t *) MALLOC(nt*sizeof(index_t));
+        index_t *sssp_ops  = (index_t *) MALLOC(nt*sizeof(index_t));
+        for(index_t th = 0; th < nt; th++)
+        {
+            heap_ops[th]  = 0;
+            merge_ops[th] = 0;
+            sssp_ops[th]  = 0;
+        }
+#endif
+
+        // initialisation
+        push_time();
+        if(numa && ooc_dir == NULL)
+        {
+            pin_threads(nt);
+            first_touch(n, k, kt, f_v, nt
+#ifdef TRACK_OPTIMAL
+                        ,b_v
+#endif
+                        );
+        }
+        else
+        {
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+            for(index_t i = 0; i < ((index_t)n*(1<<kt)); i++)
+                f_v[i] = DIST_INF;
+
+#ifdef TRACK_OPTIMAL
 #ifdef BUILD_PARALLEL
-        index_t *heap_ops = (index_t *) MALLOC(nt*sizeof(index_t));
+#pragma omp parallel for
+#endif
+            for(index_t i = 0; i < (index_t)(n*(1<<kt)); i++)
+                BV_SET(b_v[i], UNDEFINED, 0);
+#endif
+        }
+        time = pop_time();
+        fprintf(stdout, "erickson: [zero: %.2lf ms] ", time);
+
+        // restores the finished levels of an existing checkpoint
+        if(ckpt_path != NULL)
+        {
+            push_time();
+            ck = ckpt_open(ckpt_path, root, kt, f_v
+#ifdef TRACK_OPTIMAL
+                           ,b_v
+#endif
+                           );
+            ckpt_restore_time = pop_time();
+        }
+
+        index_t q = kk[k-1];
+        index_t c = k-1;
+        index_t C = (1<<c)-1;
+
+        if(prune)
+            pr = prune_alloc(n, kt, nt);
+        if(prune || timeout > 0)
+            at = anytime_alloc(kt, deadline);
+        if(metrics_path != NULL)
+            mx = metrics_alloc(kt, nt, counters);
+
+        // call kernel: do the hard work
+        push_time();
+        for(index_t th = 0; th < nt; th++)
+            busy[th] = 0;
+        busy_nt = nt;
+        min_cost = emv_kernel(n, m, k, kt, c, C, q, kk, root->gpos, root->gv,
+                              f_v, root->pos, root->adj, ws, w->dw, nt, tasks,
+                              busy, w->ooc_dir ? w->ooc_fd : NULL, ck, pr, mx, 
+                              at
+#ifdef TRACK_OPTIMAL
+                              ,b_v
+#endif
+#ifdef TRACK_BANDWIDTH
+                              ,heap_ops, merge_ops, sssp_ops
+#endif
+                              );
+        time = pop_time();
+        kernel_time = time;
+        if(at != NULL)
+        {
+            at_kt = kt;
+            at_level = kt+1;
+            at_stopped = at->stopped;
+            heur_time = at->tree_time;
+            heur_cost = at->tree_cost;
+            if(at->tree != NULL)
+                at_cost = at->tree->cost;
+            if(at->stopped)
+            {
+                // the best tree so far is the heuristic one, if any
+                at_bound = anytime_bound(at, n, k, kt, kk, root->gpos, 
+                                         root->gv, f_v, 
+                                         (pr != NULL) ? pr->ub : DIST_INF,
+                                         &at_level);
+                min_cost = at_cost;
+            }
+            else
+            {
+                at_cost  = min_cost;
+                at_bound = min_cost;
+            }
+        }
+        if(ck != NULL)
+        {
+            ckpt_resumed = ck->resumed;
+            ckpt_wait(ck);
+            ckpt_write_time = ck->write_time;
+            ckpt_close(ck);
+        }
+
+        if(pr != NULL)
+        {
+            for(index_t th = 0; th < nt; th++)
+                for(index_t i = 0; i < 3; i++)
+                    pruned[i] += pr->pruned[3*th+i];
+            prune_ub = pr->ub;
+            prune_free(pr);
+        }
+
+        double trans_rate = 0;
+        // bandwidth calculation
+#ifdef TRACK_BANDWIDTH
+        for(index_t th = 0; th < nt; th++)
+            total_heap_ops += heap_ops[th];
+#ifdef TRACK_OPTIMAL
+        index_t mem_graph = 5*n+6*m;
 #else
-        index_t *heap_ops = (index_t *) MALLOC(sizeof(index_t));
+        index_t mem_graph = 4*n+6*m;
+#endif
+
+        //mem: 3^{kt+1}/2*n + 2^kt*mem_graph*sizeof(index_t) + mem_heap*sizeof(heap_node_t)) 
+        // over the levels run here, a resumed checkpoint restored the rest
+        index_t rows_merge = 0;
+        index_t rows_sssp  = 0;
+        for(index_t l = ckpt_resumed+1; l <= kt; l++)
+        {
+            rows_merge += choose(kt, l)*3*(1L << (l-1));
+            rows_sssp  += choose(kt, l);
+        }
+        index_t trans_bytes = (rows_merge*n*sizeof(dist_t))+
+                              (rows_sssp*mem_graph*sizeof(index_t))+
+                              (total_heap_ops * sizeof(heap_node_t));
+        trans_rate   = trans_bytes / (time / 1000.0);
+
+        // per node traffic of the pinned threads, same terms per thread
+        if(numa)
+        {
+            for(index_t node = 0; node < num_nodes; node++)
+                node_rate[node] = 0;
+            for(index_t th = 0; th < nt; th++)
+            {
+                index_t th_bytes = (3*merge_ops[th]*n*sizeof(dist_t))+
+                                   (sssp_ops[th]*mem_graph*sizeof(index_t))+
+                                   (heap_ops[th]*sizeof(heap_node_t));
+                node_rate[thread_node[th]] += th_bytes / (time / 1000.0);
+            }
+        }
+#endif
+        fprintf(stdout, "[kernel: %.2lf ms %.2lfGiB/s] ",
+                        time, trans_rate/(1 << 30));
+
+        // build a Steiner tree, a group tree ends in the root group
+#ifdef LIST_OPTIMAL
+        if(at != NULL && at->stopped && opt->list_soln)
+        {
+            g = at->tree;
+            at->tree = NULL;
+        }
+#endif
+#ifdef TRACK_OPTIMAL
+        q = group_root(kk, root->gpos, root->gv, k-1, 
+                       f_v + FV_INDEX(0, n, k, C));
+        if(opt->list_soln && g == NULL)
+        {
+            push_time();
+            g = build_tree(n, k, kk, q, b_v);
+            time = pop_time();
+            fprintf(stdout, "[traceback: %.2lf ms] ", time);
+        }
+#endif
+#ifdef RECOMPUTE_OPTIMAL
+        if(opt->list_soln && g == NULL)
+        {
+            push_time();
+            g = retrace_tree(n, m, k, kk, root->gpos, root->gv, root->pos, 
+                             root->adj, f_v);
+            time = pop_time();
+            fprintf(stdout, "[traceback: %.2lf ms] ", time);
+        }
+#endif
+
+        if(at != NULL)
+        {
+            if(exact != NULL)
+                *exact = !at->stopped;
+            anytime_free(at);
+        }
+        if(own != NULL)
+            emv_ws_free(own);
+#ifdef TRACK_BANDWIDTH
+        FREE(heap_ops);
+        FREE(merge_ops);
+        FREE(sssp_ops);
+#endif
+    }
+
+    // forced edges of the reductions
+    if(root->red != NULL)
+    {
+        if(min_cost >= 0)
+            min_cost += root->red->fixed;
+        at_bound += root->red->fixed;
+        if(at_cost >= 0)
+            at_cost += root->red->fixed;
+        if(heur_cost >= 0)
+            heur_cost += root->red->fixed;
+    }
+
+    if(mx != NULL)
+    {
+        if(counters)
+            mx_counters = mx->hw ? "perf_event" : "unavailable";
+        metrics_write(mx, metrics_path, root, tasks, min_cost, kernel_time);
+        metrics_free(mx);
+    }
+
+    // a run stopped without a tree has no cost, and the tokens of the 
+    // heuristic and the stop go last to keep the fields before in place
+    time = pop_time();
+    if(min_cost >= 0)
+        fprintf(stdout, "done. [%.2lf ms] [cost: %ld] ", time, min_cost);
+    else
+        fprintf(stdout, "done. [%.2lf ms] [cost: none] ", time);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    if(heur_time >= 0)
+    {
+        if(heur_cost >= 0)
+            fprintf(stdout, " [heuristic: %.2lf ms cost %ld]", 
+                            heur_time, heur_cost);
+        else
+            fprintf(stdout, " [heuristic: %.2lf ms no tree]", heur_time);
+    }
+    if(at_stopped)
+        fprintf(stdout, " [exact: no] [bound: %ld]", at_bound);
+    fprintf(stdout, "\n");
+    if(page_legend != NULL)
+    {
+        fprintf(stdout, "numa: [pages: %s]", page_legend);
+#ifdef TRACK_BANDWIDTH
+        for(index_t node = 0; node < num_nodes; node++)
+            fprintf(stdout, " [node %ld: %.2lfGiB/s]", 
+                            node, node_rate[node]/(1 << 30));
 #endif
+        fprintf(stdout, "\n");
+    }
+    if(busy_nt > 0)
+    {
+        fprintf(stdout, "threads:");
+        for(index_t th = 0; th < busy_nt; th++)
+            fprintf(stdout, " [%ld: busy %.2lf ms idle %.2lf ms]", th,
+                            1000.0*busy[th], kernel_time - 1000.0*busy[th]);
+        fprintf(stdout, "\n");
+    }
+    if(metrics_path != NULL)
+        fprintf(stdout, "metrics: [file: %s] [counters: %s]\n", 
+                        metrics_path, mx_counters);
+    if(ckpt_path != NULL && busy_nt > 0)
+        fprintf(stdout, "checkpoint: [file: %s] [resumed level: %ld] "
+                        "[restore: %.2lf ms] [write: %.2lf ms]\n",
+                        ckpt_path, ckpt_resumed, ckpt_restore_time, 
+                        1000.0*ckpt_write_time);
+    if(prune && busy_nt > 0)
+    {
+        fprintf(stdout, "prune: [ub: %ld] [labels: %ld] [scans: %ld] "
+                        "[merges: %ld]", 
+                        (prune_ub == DIST_INF) ? -1L : (index_t) prune_ub,
+                        pruned[0], pruned[1], pruned[2]);
+#ifdef TRACK_BANDWIDTH
+        fprintf(stdout, " [heap ops: %ld]", total_heap_ops);
+#endif
+        fprintf(stdout, "\n");
+    }
+    if(timeout > 0 && busy_nt > 0)
+    {
+        fprintf(stdout, "anytime: [budget: %g s] ", timeout);
+        if(at_level <= at_kt)
+            fprintf(stdout, "[stopped: level %ld of %ld] ", at_level, at_kt);
+        else
+            fprintf(stdout, "[stopped: no] ");
+        if(at_cost >= 0)
+            fprintf(stdout, "[best: %ld] [bound: %ld] [gap: %.2lf%%]\n",
+                            at_cost, at_bound, 
+                            (at_cost > 0) ? 
+                            100.0*(at_cost - at_bound)/at_cost : 0.0);
+        else
+            fprintf(stdout, "[best: none] [bound: %ld]\n", at_bound);
+    }
+    fflush(stdout);
+
+    // list a solution
+#ifdef LIST_OPTIMAL
+    if(opt->list_soln)
+        solution_list(root, g);
+#endif
+    return min_cost;
+}
+
+/************************************************** Dijkstra-Steiner search. */
+/*
+ * Label-setting alternative to the full table, after
+ *    S. Hougardy, J. Silvanus, J. Vygen,
+ *    "Dijkstra meets Steiner: a fast exact goal-oriented Steiner tree 
+ *    algorithm", Mathematical Programming Computation 9 (2017).
+ *
+ * A label (v, X) over a subset X of the k-1 non-root terminals is the cost
+ * l(v, X) of a tree joining v and X. The labels live in a hash-based store
+ * and leave one global heap in the order of l(v, X) + L(v, X), where the
+ * future cost L(v, X) bounds the cost of joining v to the set J of the root
+ * q and the terminals outside X: the larger of the farthest distance from v
+ * into J and the 1-tree bound, half of the spanning tree weight of J plus 
+ * the two least distances from v into J. Both are consistent, so the keys 
+ * settle in non-decreasing order, a settled label is final and the search
+ * stops as soon as (q, C) is settled. A settled label extends over the arcs
+ * of v and merges with the settled labels at v over disjoint subsets. With
+ * the spanning tree weight of all terminals as an upper bound, labels whose
+ * key exceeds it are never stored. Only labels that are reached take 
+ * memory, the store doubles when it is full.
+ *
+ */
+
+typedef struct ds_store
+{
+    index_t n;
+    index_t k;
+    index_t cap;        // label slots
+    index_t num;        // labels in use
+    index_t *key;       // X*n + v
+    dist_t *l;          // cost of the best tree found for (v, X)
+    dist_t *f;          // heap key l + L
+    index_t *b;         // split (b[2j], b[2j+1]), arc from (b[2j], -1), or none 
+    index_t *next;      // settled labels at the same vertex
+    char *settled;
+    index_t hbits;
+    index_t *hash;      // open addressing, 2*cap (key, slot) pairs, slot -1 if free
+    index_t *head;      // first settled label at each vertex
+    index_t *degree;    // settled labels at each vertex
+    dist_t *lb;         // terminal distances, lb[v*k+t] = d(v, kk[t])
+    index_t *kk;
+    dist_t ub;          // labels with a larger key are never stored
+    index_t mbits;      // spanning tree weights of the sets J, by C & ~X
+    index_t mnum;
+    index_t *mkey;
+    dist_t *mval;
+    heap_t *h;
+#ifdef TRACK_BANDWIDTH
+    index_t heap_ops;
+#endif
+} ds_store_t;
+
+static inline index_t ds_slot(index_t key, index_t hbits)
+{
+    return (index_t) (((uint64_t) key * 0x9E3779B97F4A7C15UL) >> (64 - hbits));
+}
+
+// hash entry of a label key, or the free entry where it goes
+static inline index_t ds_probe(ds_store_t *s, index_t key)
+{
+    index_t mask = (1L << s->hbits) - 1;
+    index_t i = ds_slot(key, s->hbits);
+    while(s->hash[2*i+1] != -1 && s->hash[2*i] != key)
+        i = (i+1) & mask;
+    return i;
+}
+
+static void ds_rehash(ds_store_t *s)
+{
+    index_t size = 1L << s->hbits;
+    for(index_t i = 0; i < size; i++)
+        s->hash[2*i+1] = -1;
+    for(index_t j = 0; j < s->num; j++)
+    {
+        index_t i = ds_slot(s->key[j], s->hbits);
+        while(s->hash[2*i+1] != -1)
+            i = (i+1) & (size-1);
+        s->hash[2*i]   = s->key[j];
+        s->hash[2*i+1] = j;
+    }
+}
+
+static void ds_alloc_slots(ds_store_t *s, index_t cap)
+{
+    s->cap     = cap;
+    s->key     = (index_t *) MALLOC(cap*sizeof(index_t));
+    s->l       = (dist_t *) MALLOC(cap*sizeof(dist_t));
+    s->f       = (dist_t *) MALLOC(cap*sizeof(dist_t));
+    s->b       = (index_t *) MALLOC(2*cap*sizeof(index_t));
+    s->next    = (index_t *) MALLOC(cap*sizeof(index_t));
+    s->settled = (char *) MALLOC(cap*sizeof(char));
+    s->hash    = (index_t *) MALLOC(2*(1L << s->hbits)*sizeof(index_t));
+    s->h       = heap_alloc(cap);
+}
+
+static void ds_free_slots(ds_store_t *s)
+{
+#ifdef TRACK_BANDWIDTH
+    s->heap_ops += heap_mem(s->h);
+#endif
+    FREE(s->key);
+    FREE(s->l);
+    FREE(s->f);
+    FREE(s->b);
+    FREE(s->next);
+    FREE(s->settled);
+    FREE(s->hash);
+    heap_free(s->h);
+}
+
+ds_store_t *ds_alloc(index_t n, index_t k, index_t *kk, dist_t *lb)
+{
+    ds_store_t *s = (ds_store_t *) MALLOC(sizeof(ds_store_t));
+    s->n     = n;
+    s->k     = k;
+    s->num   = 0;
+    s->hbits = 1;
+    index_t cap = 1024;
+    while(cap < n)
+        cap *= 2;
+    while((1L << s->hbits) < 2*cap)
+        s->hbits++;
+    s->head   = (index_t *) MALLOC(n*sizeof(index_t));
+    s->degree = (index_t *) MALLOC(n*sizeof(index_t));
+    for(index_t v = 0; v < n; v++)
+    {
+        s->head[v]   = -1;
+        s->degree[v] = 0;
+    }
+    s->lb = lb;
+    s->kk = kk;
+    s->ub = DIST_INF;
+    s->mbits = 10;
+    s->mnum  = 0;
+    s->mkey  = (index_t *) MALLOC((1L << s->mbits)*sizeof(index_t));
+    s->mval  = (dist_t *) MALLOC((1L << s->mbits)*sizeof(dist_t));
+    for(index_t i = 0; i < (1L << s->mbits); i++)
+        s->mkey[i] = -1;
+#ifdef TRACK_BANDWIDTH
+    s->heap_ops = 0;
+#endif
+    ds_alloc_slots(s, cap);
+    ds_rehash(s);
+    return s;
+}
+
+void ds_free(ds_store_t *s)
+{
+    ds_free_slots(s);
+    FREE(s->head);
+    FREE(s->degree);
+    FREE(s->mkey);
+    FREE(s->mval);
+    FREE(s);
+}
+
+// doubles the store, the labels in the heap move to a new heap
+static void ds_grow(ds_store_t *s)
+{
+    ds_store_t t = *s;
+    s->hbits++;
+    ds_alloc_slots(s, 2*t.cap);
+    memcpy(s->key, t.key, t.num*sizeof(index_t));
+    memcpy(s->l, t.l, t.num*sizeof(dist_t));
+    memcpy(s->f, t.f, t.num*sizeof(dist_t));
+    memcpy(s->b, t.b, 2*t.num*sizeof(index_t));
+    memcpy(s->next, t.next, t.num*sizeof(index_t));
+    memcpy(s->settled, t.settled, t.num*sizeof(char));
+    for(index_t j = 0; j < t.num; j++)
+        if(!t.settled[j])
+            heap_insert(s->h, j, t.f[j]);
+    ds_rehash(s);
+    ds_free_slots(&t);
+#ifdef TRACK_BANDWIDTH
+    s->heap_ops = t.heap_ops; // including the old heap
+#endif
+}
+
+// weight of a spanning tree of the root and the terminals in M, memoised
+static dist_t ds_mst(ds_store_t *s, index_t M)
+{
+    index_t size = 1L << s->mbits;
+    index_t i = ds_slot(M, s->mbits);
+    while(s->mkey[i] != -1 && s->mkey[i] != M)
+        i = (i+1) & (size-1);
+    if(s->mkey[i] == M)
+        return s->mval[i];
+
+    // Prim over the terminal distance network
+    index_t k = s->k;
+    index_t nj = 0;
+    index_t jj[64];
+    index_t in[64];
+    dist_t key[64];
+    for(index_t N = M; N != 0; N &= N-1)
+        jj[nj++] = __builtin_ctzl(N);
+    jj[nj++] = k-1;
+    for(index_t a = 0; a < nj; a++)
+    {
+        in[a]  = 0;
+        key[a] = DIST_INF;
+    }
+    index_t total = 0;
+    index_t u = nj-1;
+    for(index_t r = 1; r < nj && total != -1; r++)
+    {
+        dist_t *lb_u = s->lb + s->kk[jj[u]]*k;
+        index_t w = UNDEFINED;
+        in[u] = 1;
+        for(index_t a = 0; a < nj; a++)
+        {
+            if(in[a])
+                continue;
+            key[a] = MIN(key[a], lb_u[jj[a]]);
+            if(w == UNDEFINED || key[a] < key[w])
+                w = a;
+        }
+        if(key[w] == DIST_INF)
+            total = -1; // terminals in different components
+        else
+            total += key[w];
+        u = w;
+    }
+    dist_t T = (total == -1 || total >= (index_t) DIST_INF) ? 
+               DIST_INF : (dist_t) total;
+
+    if(2*(s->mnum+1) > size)
+    {
+        // double the memo, move the entries
+        index_t *mkey = s->mkey;
+        dist_t *mval  = s->mval;
+        s->mbits++;
+        s->mkey = (index_t *) MALLOC(2*size*sizeof(index_t));
+        s->mval = (dist_t *) MALLOC(2*size*sizeof(dist_t));
+        for(index_t j = 0; j < 2*size; j++)
+            s->mkey[j] = -1;
+        for(index_t j = 0; j < size; j++)
+            if(mkey[j] != -1)
+            {
+                index_t h = ds_slot(mkey[j], s->mbits);
+                while(s->mkey[h] != -1)
+                    h = (h+1) & (2*size-1);
+                s->mkey[h] = mkey[j];
+                s->mval[h] = mval[j];
+            }
+        FREE(mkey);
+        FREE(mval);
+        size *= 2;
+        i = ds_slot(M, s->mbits);
+    }
+    while(s->mkey[i] != -1)
+        i = (i+1) & (size-1);
+    s->mkey[i] = M;
+    s->mval[i] = T;
+    s->mnum++;
+    return T;
+}
+
+// future cost of (v, X): M = C & ~X are the terminals still to reach
+static inline dist_t ds_future(ds_store_t *s, index_t v, index_t M)
+{
+    dist_t *lb_v = s->lb + v*s->k;
+    dist_t L = lb_v[s->k-1];
+    if(M == 0 || L == DIST_INF)
+        return L;
+
+    // farthest and two nearest of J
+    dist_t a = L;
+    dist_t b = DIST_INF;
+    for(index_t N = M; N != 0; N &= N-1)
+    {
+        dist_t d = lb_v[__builtin_ctzl(N)];
+        L = MAX(L, d);
+        if(d < a)
+        {
+            b = a;
+            a = d;
+        }
+        else if(d < b)
+        {
+            b = d;
+        }
+    }
+    if(L == DIST_INF)
+        return L;
+    index_t L1 = ((index_t) a + (index_t) b + (index_t) ds_mst(s, M)) / 2;
+    return (L1 > (index_t) L) ? (dist_t) MIN(L1, (index_t) DIST_INF) : L;
+}
+
+// offers a tree of cost c to (v, X), records its back-pointers if it wins
+static void ds_offer(ds_store_t *s, index_t v, index_t X, index_t M,
+                     dist_t c, index_t b0, index_t b1)
+{
+    if(s->num == s->cap)
+        ds_grow(s);
+
+    index_t i = ds_probe(s, X*s->n + v);
+    index_t j = s->hash[2*i+1];
+    if(j == -1)
+    {
+        dist_t L = ds_future(s, v, M);
+        if(L == DIST_INF || c > s->ub || L > s->ub - c)
+            return; // no tree within the bound extends (v, X)
+        j = s->num++;
+        s->hash[2*i]   = X*s->n + v;
+        s->hash[2*i+1] = j;
+        s->key[j]      = X*s->n + v;
+        s->l[j]        = c;
+        s->f[j]        = c + L;
+        s->b[2*j]      = b0;
+        s->b[2*j+1]    = b1;
+        s->settled[j]  = 0;
+        heap_insert(s->h, j, s->f[j]);
+    }
+    else if(!s->settled[j] && c < s->l[j])
+    {
+        s->f[j]     = c + (s->f[j] - s->l[j]);
+        s->l[j]     = c;
+        s->b[2*j]   = b0;
+        s->b[2*j+1] = b1;
+        heap_decrease_key(s->h, j, s->f[j]);
+    }
+}
+
+#ifdef LIST_OPTIMAL
+// tree of a settled label, iterative over an explicit stack
+graph_t *ds_backtrack(ds_store_t *s, index_t j)
+{
+    index_t n = s->n;
+    graph_t *g = graph_alloc();
+    g->n = n;
+
+    index_t top = 0;
+    index_t size = 64;
+    index_t *stack = enlarge(size, 0, (void *) 0);
+    stack[top++] = j;
+    while(top > 0)
+    {
+        j = stack[--top];
+        index_t b0 = s->b[2*j];
+        index_t b1 = s->b[2*j+1];
+        if(b0 == -1)
+            continue;
+        if(top + 2 > size)
+        {
+            stack = enlarge(2*size, size, stack);
+            size *= 2;
+        }
+        if(b1 != -1)
+        {
+            stack[top++] = b1;
+        }
+        else
+        {
+            graph_add_edge(g, s->key[b0] % n, s->key[j] % n, 
+                           (index_t) (s->l[j] - s->l[b0]));
+        }
+        stack[top++] = b0;
+    }
+    FREE(stack);
+    return g;
+}
+#endif
+
+index_t dijkstra_steiner(steinerq_t *root, index_t list_soln)
+{
+    if(root->gpos != NULL)
+        ERROR("group instances are solved by -el");
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    push_time();
+
+    index_t n   = root->n;
+    index_t m   = root->m;
+    index_t k   = root->k;
+    index_t *kk = root->kk;
+    index_t kt  = k-1;
+    index_t q   = kk[k-1];
+    index_t C   = (1L<<kt)-1;
+    index_t min_cost = 0;
+    index_t nt  = num_threads();
+    double time;
+#ifdef LIST_OPTIMAL
+    graph_t *g = NULL;
 #endif
+    if(k > 63 || (double) n * ldexp(1.0, kt) >= ldexp(1.0, 63))
+        ERROR("too many labels for 64-bit keys: n = %ld, k = %ld", n, k);
 
-        // initialisation
-        push_time();
-#ifdef BUILD_PARALLEL
-#pragma omp parallel for
-#endif
-        for(index_t i = 0; i < ((index_t)n*(1<<k)); i++)
-            f_v[i] = MATH_INF;
+    fprintf(stdout, "steiner: ");
+    index_t num_labels = 0;
+    index_t num_settled = 0;
+    dist_t ub = DIST_INF;
 
-#ifdef TRACK_OPTIMAL
+    // future costs from single-source runs at the terminals
+    push_time();
+    dist_t *d_t = (dist_t *) MALLOC(k*n*sizeof(dist_t));
+    dist_t *lb  = (dist_t *) MALLOC(k*n*sizeof(dist_t));
+    dijkstra_ws_t **ws = (dijkstra_ws_t **) MALLOC(nt*sizeof(dijkstra_ws_t *));
+    for(index_t th = 0; th < nt; th++)
+        ws[th] = dijkstra_ws_alloc(n);
+#ifdef TRACK_BANDWIDTH
+    index_t heap_ops = 0;
+#endif
 #ifdef BUILD_PARALLEL
 #pragma omp parallel for
 #endif
-        for(index_t i = 0; i < (index_t)(2*n*(1<<k)); i+=2)
+    for(index_t th = 0; th < nt; th++) // terminals round robin
+    {
+        for(index_t t = th; t < k; t += nt)
         {
-            b_v[i]   = -1;
-            b_v[i+1] = 0;
-        }
-#endif
-        time = pop_time();
-        fprintf(stdout, "erickson: [zero: %.2lf ms] ", time);
-
-        index_t q = kk[k-1];
-        index_t c = k-1;
-        index_t C = (1<<c)-1;
-
-        // call kernel: do the hard work
-        push_time();
-        min_cost = emv_kernel(n, m, k, c, C, q, kk, f_v, root->pos,
-                              root->adj, d, visit, nt
-#ifdef TRACK_OPTIMAL
-                              ,p
-                              ,b_v
+            dist_t *d = d_t + t*n;
+            for(index_t v = 0; v < n; v++)
+                d[v] = DIST_INF;
+            d[kk[t]] = 0;
+#ifdef TRACK_BANDWIDTH
+            index_t ops = 0;
 #endif
+            dijkstra_multi(n, m, root->pos, root->adj, d, ws[th], NULL, 0, 0
 #ifdef TRACK_BANDWIDTH
-                              ,heap_ops
+                           ,&ops
 #endif
-                              );
-        time = pop_time();
-
-        double trans_rate = 0;
-        // bandwidth calculation
+                           );
 #ifdef TRACK_BANDWIDTH
-        index_t total_heap_ops = 0;
-        for(index_t th = 0; th < nt; th++)
-            total_heap_ops += heap_ops[th];
-#ifdef TRACK_OPTIMAL
-        index_t mem_graph = 5*n+6*m;
-#else
-        index_t mem_graph = 4*n+6*m;
+#ifdef BUILD_PARALLEL
+#pragma omp atomic
 #endif
-
-        //mem: 3^{k+1}*n + 2^k*mem_graph*sizeof(index_t) + mem_heap*sizeof(heap_node_t)) 
-        index_t trans_bytes = (((index_t)(pow(3,k+1))*n)+((index_t)(pow(2,k)*mem_graph)) 
-                               *sizeof(index_t))+(total_heap_ops * sizeof(heap_node_t));
-        trans_rate   = trans_bytes / (time / 1000.0);
+            heap_ops += ops;
 #endif
-        fprintf(stdout, "[kernel: %.2lf ms %.2lfGiB/s] ",
-                        time, trans_rate/(1 << 30));
+        }
+    }
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t v = 0; v < n; v++)
+        for(index_t t = 0; t < k; t++)
+            lb[v*k+t] = d_t[t*n+v];
+    for(index_t th = 0; th < nt; th++)
+        dijkstra_ws_free(ws[th]);
+    FREE(ws);
+    FREE(d_t);
+    time = pop_time();
+    fprintf(stdout, "[bounds: %.2lf ms] ", time);
 
-        // build a Steiner tree
-#ifdef TRACK_OPTIMAL
+    push_time();
+    if(kt > 0)
+    {
+        ds_store_t *s = ds_alloc(n, k, kk, lb);
+        s->ub = ds_mst(s, C);
+        ub = s->ub;
+        for(index_t t = 0; t < kt; t++)
+            ds_offer(s, kk[t], 1L<<t, C & ~(1L<<t), 0, -1, -1);
+
+        index_t found = -1;
+        while(s->h->n > 0)
+        {
+            index_t j = heap_delete_min(s->h);
+            s->settled[j] = 1;
+            num_settled++;
+            index_t v = s->key[j] % n;
+            index_t X = s->key[j] / n;
+            dist_t l_j = s->l[j];
+            if(X == C && v == q)
+            {
+                found = j;
+                break;
+            }
+
+            // merge with the settled labels at v over disjoint subsets, 
+            // from the list at v or the subsets of C-X, whichever is shorter
+            index_t M = C & ~X;
+            if(s->degree[v] <= (1L << __builtin_popcountl(M)))
+            {
+                for(index_t i = s->head[v]; i != -1; i = s->next[i])
+                {
+                    index_t Y = s->key[i] / n;
+                    if((X & Y) == 0)
+                        ds_offer(s, v, X|Y, M & ~Y, l_j + s->l[i], j, i);
+                }
+            }
+            else
+            {
+                for(index_t Y = M; Y != 0; Y = (Y-1) & M)
+                {
+                    index_t i = s->hash[2*ds_probe(s, Y*n + v)+1];
+                    if(i != -1 && s->settled[i])
+                        ds_offer(s, v, X|Y, M & ~Y, l_j + s->l[i], j, i);
+                }
+            }
+            s->next[j] = s->head[v];
+            s->head[v] = j;
+            s->degree[v]++;
+
+            // extend over the arcs of v
+            index_t end_v = ARC_END(root->pos, root->adj, v);
+            for(index_t i = ARC_FIRST(root->pos, root->adj, v); 
+                i < end_v; i += ARC_STEP)
+            {
+                index_t u = ARC_HEAD(root->adj, m, i);
+                ds_offer(s, u, X, C & ~X, l_j + ARC_WEIGHT(root->adj, m, i),
+                         j, -1);
+            }
+        }
+        if(found == -1)
+            ERROR("terminals are not connected");
+        min_cost = (index_t) s->l[found];
+        num_labels = s->num;
+        time = pop_time();
+        fprintf(stdout, "[search: %.2lf ms] ", time);
+#ifdef LIST_OPTIMAL
         if(list_soln)
         {
             push_time();
-            g = build_tree(n, k, kk, b_v);
+            g = ds_backtrack(s, found);
             time = pop_time();
             fprintf(stdout, "[traceback: %.2lf ms] ", time);
         }
 #endif
-
-        FREE(d);
-        FREE(f_v); 
-        FREE(visit);
-#ifdef TRACK_OPTIMAL
-        FREE(p);
-        FREE(b_v);
-#endif
 #ifdef TRACK_BANDWIDTH
-        FREE(heap_ops);
+        index_t ops = heap_mem(s->h);
+        heap_ops += s->heap_ops + ops;
 #endif
+        ds_free(s);
+    }
+    else
+    {
+        time = pop_time();
+        fprintf(stdout, "[search: %.2lf ms] ", time);
     }
+    FREE(lb);
+
+    // forced edges of the reductions
+    if(root->red != NULL)
+        min_cost += root->red->fixed;
 
     time = pop_time();
     fprintf(stdout, "done. [%.2lf ms] [cost: %ld] ", time, min_cost);
@@ -2327,19 +7322,143 @@ index_t erickson_monma_veinott(steinerq_t *root, index_t list_soln)
     print_pop_memtrack();
     fprintf(stdout, " ");
     print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    fprintf(stdout, "labels: [ub: %ld] [stored: %ld] [settled: %ld] "
+                    "[table: %.3e]", (ub == DIST_INF) ? -1L : (index_t) ub,
+                    num_labels, num_settled, (double) n * ldexp(1.0, kt));
+#ifdef TRACK_BANDWIDTH
+    fprintf(stdout, " [heap ops: %ld]", heap_ops);
 #endif
     fprintf(stdout, "\n");
     fflush(stdout);
 
-    // list a solution
-#ifdef TRACK_OPTIMAL
-    if(list_soln)
+#ifdef LIST_OPTIMAL
+    if(list_soln && g != NULL)
+        solution_list(root, g);
+#endif
+    return min_cost;
+}
+
+/************************************************************** Input loader. */
+
+// the root query of a snapshot or an STP file, reduced and reordered
+steinerq_t *root_load(const char *filename, index_t bin_input, 
+                      index_t reduce, index_t order, index_t *min_cost)
+{
+    steinerq_t *root = NULL;
+    if(filename != NULL && snapshot_probe(filename))
+    {
+        // snapshots skip parsing and the root build
+        root = snapshot_load(filename, min_cost);
+    }
+    else if(filename == NULL && bin_input)
     {
-        list_solution(g);
+        root = snapshot_read(stdin, min_cost);
+    }
+    else
+    {
+        reduce_t *red = NULL;
+        graph_t *g = filename ? graph_load_mmap(filename) : graph_load(stdin);
+        *min_cost = g->cost;
+        if(reduce && g->group_pos != NULL)
+        {
+            // the tests of the reductions assume single vertex terminals
+            fprintf(stdout, "group instance, ignoring -reduce\n");
+            reduce = 0;
+        }
+        if(reduce)
+        {
+            graph_t *gr = graph_reduce(g, &red);
+            graph_free(g);
+            g = gr;
+        }
+        root = root_build(g);
+        root->red = red;
         graph_free(g);
     }
+    if(order != ORDER_NONE)
+        root_reorder(root, order);
+    return root;
+}
+
+/************************************************************** Calibration. */
+/*
+ * A short run of the two kernels for the autotuner of reader-auto, with 
+ * the heap, table width and graph layout of this build: Dijkstra from a few
+ * random sources, and merges of two of its rows into a third over all n 
+ * vertices, one thread. The line printed is parsed by reader-auto.c, keep 
+ * the two in sync.
+ */
+
+#define CALIBRATE_ROUNDS 3
+
+void calibrate(steinerq_t *root, index_t seed)
+{
+    index_t n = root->n;
+    index_t m = root->m;
+    index_t total = 0;
+    index_t w_max = 0;
+    for(index_t u = 0; u < n; u++)
+    {
+        for(index_t i = ARC_FIRST(root->pos, root->adj, u); 
+            i < ARC_END(root->pos, root->adj, u); i += ARC_STEP)
+        {
+            index_t w = ARC_WEIGHT(root->adj, m, i);
+            total += w;
+            w_max = MAX(w_max, w);
+        }
+    }
+    total /= 2;
+
+    dist_t *d = (dist_t *) MALLOC(3*n*sizeof(dist_t));
+    dijkstra_ws_t *ws = dijkstra_ws_alloc(n);
+#ifdef TRACK_BANDWIDTH
+    index_t heap_ops = 0;
 #endif
-    return min_cost;
+    srand(seed);
+    push_time();
+    for(index_t r = 0; r < CALIBRATE_ROUNDS; r++)
+        dijkstra(n, m, root->pos, root->adj, rand() % n, d, ws
+#ifdef TRACK_BANDWIDTH
+                 ,&heap_ops
+#endif
+                 );
+    double dijkstra_time = pop_time() / CALIBRATE_ROUNDS;
+
+    // the last distances and their reverse merge into an empty row
+    dist_t *f_X  = d + n;
+    dist_t *f_Xd = d + 2*n;
+    for(index_t v = 0; v < n; v++)
+        f_Xd[v] = d[n-1-v];
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_X = (bptr_t *) MALLOC(n*sizeof(bptr_t));
+#endif
+    double merge_time = 0;
+    for(index_t r = 0; r < CALIBRATE_ROUNDS; r++)
+    {
+        for(index_t v = 0; v < n; v++)
+            f_X[v] = DIST_INF;
+        push_time();
+        for(index_t v0 = 0; v0 < n; v0 += MERGE_TILE)
+            merge_rows(v0, MIN(v0 + MERGE_TILE, n), f_X, d, f_Xd
+#ifdef TRACK_OPTIMAL
+                       ,b_X, 1
+#endif
+                       );
+        merge_time += pop_time();
+    }
+    merge_time /= CALIBRATE_ROUNDS;
+#ifdef TRACK_OPTIMAL
+    FREE(b_X);
+#endif
+    FREE(d);
+    dijkstra_ws_free(ws);
+
+    fprintf(stdout, "calibrate: [n: %ld] [m: %ld] [k: %ld] [weight: %ld max "
+                    "%ld] [dijkstra: %.4lf ms] [merge: %.4lf ms]\n",
+                    n, m, root->k, total, w_max, dijkstra_time, merge_time);
+    fflush(stdout);
 }
 
 /******************************************************* Program entry point. */
@@ -2347,13 +7466,30 @@ index_t erickson_monma_veinott(steinerq_t *root, index_t list_soln)
 #define CMD_NOP                 0
 #define CMD_DIJKSTRA            1
 #define CMD_EDGE_LINEAR         2
+#define CMD_DIJKSTRA_STEINER    3
+#define CMD_CALIBRATE           4
 
 char *cmd_legend[] = { "no operation", 
                        "Dijkstra Single-Source-Shortest-Path", 
-                       "Erickson-Monma-Veinott"};
+                       "Erickson-Monma-Veinott",
+                       "Dijkstra-Steiner",
+                       "Calibration"};
 
 int main(int argc, char **argv)
 {
+#ifdef BUILD_MPI
+    // MPI calls come from the master thread only, rank 0 does the talking
+    int provided, rank, size;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    rank_id   = rank;
+    num_ranks = size;
+    if(provided < MPI_THREAD_FUNNELED)
+        ERROR("MPI library without MPI_THREAD_FUNNELED support");
+    if(rank_id != 0 && freopen("/dev/null", "w", stdout) == NULL)
+        ERROR("unable to silence the output of rank %ld", rank_id);
+#endif
     push_time();
 #ifdef TRACK_MEMORY
     push_memtrack();
@@ -2363,6 +7499,26 @@ int main(int argc, char **argv)
     index_t have_seed = 0;
     index_t arg_cmd = CMD_NOP;
     index_t list_soln = 0;
+    index_t nonroot = 0;
+    index_t numa = 0;
+    index_t tasks = 0;
+    char *ooc_dir = NULL;
+    char *ckpt_path = NULL;
+    char *dump_file = NULL;
+    index_t bin_input = 0;
+    index_t order = ORDER_NONE;
+    index_t reduce = 0;
+    index_t prune = 0;
+    index_t serve = 0;
+    index_t port = -1;
+    index_t maxk = 0;
+    char *batch_path = NULL;
+    char *batch_log = NULL;
+    char *metrics_path = NULL;
+    index_t counters = 0;
+    double timeout = 0;
+    index_t exact = 1;
+    reduce_t *red = NULL;
     index_t file_input = 0; 
     char *filename = NULL;
     for(index_t f = 1; f < argc; f++) 
@@ -2377,10 +7533,111 @@ int main(int argc, char **argv)
             {
                 arg_cmd = CMD_EDGE_LINEAR; 
             }
+            if(!strcmp(argv[f], "-ds") || !strcmp(argv[f], "-dijkstra-steiner"))
+            {
+                arg_cmd = CMD_DIJKSTRA_STEINER; 
+            }
+            if(!strcmp(argv[f], "-calibrate"))
+            {
+                arg_cmd = CMD_CALIBRATE; 
+            }
             if(!strcmp(argv[f], "-list"))
             {
                 list_soln = 1;
             }
+            if(!strcmp(argv[f], "-nonroot"))
+            {
+                nonroot = 1;
+            }
+            if(!strcmp(argv[f], "-numa"))
+            {
+                numa = 1;
+            }
+            if(!strcmp(argv[f], "-tasks"))
+            {
+                tasks = 1;
+            }
+            if(!strcmp(argv[f], "-ooc")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("out-of-core directory missing from command line");
+                ooc_dir = argv[++f];
+            }
+            if(!strcmp(argv[f], "-dump")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("snapshot file missing from command line");
+                dump_file = argv[++f];
+            }
+            if(!strcmp(argv[f], "-bin"))
+            {
+                bin_input = 1;
+            }
+            if(!strcmp(argv[f], "-prune"))
+            {
+                prune = 1;
+            }
+            if(!strcmp(argv[f], "-serve"))
+            {
+                serve = 1;
+            }
+            if(!strcmp(argv[f], "-port")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("port missing from command line");
+                port = atol(argv[++f]);
+                serve = 1;
+            }
+            if(!strcmp(argv[f], "-maxk")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("terminal count missing from command line");
+                maxk = atol(argv[++f]);
+            }
+            if(!strcmp(argv[f], "-batch")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("batch directory or manifest missing from command line");
+                batch_path = argv[++f];
+            }
+            if(!strcmp(argv[f], "-batchlog")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("batch log directory missing from command line");
+                batch_log = argv[++f];
+            }
+            if(!strcmp(argv[f], "-metrics")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("metrics file missing from command line");
+                metrics_path = argv[++f];
+            }
+            if(!strcmp(argv[f], "-counters"))
+            {
+                counters = 1;
+            }
+            if(!strcmp(argv[f], "-timeout") || !strcmp(argv[f], "-budget")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("time budget missing from command line");
+                timeout = atof(argv[++f]);
+            }
+            if(!strcmp(argv[f], "-reduce"))
+            {
+                reduce = 1;
+            }
+            if(!strcmp(argv[f], "-reorder")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("vertex order missing from command line");
+                order = order_parse(argv[++f]);
+            }
+            if(!strcmp(argv[f], "-checkpoint")) 
+            {
+                if(f == argc - 1) 
+                    ERROR("checkpoint file missing from command line");
+                ckpt_path = argv[++f];
+            }
             if(!strcmp(argv[f], "-in")) 
             {
                 if(f == argc - 1) 
@@ -2403,9 +7660,33 @@ int main(int argc, char **argv)
                         "\t-seed : seed value\n"
                         "\t-el : Erickson-Monma-Veinott algorithm\n"
                         "\t-dijkstra : Dijkstra single source shortest path\n"
+                        "\t-ds : Dijkstra-Steiner label-setting search, sparse labels\n"
+                        "\t-calibrate : Time the kernels of this build on the input graph\n"
                         "\t-list : Output Steiner tree\n"
+                        "\t-nonroot : DP table over non-root terminal subsets\n"
+                        "\t-numa : Huge page DP table placed by first touch, pinned threads\n"
+                        "\t-tasks : Schedule subsets as dependency-driven tasks\n"
+                        "\t-ooc <dir> : Out-of-core DP table in a scratch file under dir\n"
+                        "\t-checkpoint <file> : Save finished levels to file, resume from it\n"
+                        "\t-dump <file> : Write a binary snapshot of the input graph\n"
+                        "\t-bin : Read a binary snapshot from stdin\n"
+                        "\t-prune : Cut Dijkstra and merges at a heuristic upper bound\n"
+                        "\t-reduce : Shrink the input graph with Steiner reductions\n"
+                        "\t-reorder <bfs|rcm|degree> : Renumber the vertices for locality\n"
+                        "\t-serve : Solve the terminal sets read from stdin, one per line\n"
+                        "\t-port <port> : Serve terminal sets on a loopback TCP port\n"
+                        "\t-maxk <k> : Size the server tables for k terminals up front\n"
+                        "\t-batch <dir|manifest> : Solve many instances side by side\n"
+                        "\t-batchlog <dir> : Keep the log of every batch instance in dir\n"
+                        "\t-metrics <file> : Write per level metrics as JSON, or CSV for *.csv\n"
+                        "\t-counters : Add perf_event hardware counters to the metrics\n"
+                        "\t-timeout <s> : Stop -el after s seconds with the best tree so far\n"
+                        "\t-budget <s> : Same as -timeout\n"
                         "\n",
                         argv[0]);
+#ifdef BUILD_MPI
+                MPI_Finalize();
+#endif
                 return 0;
             }
         }
@@ -2416,14 +7697,7 @@ int main(int argc, char **argv)
         fprintf(stdout, " %s", argv[f]);
     fprintf(stdout, "\n");
 
-    FILE *in = stdin;
-    if(file_input)
-    {
-        in = fopen(filename, "r");
-        if(in == NULL)
-            ERROR("unable to open file '%s'", filename);
-    }
-    else
+    if(!file_input && batch_path == NULL)
     {
         fprintf(stdout, 
                 "no input file specified, defaulting to stdin\n");
@@ -2436,19 +7710,167 @@ int main(int argc, char **argv)
     }    
     fprintf(stdout, "random seed = %ld\n", seed);
 
-    
-    graph_t *g = graph_load(in);
-    steinerq_t *root = root_build(g);
-    index_t min_cost  = g->cost;
-    graph_free(g);
+#ifdef BUILD_MPI
+    // the ranks split one table, held in memory
+    if(serve || batch_path != NULL || numa || tasks || ooc_dir != NULL || 
+       ckpt_path != NULL || prune || metrics_path != NULL || counters ||
+       timeout > 0)
+    {
+        fprintf(stdout, "distributed run, ignoring -serve, -batch, -numa, "
+                        "-tasks, -ooc, -checkpoint, -prune, -metrics and "
+                        "-timeout\n");
+        serve = 0;
+        timeout = 0;
+        counters = 0;
+        metrics_path = NULL;
+        batch_path = NULL;
+        numa  = 0;
+        tasks = 0;
+        prune = 0;
+        ooc_dir   = NULL;
+        ckpt_path = NULL;
+    }
+#endif
+
+#ifdef BUILD_OFFLOAD
+    // -el runs on the device, the query server and batches stay on the host
+    if(arg_cmd == CMD_EDGE_LINEAR && !serve && batch_path == NULL &&
+       (numa || tasks || ooc_dir != NULL || ckpt_path != NULL || prune ||
+        metrics_path != NULL || counters || timeout > 0))
+    {
+        fprintf(stdout, "offload run, ignoring -numa, -tasks, -ooc, "
+                        "-checkpoint, -prune, -metrics and -timeout\n");
+        counters = 0;
+        timeout = 0;
+        metrics_path = NULL;
+        numa  = 0;
+        tasks = 0;
+        prune = 0;
+        ooc_dir   = NULL;
+        ckpt_path = NULL;
+    }
+#endif
+
+    if(batch_path != NULL)
+    {
+        // instances share the machine, not the tables
+        if(serve || numa || ooc_dir != NULL || ckpt_path != NULL || 
+           dump_file != NULL || timeout > 0)
+        {
+            fprintf(stdout, "batch run, ignoring -serve, -numa, -ooc, "
+                            "-checkpoint, -dump and -timeout\n");
+            serve = 0;
+            timeout = 0;
+            numa  = 0;
+            ooc_dir   = NULL;
+            ckpt_path = NULL;
+            dump_file = NULL;
+        }
+    }
+
+    if(serve)
+    {
+        if(arg_cmd != CMD_EDGE_LINEAR && arg_cmd != CMD_DIJKSTRA_STEINER)
+            ERROR("serving queries needs -el or -ds");
+        if(port == -1 && !file_input)
+            ERROR("queries are read from stdin, the graph needs -in");
+        if(port != -1 && (port < 1 || port > 65535))
+            ERROR("invalid port %ld", port);
+        // the reductions and the checkpoint are for one terminal set
+        if(reduce)
+        {
+            fprintf(stdout, "serving queries, ignoring -reduce\n");
+            reduce = 0;
+        }
+        if(ckpt_path != NULL)
+        {
+            fprintf(stdout, "serving queries, ignoring -checkpoint\n");
+            ckpt_path = NULL;
+        }
+        if(timeout > 0)
+        {
+            fprintf(stdout, "serving queries, ignoring -timeout\n");
+            timeout = 0;
+        }
+    }
+
+    if(ckpt_path != NULL && tasks)
+    {
+        // checkpoints are cut at the level barriers
+        fprintf(stdout, "checkpointing runs level by level, ignoring -tasks\n");
+        tasks = 0;
+    }
+
+    emv_opts_t opts;
+    emv_opts_init(&opts);
+    opts.list_soln    = list_soln;
+    opts.nonroot      = nonroot;
+    opts.numa         = numa;
+    opts.tasks        = tasks;
+    opts.ooc_dir      = ooc_dir;
+    opts.ckpt_path    = ckpt_path;
+    opts.prune        = prune;
+    opts.metrics_path = metrics_path;
+    opts.counters     = counters;
+    opts.timeout      = timeout;
+
+    if(batch_path != NULL)
+    {
+        // every instance is loaded and solved in a child of its own
+        if(arg_cmd != CMD_EDGE_LINEAR && arg_cmd != CMD_DIJKSTRA_STEINER)
+            ERROR("batch runs need -el or -ds");
+        fprintf(stdout, "command: %s\n", cmd_legend[arg_cmd]);
+        push_time();
+        batch_run(batch_path, batch_log, arg_cmd == CMD_DIJKSTRA_STEINER,
+                  &opts, reduce, order);
+        arg_cmd = CMD_NOP;
+    }
+
+    steinerq_t *root = NULL;
+    index_t min_cost = -1;
+    if(batch_path == NULL)
+    {
+        root = root_load(file_input ? filename : NULL, bin_input, reduce, 
+                         order, &min_cost);
+        red = root->red;
+    }
+    if(dump_file != NULL && root != NULL && root->gpos != NULL)
+    {
+        fprintf(stdout, "group instance, ignoring -dump\n");
+        dump_file = NULL;
+    }
+    if(dump_file != NULL && root != NULL && rank_id == 0)
+        snapshot_dump(dump_file, root, (red == NULL || min_cost == -1) ? 
+                                       min_cost : min_cost - red->fixed);
 
-    fprintf(stdout, "command: %s\n", cmd_legend[arg_cmd]);
+    if(batch_path == NULL)
+    {
+        fprintf(stdout, "command: %s\n", cmd_legend[arg_cmd]);
+        push_time();
+    }
     fflush(stdout);
-    push_time();
-    switch(arg_cmd)
+    if(serve)
+    {
+        // the graph stays, the terminal sets come and go
+        push_time();
+        query_server_t *qs = query_server_alloc(root, 
+                                                arg_cmd == CMD_DIJKSTRA_STEINER,
+                                                &opts, maxk);
+        if(port != -1)
+            query_listen(qs, port);
+        else
+            query_serve(qs, stdin, stdout);
+        double time = pop_time();
+        fprintf(stdout, "server: [queries: %ld] [errors: %ld] done. "
+                        "[%.2lf ms]\n", 
+                        qs->num_queries, qs->num_errors, time);
+        query_server_free(qs);
+    }
+    switch(serve ? CMD_NOP : arg_cmd)
     {
         case CMD_NOP:
-            steinerq_free(root);
+            if(root != NULL)
+                steinerq_free(root);
             break;
 
         case CMD_DIJKSTRA:
@@ -2457,35 +7879,51 @@ int main(int argc, char **argv)
                 index_t n = root->n;
                 index_t m = root->m;
                 index_t s = rand() % n; // source vertex
-                index_t *d = (index_t *) MALLOC(n*sizeof(index_t));
-                index_t *visit = (index_t *) MALLOC(n*sizeof(index_t));
-#ifdef TRACK_OPTIMAL
-                index_t *p = (index_t *) MALLOC(n*sizeof(index_t));
-#endif
+                dist_t *d = (dist_t *) MALLOC(n*sizeof(dist_t));
+                dijkstra_ws_t *ws = dijkstra_ws_alloc(n);
 #ifdef TRACK_BANDWIDTH
                 index_t trans_rate = 0;
 #endif
 
-                dijkstra(n, m, root->pos, root->adj, s, d, visit
-#ifdef TRACK_OPTIMAL
-                         ,p
-#endif
+                dijkstra(n, m, root->pos, root->adj, s, d, ws
 #ifdef TRACK_BANDWIDTH
                          ,&trans_rate
 #endif
                         );
                 FREE(d);
-                FREE(visit);
-#ifdef TRACK_OPTIMAL
-                FREE(p);
-#endif
+                dijkstra_ws_free(ws);
                 steinerq_free(root);
             }
             break;
 
         case CMD_EDGE_LINEAR:
             {
-                index_t cost = erickson_monma_veinott(root, list_soln);
+#if defined(BUILD_MPI)
+                index_t cost = emv_distributed(root, &opts);
+#elif defined(BUILD_OFFLOAD)
+                index_t cost = emv_offload(root, &opts);
+#else
+                index_t cost = erickson_monma_veinott(root, &opts, &exact, 
+                                                      NULL);
+#endif
+                // a stopped anytime run reports a tree, not the optimum
+                if(exact && min_cost != -1 && min_cost != cost)
+                    ERROR("min_cost != cost: minimum cost = %ld, cost = %ld", 
+                           min_cost, cost);
+                steinerq_free(root);
+            }
+            break;
+
+        case CMD_CALIBRATE:
+            {
+                calibrate(root, seed);
+                steinerq_free(root);
+            }
+            break;
+
+        case CMD_DIJKSTRA_STEINER:
+            {
+                index_t cost = dijkstra_steiner(root, list_soln);
                 if(min_cost != -1 && min_cost != cost)
                     ERROR("min_cost != cost: minimum cost = %ld, cost = %ld", 
                            min_cost, cost);
@@ -2497,6 +7935,9 @@ int main(int argc, char **argv)
             break;
     }
 
+    if(red != NULL)
+        reduce_free(red);
+
     double time = pop_time();
     fprintf(stdout, "command done [%.2lf ms]\n", time);
     time = pop_time();
@@ -2515,12 +7956,33 @@ int main(int argc, char **argv)
 #endif
 #ifdef FIB_HEAP
                     ,"Fibonacci heap"
+#elif defined(RADIX_HEAP)
+                    ,"radix heap"
 #else
                     ,"binary heap"
 #endif
             );
     fprintf(stdout, "list solution: %s\n", (list_soln ? "true":"false"));
+    fprintf(stdout, "non-root table: %s\n", (nonroot ? "true":"false"));
+    fprintf(stdout, "numa placement: %s\n", (numa ? "true":"false"));
+    fprintf(stdout, "task scheduling: %s\n", (tasks ? "true":"false"));
+    fprintf(stdout, "out-of-core table: %s\n", (ooc_dir ? ooc_dir:"false"));
+    fprintf(stdout, "checkpoint file: %s\n", (ckpt_path ? ckpt_path:"false"));
+    fprintf(stdout, "table width: %d-bit\n", (int) (8*sizeof(dist_t)));
+    fprintf(stdout, "adjacency: %d-bit %s\n", (int) (8*sizeof(adj_t)),
+                    (8*sizeof(adj_t) == 32) ? "compact" : "interleaved");
+    fprintf(stdout, "vertex order: %s\n", order_legend[order]);
+    fprintf(stdout, "reductions: %s\n", (reduce ? "true":"false"));
+    fprintf(stdout, "pruning: %s\n", (prune ? "true":"false"));
+    if(timeout > 0)
+        fprintf(stdout, "time budget: %g s\n", timeout);
+    else
+        fprintf(stdout, "time budget: false\n");
+    fprintf(stdout, "batch input: %s\n", (batch_path ? batch_path:"false"));
+    fprintf(stdout, "query server: %s\n", 
+                    !serve ? "false" : (port != -1) ? "port" : "stdin");
     fprintf(stdout, "num threads: %ld\n", num_threads());
+    fprintf(stdout, "mpi ranks: %ld\n", num_ranks);
     fprintf(stdout, 
             "compiler: gcc %d.%d.%d\n",
             __GNUC__,
@@ -2531,6 +7993,9 @@ int main(int argc, char **argv)
 #ifdef TRACK_MEMORY
     assert(malloc_balance == 0);
     assert(memtrack_stack_top < 0);
+#endif
+#ifdef BUILD_MPI
+    MPI_Finalize();
 #endif
     return 0;
 }
@@ -0,0 +1,557 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work 
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+/*
+ * Declarations shared by the sources of reader-el: the configuration of a
+ * build, the graph, root query and table layouts, and the solvers. The
+ * solvers are in reader-el.c, the distributed and accelerator drivers, the
+ * query server and the batch runner around them in reader-mpi.c, 
+ * reader-offload.c, reader-serve.c and reader-batch.c.
+ *
+ */
+
+#ifndef READER_EL_H
+#define READER_EL_H
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdarg.h>
+#include<assert.h>
+#include<ctype.h>
+#include<stdint.h>
+#include<omp.h>
+#ifdef BUILD_MPI
+#include<mpi.h>
+#endif
+
+/************************************************************* Configuration. */
+#ifdef DEFAULT
+#define BIN_HEAP
+#define TRACK_OPTIMAL
+#define BUILD_PARALLEL
+#endif
+
+#ifdef TRACK_RESOURCES
+#define TRACK_MEMORY
+#define TRACK_BANDWIDTH
+#endif
+
+#if defined(TRACK_OPTIMAL) && defined(RECOMPUTE_OPTIMAL)
+#error "TRACK_OPTIMAL and RECOMPUTE_OPTIMAL are exclusive"
+#endif
+
+#if defined(BUILD_MPI) && defined(RECOMPUTE_OPTIMAL)
+#error "RECOMPUTE_OPTIMAL retraces over the whole table, not with BUILD_MPI"
+#endif
+
+#if defined(BUILD_OFFLOAD) && defined(RECOMPUTE_OPTIMAL)
+#error "RECOMPUTE_OPTIMAL retraces over the whole table, not with BUILD_OFFLOAD"
+#endif
+
+#if defined(BUILD_MPI) && defined(BUILD_OFFLOAD)
+#error "BUILD_MPI and BUILD_OFFLOAD are exclusive"
+#endif
+
+#if defined(TRACK_OPTIMAL) || defined(RECOMPUTE_OPTIMAL)
+#define LIST_OPTIMAL // Steiner tree output available
+#endif
+
+#define MAX_K        32 
+#define MAX_THREADS 128
+#define MAX_NODES    64
+
+typedef long int index_t; // default to 64-bit indexing
+
+// storage of the dynamic programming table, 32-bit labels with NARROW_TABLE
+#ifdef NARROW_TABLE
+typedef uint32_t dist_t;
+typedef uint32_t bvid_t;
+#else
+typedef index_t dist_t;
+typedef index_t bvid_t;
+#endif
+
+// adjacency storage, 32-bit neighbour and weight arrays with COMPACT_GRAPH
+#ifdef COMPACT_GRAPH
+typedef uint32_t adj_t;
+#else
+typedef index_t adj_t;
+#endif
+
+/********************************************************** Global constants. */
+
+#define MAX_DISTANCE ((index_t)0x7FFFFFFFFFFFFFFF)
+#define MATH_INF ((index_t)0x7FFFFFFFFFFFFFFF)
+#ifdef NARROW_TABLE
+#define DIST_INF ((dist_t)0xFFFFFFFF) // saturates, sums never wrap
+#else
+#define DIST_INF ((dist_t)(MAX_DISTANCE >> 2)) // sums of two never wrap
+#endif
+#define UNDEFINED -1
+
+/************************************************************* Common macros. */
+
+#define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+#define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
+
+// Linked list navigation macros. 
+
+#define pnlinknext(to,el) { (el)->next = (to)->next; (el)->prev = (to); (to)->next->prev = (el); (to)->next = (el); }
+#define pnlinkprev(to,el) { (el)->prev = (to)->prev; (el)->next = (to); (to)->prev->next = (el); (to)->prev = (el); }
+#define pnunlink(el) { (el)->next->prev = (el)->prev; (el)->prev->next = (el)->next; }
+#define pnrelink(el) { (el)->next->prev = (el); (el)->prev->next = (el); }
+
+
+/*********************************************************** Error reporting. */
+
+#define ERROR(...) error(__FILE__,__LINE__,__func__,__VA_ARGS__);
+void error(const char *fn, int line, const char *func, 
+           const char *format, ...);
+
+/********************************************************* Available threads. */
+
+index_t num_threads(void);
+index_t thread_id(void);
+
+// processes of a distributed run, set up in main with BUILD_MPI
+extern index_t num_ranks;
+extern index_t rank_id;
+
+/************************************************************** Combinations. */
+
+index_t choose(index_t n, index_t r);
+
+/********************************************** Memory allocation & tracking. */
+
+#ifdef TRACK_MEMORY
+#define MALLOC(x) malloc_wrapper(x)
+#define CALLOC(x, y) calloc_wrapper((x), (y))
+#define FREE(x) free_wrapper(x)
+
+#else
+
+#define MALLOC(x) malloc((x))
+#define CALLOC(x, y) calloc((x), (y))
+#define FREE(x) free((x))
+
+#endif
+
+#ifdef TRACK_MEMORY
+void *malloc_wrapper(size_t size);
+void *calloc_wrapper(size_t n, size_t size);
+void free_wrapper(void *p);
+void push_memtrack(void);
+size_t pop_memtrack(void);
+double inGiB(size_t s);
+void print_current_mem(void);
+void print_pop_memtrack(void);
+#endif
+
+/******************************************************** Timing subroutines. */
+
+void push_time(void);
+double pop_time(void);
+
+/*************************************************** Graph build subroutines. */
+
+#define GRAPH_SEC_COMMENT         0x01
+#define GRAPH_SEC_GRAPH           0x02
+#define GRAPH_SEC_TERMINALS       0x04
+#define GRAPH_SEC_COORDINATES     0x08
+#define GRAPH_EDGES_ALLOC         0x10
+#define GRAPH_TERMINALS_ALLOC     0x20
+#define GRAPH_COORDINATES_ALLOC   0x40
+#define GRAPH_STEINER_COST        0x80
+#define GRAPH_SEC_GROUPS          0x100
+#define GRAPH_GROUPS_ALLOC        0x200
+
+typedef struct graph
+{
+    index_t root;
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t num_edges;
+    index_t num_terminals;
+    index_t num_coordinates;
+    index_t *edges;
+    index_t *terminals;
+    index_t *coordinates;
+    index_t flags;
+    index_t cost;
+    index_t edge_capacity;
+    index_t num_members;
+    index_t member_capacity;
+    index_t *group_pos;     // group t is group_members[group_pos[t]..]
+    index_t *group_members; // up to group_members[group_pos[t+1]-1]
+} graph_t;
+
+graph_t *graph_alloc();
+void graph_free(graph_t *g);
+void graph_add_edge(graph_t *g, index_t u, index_t v, index_t w);
+
+#define MAX_LINE_SIZE 1024
+
+// in place parsing of the lines of an STP file, between p and end
+static inline const char *stp_blank(const char *p, const char *end)
+{
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+        p++;
+    return p;
+}
+
+static inline index_t stp_keyword(const char *p, const char *end, 
+                                  const char *kw)
+{
+    // kw in lower case, followed by a blank or the end of the line
+    for(; *kw != '\0'; p++, kw++)
+        if(p == end || tolower((unsigned char) *p) != *kw)
+            return 0;
+    return p == end || *p == ' ' || *p == '\t' || *p == '\r';
+}
+
+static inline const char *stp_int(const char *p, const char *end, 
+                                  index_t *x)
+{
+    p = stp_blank(p, end);
+    index_t neg = (p < end && *p == '-');
+    if(neg)
+        p++;
+    if(p == end || *p < '0' || *p > '9')
+        return NULL;
+    index_t r = 0;
+    for(; p < end && *p >= '0' && *p <= '9'; p++)
+        r = 10*r + (*p - '0');
+    *x = neg ? -r : r;
+    return p;
+}
+
+static inline const char *stp_eol(const char *p, const char *end)
+{
+    const char *e = (const char *) memchr(p, '\n', end - p);
+    return (e == NULL) ? end : e;
+}
+
+/**************************************************************** Indexing. */
+
+// subset major index
+#define FV_INDEX(v, n, k, X) ((index_t)(X) * (n) + (v))
+#define BV_INDEX(v, n, k, X) ((index_t)(X) * (n) + (v))
+
+// back-pointer of (v, X): vertex u and subset Xd it was derived from
+typedef struct bptr
+{
+    bvid_t u;
+    bvid_t X;
+} bptr_t;
+
+#define BV_SET(b, v, Xd) { (b).u = (bvid_t)(v); (b).X = (bvid_t)(Xd); }
+#define BV_VERTEX(b) ((b).u == (bvid_t) UNDEFINED ? UNDEFINED : (index_t)(b).u)
+
+/********************************************************* Adjacency layout. */
+/*
+ * The arcs of vertex u are at the indices ARC_FIRST(pos, adj, u) up to 
+ * ARC_END(pos, adj, u) in steps of ARC_STEP, arc i leads to vertex
+ * ARC_HEAD(adj, m, i) over an edge of weight ARC_WEIGHT(adj, m, i).
+ *
+ * By default adj interleaves a degree header at pos[u] with the (neighbour,
+ * weight) pairs of u. With COMPACT_GRAPH pos holds n+1 offsets into two 
+ * uint32_t arrays in one allocation, the 2m neighbours followed by the 2m 
+ * weights, so a scan of the neighbours touches a quarter of the bytes.
+ */
+
+#ifdef COMPACT_GRAPH
+#define POS_LEN(n)              ((n)+1)
+#define ADJ_LEN(n, m)           (4*(m))
+#define ARC_SLOTS(n, m)         (2*(m))
+#define ARC_STEP                1
+#define ARC_HEADER              0
+#define ARC_FIRST(pos, adj, u)  ((pos)[u])
+#define ARC_END(pos, adj, u)    ((pos)[(u)+1])
+#define ARC_HEAD(adj, m, i)     ((index_t) (adj)[i])
+#define ARC_WEIGHT(adj, m, i)   ((index_t) (adj)[(i)+2*(m)])
+#define ARC_APPEND(pos, adj, m, u, v, w) { index_t i_ = (pos)[u]++; \
+                                           (adj)[i_] = (adj_t) (v); \
+                                           (adj)[i_+2*(m)] = (adj_t) (w); }
+#else
+#define POS_LEN(n)              (n)
+#define ADJ_LEN(n, m)           ((n)+4*(m))
+#define ARC_SLOTS(n, m)         ((n)+4*(m))
+#define ARC_STEP                2
+#define ARC_HEADER              1
+#define ARC_FIRST(pos, adj, u)  ((pos)[u]+1)
+#define ARC_END(pos, adj, u)    ((pos)[u]+1+2*(adj)[(pos)[u]])
+#define ARC_HEAD(adj, m, i)     ((adj)[i])
+#define ARC_WEIGHT(adj, m, i)   ((adj)[(i)+1])
+#define ARC_APPEND(pos, adj, m, u, v, w) { index_t p_ = (pos)[u]; \
+                                           (adj)[p_+1+2*(adj)[p_]] = (v); \
+                                           (adj)[p_+2+2*(adj)[p_]] = (w); \
+                                           (adj)[p_]++; }
+#endif
+#define ARC_DEGREE(pos, adj, u) \
+    ((ARC_END(pos, adj, u) - ARC_FIRST(pos, adj, u))/ARC_STEP)
+
+/******************************************************** Root query builder. */
+
+typedef struct steinerq
+{
+    index_t     n;
+    index_t     m;
+    index_t     k;
+    index_t     *kk;
+    index_t     *gpos;     // group t is gv[gpos[t]..gpos[t+1]-1], NULL if
+    index_t     *gv;       // the terminals are single vertices
+    index_t     *pos;
+    adj_t       *adj;
+    index_t     *perm;     // input vertex of each vertex, NULL if not reordered
+    struct reduction *red; // maps solutions to the input graph, or NULL
+    void        *map;      // snapshot mapping holding kk, pos, adj and perm
+    size_t      map_size;
+}steinerq_t;
+
+// the root query of a snapshot or an STP file, reduced and reordered
+steinerq_t *root_load(const char *filename, index_t bin_input, 
+                      index_t reduce, index_t order, index_t *min_cost);
+
+/********************************************************* Binary snapshots. */
+
+#define SNAPSHOT_MAGIC   0x31525343564d45L // "EMVCSR1"
+#define SNAPSHOT_VERSION 1
+
+// layout flags
+#define SNAPSHOT_COMPACT 0x01 // adjacency of a COMPACT_GRAPH build
+#define SNAPSHOT_REORDER 0x02 // vertices renumbered, perm follows adj
+
+#ifdef COMPACT_GRAPH
+#define SNAPSHOT_LAYOUT  SNAPSHOT_COMPACT
+#else
+#define SNAPSHOT_LAYOUT  0x00
+#endif
+
+typedef struct snapshot_header
+{
+    index_t magic;
+    index_t version;
+    index_t index_bytes;
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t cost;
+    index_t layout;
+} snapshot_header_t;
+
+index_t snapshot_probe(const char *filename);
+
+/**************************************************** Dijkstra shortest path. */
+
+typedef struct dijkstra_ws dijkstra_ws_t;
+typedef struct prune prune_t;
+
+dijkstra_ws_t *dijkstra_ws_alloc(index_t n);
+void dijkstra_ws_free(dijkstra_ws_t *ws);
+#ifdef TRACK_OPTIMAL
+index_t *dijkstra_ws_pred(dijkstra_ws_t *ws);
+#endif
+size_t heap_node_size(void);
+
+void dijkstra(index_t n,
+              index_t m, 
+              index_t *pos, 
+              adj_t *adj, 
+              index_t s, 
+              dist_t *d,
+              dijkstra_ws_t *ws
+#ifdef TRACK_BANDWIDTH
+              ,index_t *heap_ops
+#endif
+             );
+
+dist_t dijkstra_multi(index_t n,
+                      index_t m, 
+                      index_t *pos, 
+                      adj_t *adj, 
+                      dist_t *d,
+                      dijkstra_ws_t *ws,
+                      prune_t *pr,
+                      index_t mask,
+                      index_t th
+#ifdef TRACK_BANDWIDTH
+                      ,index_t *heap_ops
+#endif
+                     );
+
+typedef struct delta_ws delta_ws_t;
+
+/*************************************************************** Reductions. */
+
+typedef struct reduction
+{
+    index_t n;          // input vertices
+    index_t m;          // input edges first, then the derived ones
+    index_t *e;         // u, v and w of each edge, input numbering
+    index_t *sub;       // the two edges a derived edge replaces
+    index_t n_r;
+    index_t *vmap;      // input vertex of each reduced vertex
+    index_t m_r;
+    index_t *key;       // lo, hi and edge of the reduced edges, sorted
+    index_t num_forced;
+    index_t *forced;    // edges in every solution
+    index_t fixed;      // weight of the forced edges
+} reduce_t;
+
+/******************************************************* Subset merge kernel. */
+
+#ifndef MERGE_TILE
+#define MERGE_TILE 1024
+#endif
+
+void merge_rows(index_t v0,
+                index_t v1,
+                dist_t *f_X,
+                dist_t *f_Xd,
+                dist_t *f_X_Xd
+#ifdef TRACK_OPTIMAL
+                ,bptr_t *b_X
+                ,index_t Xd
+#endif
+                );
+
+/**************************************************** Erickson Monma Veinott. */
+
+/* Options of a run, set once from the command line. */
+
+typedef struct emv_opts
+{
+    index_t list_soln;
+    index_t nonroot;
+    index_t numa;
+    index_t tasks;
+    const char *ooc_dir;
+    const char *ckpt_path;
+    index_t prune;
+    const char *metrics_path;
+    index_t counters;
+    double timeout;         // seconds, 0 for no budget
+} emv_opts_t;
+
+void emv_opts_init(emv_opts_t *opt);
+
+/*
+ * The tables and the per-thread Dijkstra workspaces of one solve, sized for
+ * kt table terminals. The query server keeps one across its queries, it 
+ * serves every query with up to kt table terminals.
+ *
+ */
+
+typedef struct emv_ws
+{
+    index_t n;
+    index_t kt;
+    index_t nt;
+    index_t numa;
+    const char *ooc_dir;
+    int ooc_fd[2];          // out-of-core files of f_v and b_v, or -1
+    const char *page_legend;
+    size_t f_size;
+    dist_t *f_v;
+#ifdef TRACK_OPTIMAL
+    size_t b_size;
+    bptr_t *b_v;
+#endif
+    dijkstra_ws_t **ws;
+    delta_ws_t *dw;         // shared by the threads on levels with few subsets
+} emv_ws_t;
+
+emv_ws_t *emv_ws_alloc(index_t n, index_t kt, index_t numa, 
+                       const char *ooc_dir);
+void emv_ws_free(emv_ws_t *w);
+
+// w is a workspace kept across solves, or NULL for one of this solve only,
+// exact is set to 0 if the budget stopped the run before the optimum
+index_t erickson_monma_veinott(steinerq_t *root, const emv_opts_t *opt, 
+                               index_t *exact, emv_ws_t *w);
+
+#ifdef LIST_OPTIMAL
+// lists a tree of the root query in input numbering, frees it
+void solution_list(steinerq_t *root, graph_t *g);
+#endif
+
+/******************************************************** Distributed kernel. */
+
+#ifdef BUILD_MPI
+index_t emv_distributed(steinerq_t *root, const emv_opts_t *opt);
+#endif
+
+/******************************************************** Accelerator kernel. */
+
+#ifdef BUILD_OFFLOAD
+index_t emv_offload(steinerq_t *root, const emv_opts_t *opt);
+#endif
+
+/************************************************** Dijkstra-Steiner search. */
+
+index_t dijkstra_steiner(steinerq_t *root, index_t list_soln);
+
+/************************************************************** Query server. */
+
+typedef struct query_server
+{
+    steinerq_t *root;
+    index_t ds;             // Dijkstra-Steiner, else Erickson-Monma-Veinott
+    emv_opts_t opts;
+    emv_ws_t *w;
+    index_t *inv;           // internal number of each input vertex
+    index_t *kk;            // terminals of the current query
+    index_t *seen;
+    index_t num_queries;
+    index_t num_errors;
+} query_server_t;
+
+query_server_t *query_server_alloc(steinerq_t *root, index_t ds, 
+                                   const emv_opts_t *opt, index_t maxk);
+void query_server_free(query_server_t *qs);
+index_t query_serve(query_server_t *qs, FILE *in, FILE *out);
+void query_listen(query_server_t *qs, index_t port);
+
+/************************************************************** Batch runner. */
+
+void batch_run(const char *path, const char *logdir, index_t ds, 
+               const emv_opts_t *opt, index_t reduce, index_t order);
+
+#endif
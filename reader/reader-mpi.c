@@ -0,0 +1,648 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work 
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include<math.h>
+
+#include"reader-el.h"
+
+/******************************************************** Distributed kernel. */
+/*
+ * With BUILD_MPI the table is split by vertices: rank r holds the block
+ * v0 <= v < v0 + nb of every row, v0 = r*nb, and the merges of a level run
+ * on the local blocks without communication. The shortest path step needs
+ * whole rows, so for it the subsets are split: subset i of a level goes to
+ * rank i mod P, and all subsets of a level cost the same. The owner gathers
+ * the merged blocks of its rows, runs Dijkstra on them and scatters the 
+ * rows back. That is two rows of traffic per subset. If the merges were
+ * split by subsets too, the owner of X would fetch all 2^|X| rows below X.
+ *
+ * A level runs in batches of DK_BATCH rows per thread and rank. The rank 
+ * posts the gather of batch b as soon as it has merged it, and runs 
+ * Dijkstra on batch b-1 while the gather of b and the scatter of b-2 are
+ * still on the wire. The graph is read by every rank.
+ *
+ */
+
+#ifdef BUILD_MPI
+
+#ifndef DK_BATCH
+#define DK_BATCH 2
+#endif
+
+#ifdef NARROW_TABLE
+#define DK_DIST MPI_UINT32_T
+#else
+#define DK_DIST MPI_LONG
+#endif
+
+typedef struct dk_batch
+{
+    index_t lo;             // subsets lo..hi-1 of the level
+    index_t hi;
+    index_t rows;           // owned by this rank
+    int *scnt;              // blocks per rank, all subsets by owner
+    int *sdsp;
+    int *rcnt;              // blocks per rank, owned subsets by source
+    int *rdsp;
+    dist_t *blk;            // local blocks of all subsets
+    dist_t *own;            // all blocks of the owned subsets
+    dist_t *row;            // the owned rows
+#ifdef TRACK_OPTIMAL
+    index_t *p_blk;         // predecessors, same layouts
+    index_t *p_own;
+#endif
+    MPI_Request req[2];
+} dk_batch_t;
+
+typedef struct dk
+{
+    index_t n;
+    index_t m;
+    index_t k;
+    index_t kt;
+    index_t *kk;
+    index_t *pos;
+    adj_t *adj;
+    index_t nt;
+    index_t P;
+    index_t r;
+    index_t nb;             // block length, P*nb >= n
+    index_t v0;             // first vertex of the local block
+    index_t len;            // vertices in the local block
+    dist_t *f_l;            // local blocks, f_l[X*nb + v - v0]
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_l;
+#endif
+    dijkstra_ws_t **ws;
+    index_t batch;          // owned subsets per batch
+    dk_batch_t slot[3];
+    MPI_Datatype f_block;
+#ifdef TRACK_OPTIMAL
+    MPI_Datatype p_block;
+#endif
+    double wait;            // seconds blocked on the exchanges
+    index_t sent;           // bytes sent to other ranks
+    index_t gets;           // remote reads of the traceback
+#ifdef TRACK_BANDWIDTH
+    index_t *heap_ops;
+#endif
+} dk_t;
+
+dk_t *dk_alloc(steinerq_t *root, index_t kt)
+{
+    dk_t *d = (dk_t *) MALLOC(sizeof(dk_t));
+    d->n   = root->n;
+    d->m   = root->m;
+    d->k   = root->k;
+    d->kt  = kt;
+    d->kk  = root->kk;
+    d->pos = root->pos;
+    d->adj = root->adj;
+    d->nt  = num_threads();
+    d->P   = num_ranks;
+    d->r   = rank_id;
+    d->nb  = (d->n + d->P - 1)/d->P;
+    d->v0  = MIN(d->r*d->nb, d->n);
+    d->len = MIN(d->nb, d->n - d->v0);
+    d->f_l = (dist_t *) MALLOC((1<<kt)*d->nb*sizeof(dist_t));
+#ifdef TRACK_OPTIMAL
+    d->b_l = (bptr_t *) MALLOC((1<<kt)*d->nb*sizeof(bptr_t));
+#endif
+    d->ws = (dijkstra_ws_t **) MALLOC(d->nt*sizeof(dijkstra_ws_t *));
+    for(index_t th = 0; th < d->nt; th++)
+        d->ws[th] = dijkstra_ws_alloc(d->n);
+
+    d->batch = DK_BATCH*d->nt;
+    for(index_t i = 0; i < 3; i++)
+    {
+        dk_batch_t *s = d->slot + i;
+        s->scnt = (int *) MALLOC(4*d->P*sizeof(int));
+        s->sdsp = s->scnt + d->P;
+        s->rcnt = s->scnt + 2*d->P;
+        s->rdsp = s->scnt + 3*d->P;
+        s->blk  = (dist_t *) MALLOC(d->batch*d->P*d->nb*sizeof(dist_t));
+        s->own  = (dist_t *) MALLOC(d->batch*d->P*d->nb*sizeof(dist_t));
+        s->row  = (dist_t *) MALLOC(d->batch*d->n*sizeof(dist_t));
+#ifdef TRACK_OPTIMAL
+        s->p_blk = (index_t *) MALLOC(d->batch*d->P*d->nb*sizeof(index_t));
+        s->p_own = (index_t *) MALLOC(d->batch*d->P*d->nb*sizeof(index_t));
+#endif
+        s->req[0] = MPI_REQUEST_NULL;
+        s->req[1] = MPI_REQUEST_NULL;
+    }
+    MPI_Type_contiguous((int) d->nb, DK_DIST, &d->f_block);
+    MPI_Type_commit(&d->f_block);
+#ifdef TRACK_OPTIMAL
+    MPI_Type_contiguous((int) d->nb, MPI_LONG, &d->p_block);
+    MPI_Type_commit(&d->p_block);
+#endif
+    d->wait = 0;
+    d->sent = 0;
+    d->gets = 0;
+#ifdef TRACK_BANDWIDTH
+    d->heap_ops = (index_t *) MALLOC(d->nt*sizeof(index_t));
+    for(index_t th = 0; th < d->nt; th++)
+        d->heap_ops[th] = 0;
+#endif
+    return d;
+}
+
+void dk_free(dk_t *d)
+{
+    for(index_t i = 0; i < 3; i++)
+    {
+        dk_batch_t *s = d->slot + i;
+        FREE(s->scnt);
+        FREE(s->blk);
+        FREE(s->own);
+        FREE(s->row);
+#ifdef TRACK_OPTIMAL
+        FREE(s->p_blk);
+        FREE(s->p_own);
+#endif
+    }
+    MPI_Type_free(&d->f_block);
+#ifdef TRACK_OPTIMAL
+    MPI_Type_free(&d->p_block);
+#endif
+    for(index_t th = 0; th < d->nt; th++)
+        dijkstra_ws_free(d->ws[th]);
+    FREE(d->ws);
+    FREE(d->f_l);
+#ifdef TRACK_OPTIMAL
+    FREE(d->b_l);
+#endif
+#ifdef TRACK_BANDWIDTH
+    FREE(d->heap_ops);
+#endif
+    FREE(d);
+}
+
+// batches start at multiples of P, subset lo + o + j*P is block j of rank o
+static void dk_counts(dk_t *d, dk_batch_t *s, index_t lo, index_t hi)
+{
+    s->lo = lo;
+    s->hi = hi;
+    index_t sum = 0;
+    for(index_t o = 0; o < d->P; o++)
+    {
+        s->scnt[o] = (lo + o < hi) ? (int) ((hi - lo - o + d->P - 1)/d->P) : 0;
+        s->sdsp[o] = (int) sum;
+        sum += s->scnt[o];
+    }
+    s->rows = s->scnt[d->r];
+    for(index_t o = 0; o < d->P; o++)
+    {
+        s->rcnt[o] = (int) s->rows;
+        s->rdsp[o] = (int) (o*s->rows);
+    }
+}
+
+// completes what the exchanges in flight can do without blocking
+static void dk_progress(dk_t *d)
+{
+    int flag;
+    for(index_t i = 0; i < 3; i++)
+        MPI_Testall(2, d->slot[i].req, &flag, MPI_STATUSES_IGNORE);
+}
+
+static void dk_wait(dk_t *d, dk_batch_t *s)
+{
+    double start = MPI_Wtime();
+    MPI_Waitall(2, s->req, MPI_STATUSES_IGNORE);
+    d->wait += MPI_Wtime() - start;
+}
+
+static void dk_merge(dk_t *d, index_t X)
+{
+    index_t nb = d->nb;
+    dist_t *f_X = d->f_l + X*nb;
+#ifdef TRACK_OPTIMAL
+    bptr_t *b_X = d->b_l + X*nb;
+#endif
+    index_t lo = X & (-X);
+    index_t R  = X & ~lo;
+    for(index_t v0 = 0; v0 < d->len; v0 += MERGE_TILE)
+    {
+        index_t v1 = MIN(v0 + MERGE_TILE, d->len);
+        for(index_t Y = 0; Y != R; Y = (Y - R) & R)
+        {
+            index_t Xd = lo | Y;
+            merge_rows(v0, v1, f_X, d->f_l + Xd*nb, d->f_l + (R & ~Y)*nb
+#ifdef TRACK_OPTIMAL
+                       ,b_X, Xd
+#endif
+                       );
+        }
+    }
+#ifdef TRACK_OPTIMAL
+    // the merges record block offsets, the table holds vertices
+    for(index_t i = 0; i < d->len; i++)
+        if(b_X[i].u != (bvid_t) UNDEFINED)
+            b_X[i].u = (bvid_t) (d->v0 + i);
+#endif
+
+    for(index_t t = 0; t < d->kt; t++)
+    {
+        index_t u = d->kk[t];
+        if(!(X & (1<<t)) || u < d->v0 || u >= d->v0 + d->len)
+            continue;
+        index_t X_u = (X & ~(1<<t));
+        dist_t f_u  = d->f_l[X_u*nb + u - d->v0];
+        if(f_u < f_X[u - d->v0])
+        {
+            f_X[u - d->v0] = f_u;
+#ifdef TRACK_OPTIMAL
+            BV_SET(b_X[u - d->v0], u, X_u);
+#endif
+        }
+    }
+}
+
+// merges the local blocks of a batch and posts their gather at the owners
+static void dk_gather(dk_t *d, dk_batch_t *s, index_t *X_a)
+{
+    index_t nb = d->nb;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t th = 0; th < d->nt; th++)
+    {
+        for(index_t i = s->lo + th; i < s->hi; i += d->nt)
+        {
+            index_t X = X_a[i];
+            dk_merge(d, X);
+            index_t o = (i - s->lo) % d->P;
+            index_t j = (i - s->lo) / d->P;
+            dist_t *blk = s->blk + (s->sdsp[o] + j)*nb;
+            dist_t *f_X = d->f_l + X*nb;
+            for(index_t v = 0; v < d->len; v++)
+                blk[v] = f_X[v];
+            for(index_t v = d->len; v < nb; v++)
+                blk[v] = DIST_INF;
+        }
+    }
+    MPI_Ialltoallv(s->blk, s->scnt, s->sdsp, d->f_block,
+                   s->own, s->rcnt, s->rdsp, d->f_block,
+                   MPI_COMM_WORLD, s->req);
+    d->sent += (s->hi - s->lo - s->rows)*nb*sizeof(dist_t);
+}
+
+// shortest paths over the owned rows of a batch, posts their scatter
+static void dk_solve(dk_t *d, dk_batch_t *s, index_t *X_a, index_t level)
+{
+    index_t n  = d->n;
+    index_t nb = d->nb;
+    index_t P  = d->P;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t th = 0; th < d->nt; th++)
+    {
+        dijkstra_ws_t *ws_th = d->ws[th];
+        for(index_t j = th; j < s->rows; j += d->nt)
+        {
+            index_t X = X_a[s->lo + d->r + j*P];
+            dist_t *row = s->row + j*n;
+            if(level == 1)
+            {
+                dijkstra(n, d->m, d->pos, d->adj, d->kk[__builtin_ctzl(X)],
+                         row, ws_th
+#ifdef TRACK_BANDWIDTH
+                         ,d->heap_ops + th
+#endif
+                         );
+            }
+            else
+            {
+                for(index_t v = 0; v < n; v++)
+                    row[v] = s->own[((v/nb)*s->rows + j)*nb + v%nb];
+                dijkstra_multi(n, d->m, d->pos, d->adj, row, ws_th, NULL, 0,
+                               th
+#ifdef TRACK_BANDWIDTH
+                               ,d->heap_ops + th
+#endif
+                               );
+            }
+            for(index_t v = 0; v < n; v++)
+            {
+                index_t e = ((v/nb)*s->rows + j)*nb + v%nb;
+                s->own[e] = row[v];
+#ifdef TRACK_OPTIMAL
+                index_t u = (level == 1) ? d->kk[__builtin_ctzl(X)] : 
+                                           dijkstra_ws_pred(ws_th)[v];
+                s->p_own[e] = (row[v] == DIST_INF) ? UNDEFINED : u;
+#endif
+            }
+            for(index_t v = n; v < P*nb; v++)
+            {
+                index_t e = ((v/nb)*s->rows + j)*nb + v%nb;
+                s->own[e] = DIST_INF;
+#ifdef TRACK_OPTIMAL
+                s->p_own[e] = UNDEFINED;
+#endif
+            }
+#ifdef BUILD_PARALLEL
+            if(omp_get_thread_num() == 0)
+#endif
+                dk_progress(d);
+        }
+    }
+    MPI_Ialltoallv(s->own, s->rcnt, s->rdsp, d->f_block,
+                   s->blk, s->scnt, s->sdsp, d->f_block,
+                   MPI_COMM_WORLD, s->req);
+#ifdef TRACK_OPTIMAL
+    MPI_Ialltoallv(s->p_own, s->rcnt, s->rdsp, d->p_block,
+                   s->p_blk, s->scnt, s->sdsp, d->p_block,
+                   MPI_COMM_WORLD, s->req + 1);
+    d->sent += s->rows*(P-1)*nb*sizeof(index_t);
+#endif
+    d->sent += s->rows*(P-1)*nb*sizeof(dist_t);
+}
+
+// stores the scattered blocks of a batch into the local table
+static void dk_store(dk_t *d, dk_batch_t *s, index_t *X_a, index_t level)
+{
+    index_t nb = d->nb;
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t i = s->lo; i < s->hi; i++)
+    {
+        index_t X = X_a[i];
+        index_t o = (i - s->lo) % d->P;
+        index_t j = (i - s->lo) / d->P;
+        index_t e = (s->sdsp[o] + j)*nb;
+        dist_t *f_X = d->f_l + X*nb;
+        for(index_t v = 0; v < d->len; v++)
+            f_X[v] = s->blk[e + v];
+#ifdef TRACK_OPTIMAL
+        bptr_t *b_X = d->b_l + X*nb;
+        for(index_t v = 0; v < d->len; v++)
+        {
+            index_t u = s->p_blk[e + v];
+            if(level == 1)
+            {
+                BV_SET(b_X[v], d->kk[__builtin_ctzl(X)], X);
+            }
+            else if(u != UNDEFINED)
+            {
+                BV_SET(b_X[v], u, X);
+            }
+        }
+#endif
+    }
+}
+
+static void dk_level(dk_t *d, index_t level, index_t *X_a, index_t kCm)
+{
+    index_t per    = d->batch*d->P;
+    index_t nbatch = (kCm + per - 1)/per;
+    for(index_t b = 0; b < nbatch + 2; b++)
+    {
+        if(b < nbatch)
+        {
+            dk_batch_t *s = d->slot + b%3;
+            dk_counts(d, s, b*per, MIN((b+1)*per, kCm));
+            if(level > 1)
+                dk_gather(d, s, X_a);
+        }
+        if(b >= 1 && b <= nbatch)
+        {
+            dk_batch_t *s = d->slot + (b-1)%3;
+            dk_wait(d, s);
+            dk_solve(d, s, X_a, level);
+        }
+        if(b >= 2)
+        {
+            dk_batch_t *s = d->slot + (b-2)%3;
+            dk_wait(d, s);
+            dk_store(d, s, X_a, level);
+        }
+    }
+}
+
+#ifdef TRACK_OPTIMAL
+static bptr_t dk_bptr(dk_t *d, MPI_Win win, index_t v, index_t X)
+{
+    index_t o = v/d->nb;
+    MPI_Aint e = (MPI_Aint) (X*d->nb + v - o*d->nb);
+    if(o == d->r)
+        return d->b_l[e];
+    bptr_t b;
+    MPI_Win_lock(MPI_LOCK_SHARED, (int) o, 0, win);
+    MPI_Get(&b, sizeof(bptr_t), MPI_BYTE, (int) o, e, sizeof(bptr_t), 
+            MPI_BYTE, win);
+    MPI_Win_unlock((int) o, win);
+    d->gets++;
+    return b;
+}
+
+// backtrack() over the distributed table, entries read with MPI_Get
+static void dk_backtrack(dk_t *d, MPI_Win win, index_t v, index_t X,
+                         graph_t *g)
+{
+    if(X == 0 || v == -1)
+        return;
+
+    bptr_t b = dk_bptr(d, win, v, X);
+    index_t u = BV_VERTEX(b);
+
+    if(v != u)
+    {
+        graph_add_edge(g, v, u, 1);
+        dk_backtrack(d, win, u, b.X, g);
+    }
+    else
+    {
+        index_t Xd = b.X;
+        if(X == Xd)
+            return;
+        dk_backtrack(d, win, u, Xd, g);
+        dk_backtrack(d, win, u, X & ~Xd, g);
+    }
+}
+#endif
+
+index_t emv_distributed(steinerq_t *root, const emv_opts_t *opt)
+{
+    index_t list_soln = opt->list_soln;
+    index_t nonroot   = opt->nonroot;
+    index_t k = root->k;
+    if(k <= 2 || root->gpos != NULL)
+    {
+        // a single Dijkstra, every rank solves it, as it does the groups
+        emv_opts_t plain;
+        emv_opts_init(&plain);
+        plain.list_soln = list_soln;
+        plain.nonroot   = nonroot;
+        return erickson_monma_veinott(root, &plain, NULL, NULL);
+    }
+
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    push_time();
+
+    double time;
+    index_t n   = root->n;
+    index_t m   = root->m;
+    index_t *kk = root->kk;
+    index_t kt  = nonroot ? k-1 : k;
+    index_t q   = kk[k-1];
+    index_t C   = (1<<(k-1))-1;
+#ifdef LIST_OPTIMAL
+    graph_t *g = NULL;
+#endif
+
+    dk_t *d = dk_alloc(root, kt);
+
+    push_time();
+#ifdef BUILD_PARALLEL
+#pragma omp parallel for
+#endif
+    for(index_t i = 0; i < (index_t)(d->nb*(1<<kt)); i++)
+    {
+        d->f_l[i] = DIST_INF;
+#ifdef TRACK_OPTIMAL
+        BV_SET(d->b_l[i], UNDEFINED, 0);
+#endif
+    }
+    time = pop_time();
+    fprintf(stdout, "erickson: [zero: %.2lf ms] ", time);
+
+    // level by level, every rank walks the same subset order
+    MPI_Barrier(MPI_COMM_WORLD);
+    push_time();
+    index_t *X_a = (index_t *) MALLOC(choose(kt, kt/2) * sizeof(index_t));
+    for(index_t l = 1; l <= kt; l++)
+    {
+        index_t i = 0; 
+        index_t z = 0;
+        for(index_t X = (1<<l)-1;
+            X < (1<<kt);
+            z = X|(X-1), X = (z+1)|(((~z & -~z)-1) >> (__builtin_ctz(X) + 1)))
+        {
+            X_a[i++] = X;
+        }
+        dk_level(d, l, X_a, i);
+    }
+    FREE(X_a);
+
+    index_t o = q/d->nb;
+    dist_t f_q_C = (o == d->r) ? d->f_l[C*d->nb + q - d->v0] : 0;
+    MPI_Bcast(&f_q_C, 1, DK_DIST, (int) o, MPI_COMM_WORLD);
+    index_t min_cost = (index_t) f_q_C;
+    time = pop_time();
+
+    double trans_rate = 0;
+#ifdef TRACK_BANDWIDTH
+    index_t heap_ops = 0;
+    for(index_t th = 0; th < d->nt; th++)
+        heap_ops += d->heap_ops[th];
+    MPI_Allreduce(MPI_IN_PLACE, &heap_ops, 1, MPI_LONG, MPI_SUM, 
+                  MPI_COMM_WORLD);
+#ifdef TRACK_OPTIMAL
+    index_t mem_graph = 5*n+6*m;
+#else
+    index_t mem_graph = 4*n+6*m;
+#endif
+    index_t trans_bytes = ((index_t)(pow(3,kt+1)/2)*n*sizeof(dist_t))+
+                          ((index_t)(pow(2,kt)*mem_graph)*sizeof(index_t))+
+                          (heap_ops * heap_node_size());
+    trans_rate = trans_bytes / (time / 1000.0);
+#endif
+    fprintf(stdout, "[kernel: %.2lf ms %.2lfGiB/s] ",
+                    time, trans_rate/(1 << 30));
+
+    // rank 0 walks the tree, the others expose their blocks until it is done
+#ifdef TRACK_OPTIMAL
+    if(list_soln)
+    {
+        push_time();
+        // a single rank reads its own table, no window needed
+        MPI_Win win = MPI_WIN_NULL;
+        if(d->P > 1)
+            MPI_Win_create(d->b_l, (MPI_Aint) ((1<<kt)*d->nb*sizeof(bptr_t)),
+                           sizeof(bptr_t), MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+        if(d->r == 0)
+        {
+            g = graph_alloc();
+            g->n = n;
+            dk_backtrack(d, win, q, C, g);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        if(win != MPI_WIN_NULL)
+            MPI_Win_free(&win);
+        time = pop_time();
+        fprintf(stdout, "[traceback: %.2lf ms] ", time);
+    }
+#endif
+
+    double blocked = d->wait;
+    index_t sent = d->sent;
+    index_t gets = d->gets;
+    index_t nb = d->nb;
+    MPI_Allreduce(MPI_IN_PLACE, &blocked, 1, MPI_DOUBLE, MPI_MAX, 
+                  MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, &sent, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+    dk_free(d);
+
+    if(root->red != NULL)
+        min_cost += root->red->fixed;
+
+    time = pop_time();
+    fprintf(stdout, "done. [%.2lf ms] [cost: %ld] ", time, min_cost);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    fprintf(stdout, "mpi: [ranks: %ld] [block: %ld] [sent: %.2lfGiB] "
+                    "[wait: %.2lf ms] [gets: %ld]\n",
+                    num_ranks, nb, inGiB(sent), 1000.0*blocked, gets);
+    fflush(stdout);
+
+#ifdef LIST_OPTIMAL
+    if(list_soln && g != NULL)
+        solution_list(root, g);
+#endif
+    return min_cost;
+}
+#endif
@@ -0,0 +1,398 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work 
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#include<math.h>
+
+#include"reader-el.h"
+
+/******************************************************** Accelerator kernel. */
+/*
+ * With BUILD_OFFLOAD the table stays in device memory for the whole run.
+ * The host sees the graph, f[q][C] and, with -list, the rows of b_v that 
+ * the traceback walks through.
+ *
+ * A level runs as device kernels over all of its subsets at once, one
+ * device thread per entry (X, v). The merge takes the minimum over the 
+ * splits of X and the terminal step of emv_subset in registers and writes
+ * the entry once. The shortest paths are rounds of Bellman-Ford relaxation
+ * in place, each (X, v) pulling from the arcs of v, until a round changes
+ * no label of the level. Labels only decrease, so a label read while its
+ * owner rewrites it is still the length of a path.
+ *
+ */
+
+#ifdef BUILD_OFFLOAD
+
+typedef struct od
+{
+    index_t n;
+    index_t m;
+    index_t kt;
+    int dev;                // device holding the table
+    int host;
+    dist_t *f_d;            // device table, f_d[X*n + v]
+    bptr_t *b_d;            // device back-pointers, NULL without them
+    bptr_t **b_h;           // rows of b_d copied to the host, NULL if not
+    index_t rounds;         // relaxation rounds over all levels
+    index_t relax_bytes;    // bytes read by the relaxation rounds
+    index_t pulled;         // bytes copied back to the host
+} od_t;
+
+od_t *od_alloc(index_t n, index_t m, index_t kt)
+{
+    od_t *o = (od_t *) MALLOC(sizeof(od_t));
+    o->n    = n;
+    o->m    = m;
+    o->kt   = kt;
+    o->dev  = omp_get_default_device();
+    o->host = omp_get_initial_device();
+    o->f_d  = (dist_t *) omp_target_alloc(n*(1<<kt)*sizeof(dist_t), o->dev);
+    if(o->f_d == NULL)
+        ERROR("unable to allocate the table on device %d", o->dev);
+    o->b_d = NULL;
+    o->b_h = NULL;
+#ifdef TRACK_OPTIMAL
+    o->b_d  = (bptr_t *) omp_target_alloc(n*(1<<kt)*sizeof(bptr_t), o->dev);
+    if(o->b_d == NULL)
+        ERROR("unable to allocate the back-pointers on device %d", o->dev);
+    o->b_h = (bptr_t **) MALLOC((1<<kt)*sizeof(bptr_t *));
+    for(index_t X = 0; X < (1<<kt); X++)
+        o->b_h[X] = NULL;
+#endif
+    o->rounds = 0;
+    o->relax_bytes = 0;
+    o->pulled = 0;
+    return o;
+}
+
+void od_free(od_t *o)
+{
+    omp_target_free(o->f_d, o->dev);
+    if(o->b_d != NULL)
+        omp_target_free(o->b_d, o->dev);
+    if(o->b_h != NULL)
+    {
+        for(index_t X = 0; X < (1<<o->kt); X++)
+            if(o->b_h[X] != NULL)
+                FREE(o->b_h[X]);
+        FREE(o->b_h);
+    }
+    FREE(o);
+}
+
+// one level over the subsets X_a[0..kCm-1] of size l, pos, adj, kk and
+// X_a are mapped to the device by the caller
+static void od_level(od_t *o, index_t *pos, adj_t *adj, index_t *kk,
+                     index_t l, index_t *X_a, index_t kCm)
+{
+    index_t n   = o->n;
+    index_t m   = o->m;
+    index_t kt  = o->kt;
+    int dev     = o->dev;
+    dist_t *f_d = o->f_d;
+    bptr_t *b_d = o->b_d;
+
+#pragma omp target teams distribute parallel for collapse(2) device(dev) \
+        is_device_ptr(f_d, b_d)
+    for(index_t i = 0; i < kCm; i++)
+    {
+        for(index_t v = 0; v < n; v++)
+        {
+            index_t X  = X_a[i];
+            dist_t f   = DIST_INF;
+            index_t bu = UNDEFINED;
+            index_t bX = X;
+            if(l == 1)
+            {
+                if(v == kk[__builtin_ctzl(X)])
+                {
+                    f  = 0;
+                    bu = v;
+                }
+            }
+            else
+            {
+                index_t lo = X & (-X);
+                index_t R  = X & ~lo;
+                for(index_t Y = 0; Y != R; Y = (Y - R) & R)
+                {
+                    index_t Xd = lo | Y;
+                    dist_t a = f_d[Xd*n + v];
+                    dist_t b = f_d[(R & ~Y)*n + v];
+#ifdef NARROW_TABLE
+                    dist_t s = a + MIN(b, DIST_INF - a);
+#else
+                    dist_t s = a + b;
+#endif
+                    if(s < f)
+                    {
+                        f  = s;
+                        bu = v;
+                        bX = Xd;
+                    }
+                }
+                for(index_t t = 0; t < kt; t++)
+                {
+                    index_t X_u = X & ~(1<<t);
+                    if(kk[t] == v && X_u != X && f_d[X_u*n + v] < f)
+                    {
+                        f  = f_d[X_u*n + v];
+                        bu = v;
+                        bX = X_u;
+                    }
+                }
+            }
+            f_d[X*n + v] = f;
+#ifdef TRACK_OPTIMAL
+            BV_SET(b_d[X*n + v], bu, bX);
+#else
+            (void) b_d;
+            (void) bu;
+            (void) bX;
+#endif
+        }
+    }
+
+    index_t changed;
+    do
+    {
+        changed = 0;
+#pragma omp target teams distribute parallel for collapse(2) device(dev) \
+        is_device_ptr(f_d, b_d) map(tofrom: changed) reduction(max: changed)
+        for(index_t i = 0; i < kCm; i++)
+        {
+            for(index_t v = 0; v < n; v++)
+            {
+                index_t X = X_a[i];
+                dist_t *f_X = f_d + X*n;
+                index_t d_v = (index_t) f_X[v];
+                index_t bu  = UNDEFINED;
+                index_t end_v = ARC_END(pos, adj, v);
+                for(index_t a = ARC_FIRST(pos, adj, v); a < end_v; 
+                    a += ARC_STEP)
+                {
+                    index_t u = ARC_HEAD(adj, m, a);
+                    if(f_X[u] == DIST_INF)
+                        continue;
+                    index_t d_u = (index_t) f_X[u] + ARC_WEIGHT(adj, m, a);
+                    if(d_u < d_v)
+                    {
+                        d_v = d_u;
+                        bu  = u;
+                    }
+                }
+                if(bu != UNDEFINED)
+                {
+                    f_X[v] = (dist_t) d_v;
+#ifdef TRACK_OPTIMAL
+                    BV_SET(b_d[X*n + v], bu, X);
+#endif
+                    changed = 1;
+                }
+            }
+        }
+        o->rounds++;
+        o->relax_bytes += kCm*(POS_LEN(n)*sizeof(index_t) + 
+                               ADJ_LEN(n, m)*sizeof(adj_t) +
+                               (n + 2*m)*sizeof(dist_t));
+    } while(changed);
+}
+
+static void od_pull(od_t *o, void *dst, void *src, size_t offset, 
+                    size_t bytes)
+{
+    if(omp_target_memcpy(dst, src, bytes, 0, offset, o->host, o->dev) != 0)
+        ERROR("unable to copy from device %d", o->dev);
+    o->pulled += bytes;
+}
+
+#ifdef TRACK_OPTIMAL
+// backtrack() over the device table, each row visited is copied once
+static void od_backtrack(od_t *o, index_t v, index_t X, graph_t *g)
+{
+    if(X == 0 || v == -1)
+        return;
+
+    if(o->b_h[X] == NULL)
+    {
+        o->b_h[X] = (bptr_t *) MALLOC(o->n*sizeof(bptr_t));
+        od_pull(o, o->b_h[X], o->b_d, X*o->n*sizeof(bptr_t), 
+                o->n*sizeof(bptr_t));
+    }
+    bptr_t b = o->b_h[X][v];
+    index_t u = BV_VERTEX(b);
+
+    if(v != u)
+    {
+        graph_add_edge(g, v, u, 1);
+        od_backtrack(o, u, b.X, g);
+    }
+    else
+    {
+        index_t Xd = b.X;
+        if(X == Xd)
+            return;
+        od_backtrack(o, u, Xd, g);
+        od_backtrack(o, u, X & ~Xd, g);
+    }
+}
+#endif
+
+index_t emv_offload(steinerq_t *root, const emv_opts_t *opt)
+{
+    index_t list_soln = opt->list_soln;
+    index_t nonroot   = opt->nonroot;
+    index_t k = root->k;
+    if(k <= 2 || root->gpos != NULL)
+    {
+        // a single Dijkstra, not worth the device, groups stay on the host
+        emv_opts_t plain;
+        emv_opts_init(&plain);
+        plain.list_soln = list_soln;
+        plain.nonroot   = nonroot;
+        return erickson_monma_veinott(root, &plain, NULL, NULL);
+    }
+
+#ifdef TRACK_MEMORY
+    push_memtrack();
+#endif
+    push_time();
+
+    double time;
+    index_t n    = root->n;
+    index_t m    = root->m;
+    index_t *kk  = root->kk;
+    index_t *pos = root->pos;
+    adj_t *adj   = root->adj;
+    index_t kt   = nonroot ? k-1 : k;
+    index_t q    = kk[k-1];
+    index_t C    = (1<<(k-1))-1;
+#ifdef LIST_OPTIMAL
+    graph_t *g = NULL;
+#endif
+
+    // the levels write every entry they own, the table needs no zeroing
+    push_time();
+    od_t *o = od_alloc(n, m, kt);
+    time = pop_time();
+    fprintf(stdout, "erickson: [zero: %.2lf ms] ", time);
+
+    push_time();
+    index_t *X_a = (index_t *) MALLOC(choose(kt, kt/2) * sizeof(index_t));
+    int dev = o->dev;
+#pragma omp target data device(dev) \
+        map(to: pos[0:POS_LEN(n)], adj[0:ADJ_LEN(n, m)], kk[0:kt])
+    {
+        for(index_t l = 1; l <= kt; l++)
+        {
+            index_t i = 0; 
+            index_t z = 0;
+            for(index_t X = (1<<l)-1;
+                X < (1<<kt);
+                z = X|(X-1), 
+                X = (z+1)|(((~z & -~z)-1) >> (__builtin_ctz(X) + 1)))
+            {
+                X_a[i++] = X;
+            }
+#pragma omp target data device(dev) map(to: X_a[0:i])
+            od_level(o, pos, adj, kk, l, X_a, i);
+        }
+    }
+    FREE(X_a);
+
+    dist_t f_q_C;
+    od_pull(o, &f_q_C, o->f_d, (C*n + q)*sizeof(dist_t), sizeof(dist_t));
+    index_t min_cost = (index_t) f_q_C;
+    time = pop_time();
+
+    double trans_rate = 0;
+#ifdef TRACK_BANDWIDTH
+    index_t trans_bytes = ((index_t)(pow(3,kt+1)/2)*n*sizeof(dist_t))+
+                          o->relax_bytes;
+    trans_rate = trans_bytes / (time / 1000.0);
+#endif
+    fprintf(stdout, "[kernel: %.2lf ms %.2lfGiB/s] ",
+                    time, trans_rate/(1 << 30));
+
+#ifdef TRACK_OPTIMAL
+    if(list_soln)
+    {
+        push_time();
+        g = graph_alloc();
+        g->n = n;
+        od_backtrack(o, q, C, g);
+        time = pop_time();
+        fprintf(stdout, "[traceback: %.2lf ms] ", time);
+    }
+#endif
+
+    index_t rounds = o->rounds;
+    index_t pulled = o->pulled;
+    size_t table = n*(1<<kt)*sizeof(dist_t);
+#ifdef TRACK_OPTIMAL
+    table += n*(1<<kt)*sizeof(bptr_t);
+#endif
+    od_free(o);
+
+    if(root->red != NULL)
+        min_cost += root->red->fixed;
+
+    time = pop_time();
+    fprintf(stdout, "done. [%.2lf ms] [cost: %ld] ", time, min_cost);
+#ifdef TRACK_MEMORY
+    print_pop_memtrack();
+    fprintf(stdout, " ");
+    print_current_mem();
+#endif
+    fprintf(stdout, "\n");
+    if(dev == omp_get_initial_device())
+        fprintf(stdout, "offload: [device: host]");
+    else
+        fprintf(stdout, "offload: [device: %d of %d]", 
+                        dev, omp_get_num_devices());
+    fprintf(stdout, " [table: %.2lfGiB] [rounds: %ld] [pulled: %ld bytes]\n",
+                    inGiB(table), rounds, pulled);
+    fflush(stdout);
+
+#ifdef LIST_OPTIMAL
+    if(list_soln && g != NULL)
+        solution_list(root, g);
+#endif
+    return min_cost;
+}
+#endif
@@ -0,0 +1,251 @@
+/*
+ * This file is part of an experimental software implementation of the
+ * Erickson-Monma-Veinott algorithm for solving the Steiner problem in graphs.
+ * The algorithm runs in edge-linear time and the exponential complexity is
+ * restricted to the number of terminal vertices.
+ *
+ * This software was developed as part of my master thesis work 
+ * "Scalable Parameterised Algorithms for two Steiner Problems" at Aalto
+ * University, Finland.
+ *
+ * The source code is configured for a gcc build for Intel
+ * microarchitectures. Other builds are possible but require manual
+ * configuration of the 'Makefile'.
+ *
+ * The source code is subject to the following license.
+ *
+ * Copyright (c) 2017 Suhas Thejaswi
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ */
+
+#define _GNU_SOURCE // getline
+
+#include<unistd.h>
+#include<sys/socket.h>
+#include<netinet/in.h>
+
+#include"reader-el.h"
+
+/************************************************************** Query server. */
+/*
+ * Serves many terminal sets on one graph, loaded and built once. A query is
+ * a line of terminal numbers in input numbering, the last one is the root,
+ * and replaces the terminals of the root query for one solve with the 
+ * selected engine; a line 'quit' stops the server. Every query gets one 
+ * result line
+ *    query: [id: i] [k: k] [cost: c] [solve: t ms]
+ * or 'query: [id: i] error: ...' for a line that does not make a query.
+ * The EMV tables and the per-thread Dijkstra workspaces are kept across 
+ * the queries, sized up front for 'maxk' terminals or grown to the largest
+ * query so far. Queries come from stdin or from the clients of a TCP port 
+ * on the loopback interface, one connection at a time, and the result 
+ * lines go back to where the query came from.
+ *
+ */
+
+
+query_server_t *query_server_alloc(steinerq_t *root, index_t ds, 
+                                   const emv_opts_t *opt, index_t maxk)
+{
+    index_t n = root->n;
+    query_server_t *qs = (query_server_t *) MALLOC(sizeof(query_server_t));
+    qs->root      = root;
+    qs->ds        = ds;
+    qs->opts      = *opt;
+    // each query would overwrite the metrics of the one before
+    qs->opts.metrics_path = NULL;
+    qs->opts.counters     = 0;
+    qs->w         = NULL;
+    qs->inv       = (index_t *) MALLOC(n*sizeof(index_t));
+    qs->kk        = (index_t *) MALLOC(n*sizeof(index_t));
+    qs->seen      = (index_t *) MALLOC(n*sizeof(index_t));
+    qs->num_queries = 0;
+    qs->num_errors  = 0;
+    for(index_t u = 0; u < n; u++)
+    {
+        qs->inv[(root->perm != NULL) ? root->perm[u] : u] = u;
+        qs->seen[u] = -1;
+    }
+    if(!ds && maxk >= 2)
+        qs->w = emv_ws_alloc(n, opt->nonroot ? maxk-1 : maxk, opt->numa, 
+                             opt->ooc_dir);
+    return qs;
+}
+
+void query_server_free(query_server_t *qs)
+{
+    if(qs->w != NULL)
+        emv_ws_free(qs->w);
+    FREE(qs->inv);
+    FREE(qs->kk);
+    FREE(qs->seen);
+    FREE(qs);
+}
+
+// parses the terminals of query id into qs->kk, returns k or an error
+static index_t query_parse(query_server_t *qs, index_t id, char *line,
+                           const char **err)
+{
+    index_t n = qs->root->n;
+    index_t k = 0;
+    char *p = line;
+    while(1)
+    {
+        while(isspace((unsigned char) *p))
+            p++;
+        if(*p == '\0')
+            break;
+        char *end;
+        long u = strtol(p, &end, 10);
+        if(end == p || (*end != '\0' && !isspace((unsigned char) *end)))
+        {
+            *err = "terminal is not a number";
+            return -1;
+        }
+        if(u < 1 || u > n)
+        {
+            *err = "terminal out of range";
+            return -1;
+        }
+        index_t v = qs->inv[u-1];
+        if(qs->seen[v] == id)
+        {
+            *err = "repeated terminal";
+            return -1;
+        }
+        qs->seen[v] = id;
+        qs->kk[k++] = v;
+        p = end;
+    }
+    if(k < 2)
+    {
+        *err = "fewer than two terminals";
+        return -1;
+    }
+    if(!qs->ds && k > MAX_K)
+    {
+        *err = "too many terminals for the table";
+        return -1;
+    }
+    return k;
+}
+
+// serves the queries of one stream, returns 1 if it asked to quit
+index_t query_serve(query_server_t *qs, FILE *in, FILE *out)
+{
+    steinerq_t *root = qs->root;
+    index_t k_was   = root->k;
+    index_t *kk_was = root->kk;
+    index_t *gpos_was = root->gpos; // queries are plain terminal sets
+    index_t quit    = 0;
+    char *line      = NULL;
+    size_t size     = 0;
+
+    while(getline(&line, &size, in) != -1)
+    {
+        char *p = line;
+        while(isspace((unsigned char) *p))
+            p++;
+        if(*p == '\0')
+            continue;
+        if(!strncmp(p, "quit", 4) && (p[4] == '\0' || isspace((unsigned char) p[4])))
+        {
+            quit = 1;
+            break;
+        }
+
+        index_t id = qs->num_queries++;
+        const char *err = NULL;
+        index_t k = query_parse(qs, id, p, &err);
+        if(k == -1)
+        {
+            qs->num_errors++;
+            fprintf(out, "query: [id: %ld] error: %s\n", id, err);
+            fflush(out);
+            continue;
+        }
+
+        // the tables grow to the largest query
+        index_t kt = qs->opts.nonroot ? k-1 : k;
+        if(!qs->ds && (qs->w == NULL || qs->w->kt < kt))
+        {
+            if(qs->w != NULL)
+                emv_ws_free(qs->w);
+            qs->w = emv_ws_alloc(root->n, kt, qs->opts.numa, 
+                                 qs->opts.ooc_dir);
+        }
+
+        root->k  = k;
+        root->kk = qs->kk;
+        root->gpos = NULL;
+        push_time();
+        index_t cost = qs->ds ? 
+                       dijkstra_steiner(root, qs->opts.list_soln) :
+                       erickson_monma_veinott(root, &qs->opts, NULL, qs->w);
+        double time = pop_time();
+        root->k  = k_was;
+        root->kk = kk_was;
+        root->gpos = gpos_was;
+
+        fprintf(out, "query: [id: %ld] [k: %ld] [cost: %ld] [solve: %.2lf ms]\n",
+                     id, k, cost, time);
+        fflush(out);
+    }
+    free(line); // allocated by getline
+    return quit;
+}
+
+// serves the clients of a loopback port until one of them quits
+void query_listen(query_server_t *qs, index_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if(fd < 0)
+        ERROR("socket fails");
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons((uint16_t) port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+       listen(fd, 16) != 0)
+        ERROR("unable to listen on port %ld", port);
+    fprintf(stdout, "server: [port: %ld] listening\n", port);
+    fflush(stdout);
+
+    index_t quit = 0;
+    while(!quit)
+    {
+        int c = accept(fd, NULL, NULL);
+        if(c < 0)
+            ERROR("accept fails");
+        FILE *in  = fdopen(c, "r");
+        FILE *out = fdopen(dup(c), "w");
+        if(in == NULL || out == NULL)
+            ERROR("unable to open client stream");
+        quit = query_serve(qs, in, out);
+        fclose(out);
+        fclose(in);
+    }
+    close(fd);
+}